@@ -18,12 +18,16 @@
 #ifndef SXT_RACK_ADARENVELOPE_H
 #define SXT_RACK_ADARENVELOPE_H
 
+#include "SharedTables.hpp"
+
 namespace sst::surgext_rack::dsp::envelopes
 {
 struct ADAREnvelope
 {
-    static constexpr int tuning_table_size = 512;
-    float table_envrate_linear alignas(16)[512];
+    static constexpr int tuning_table_size = EnvRateTable::size;
+    // shared between all envelopes running at the same rate, see SharedTables.hpp
+    std::shared_ptr<const EnvRateTable> envrate_table;
+    const float* table_envrate_linear{nullptr};
     double dsamplerate_os{0};
 
     // Constants from Surge
@@ -32,6 +36,7 @@ struct ADAREnvelope
     const float BLOCK_SIZE_INV = (1.f / BLOCK_SIZE);
 
     float sample_rate = 0.0;
+    float envrate_table_rate = 0.0;
 
     ADAREnvelope()
     {   
@@ -44,11 +49,11 @@ struct ADAREnvelope
     {
         sample_rate = sr;
         dsamplerate_os = sample_rate * 2.0;
-        // from SurgeStorage::init_tables
-        for (int i = 0; i < tuning_table_size; i++)
+        if (!envrate_table || envrate_table_rate != sample_rate)
         {
-            double k = dsamplerate_os * pow(2.0, (((double)i - 256.0) / 16.0)) / (double)BLOCK_SIZE_OS;
-            table_envrate_linear[i] = (float)(1.f / k);
+            envrate_table = EnvRateTable::acquire(sample_rate);
+            table_envrate_linear = envrate_table->data;
+            envrate_table_rate = sample_rate;
         }
     }
 
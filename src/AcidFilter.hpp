@@ -1,62 +1,138 @@
 #include <math.h>
+#include <algorithm>
+#include <cstring>
 #include <sst/filters/HalfRateFilter.h>
 #include "chowdsp_filters/chowdsp_filters.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SYNTH303_STEREO_SSE 1
+#else
+#define SYNTH303_STEREO_SSE 0
+#endif
+
+// One channel of the ladder at the oversampled rate: input DC blocker, saturated feedback, the four stages
+// and the output highpass. AcidFilter runs one, AcidFilterStereo one per channel.
+struct AcidLadder {
+
+	float y1 = 0, y2 = 0, y3 = 0, y4 = 0; // stages
+	float last_output = 0;
+
+    chowdsp::FirstOrderHPF< float > hpf1; // input DC blocker
+    chowdsp::FirstOrderHPF< float > hpf2; // fb filter
+    chowdsp::FirstOrderHPF< float > hpf3; // output filter
+
+	void prepare(float Fs) {
+		hpf1.calcCoefs(50.0f, Fs); // input DC blocker
+		hpf2.calcCoefs(200.0f, Fs); // fb filter
+		hpf3.calcCoefs(80.0f, Fs); // output filter
+	}
+
+	void reset() {
+		y1 = y2 = y3 = y4 = 0;
+		last_output = 0;
+		hpf1.reset();
+		hpf2.reset();
+		hpf3.reset();
+	}
+
+	// true when a stage has decayed into the subnormal range, very slow on x86 without FTZ/DAZ
+	bool hasDenormalState() const {
+		return std::fpclassify(y1) == FP_SUBNORMAL || std::fpclassify(y2) == FP_SUBNORMAL
+			|| std::fpclassify(y3) == FP_SUBNORMAL || std::fpclassify(y4) == FP_SUBNORMAL;
+	}
+
+	// one oversampled sample with the tuning of AcidFilter::tuning() (based on kunn's filter from KVR Open303 thread)
+	inline float process(float x, float a, float k, float rgc) {
+		const float _x = hpf1.processSample(x); // input HPF DC block
+
+		float fb = _x - k * last_output;
+		fb = std::tanh(fb*rgc)/rgc;
+		fb = hpf2.processSample(fb);
+
+		y1 += 2 * a * (fb - y1 + y2);
+		y2 +=  a * (y1 - 2 * y2 + y3);
+		y3 +=  a * (y2 - 2 * y3 + y4);
+		y4 +=  a * (y3 - 2 * y4);
+		last_output = y4 * rgc;
+
+		return hpf3.processSample(last_output);
+	}
+};
+
 struct AcidFilter {
 
-	float y1, y2, y3, y4; // stages
+	AcidLadder ladder;
 	float a; // tuning
 	float k; // the K
 	float rgc; // resonance gain compensation
 	float Fs;
-	float last_output;
 
 	float Fc, Res;
 
-	float dL4 alignas(16)[4], dR4 alignas(16)[4]; // L+R arrays of 4 floats for downsampler
+	static constexpr int oversampling = 4;
+	// the half-rate decimator works on at most 256 samples per call
+	static constexpr int decimatorChunk = 256 / oversampling;
 
 	// Using 1st order (?) and steep
-	sst::filters::HalfRate::HalfRateFilter hrfUp = sst::filters::HalfRate::HalfRateFilter(1, true);
-    sst::filters::HalfRate::HalfRateFilter hrfDn = sst::filters::HalfRate::HalfRateFilter(1, true);
+	// 4x -> 2x and 2x -> 1x, each stage needs its own state
+	sst::filters::HalfRate::HalfRateFilter hrfDn = sst::filters::HalfRate::HalfRateFilter(1, true);
+	sst::filters::HalfRate::HalfRateFilter hrfDn2 = sst::filters::HalfRate::HalfRateFilter(1, true);
 
-    chowdsp::FirstOrderHPF< float > hpf1; // input DC blocker
-    chowdsp::FirstOrderHPF< float > hpf2; // fb filter
-    chowdsp::FirstOrderHPF< float > hpf3; // output filter
-
-	float downsample4() {
-		hrfDn.process_block_D2(dL4, dR4, 4); // down 4 samples to 2, inplace
-		hrfDn.process_block_D2(dL4, dR4, 2); // down 2 samples to 1, inplace
-		return dL4[0];
+	// osL/osR hold frames * 4 oversampled samples and are used as scratch, out receives frames samples
+	void decimate(float* osL, float* osR, float* out, int frames) {
+		for (int start = 0; start < frames; start += decimatorChunk)
+		{
+			const int n = std::min(decimatorChunk, frames - start);
+			float* const L = osL + start * oversampling;
+			float* const R = osR + start * oversampling;
+			hrfDn.process_block_D2(L, R, n * 4); // down 4x to 2x, inplace
+			hrfDn2.process_block_D2(L, R, n * 2); // down 2x to 1x, inplace
+			std::memcpy(out + start, L, sizeof(float) * n);
+		}
 	}
 
 	void prepare(float Sr, float cutoff = 4440.0f, float resonance = 0.75f) {
 		// Sr is outside samplerate, internal is 4x;
 		Fs = 4 * Sr;
 		calcCoeffs(cutoff, resonance);
-		hpf1.calcCoefs(50.0f, Fs); // input DC blocker
-		hpf2.calcCoefs(200.0f, Fs); // fb filter
-		hpf3.calcCoefs(80.0f, Fs); // output filter
+		ladder.prepare(Fs);
+	}
+
+	// silence: ladder and decimator histories cleared
+	void reset() {
+		ladder.reset();
+		hrfDn.reset();
+		hrfDn2.reset();
 	}
 
 	void setDCBlockerCutoff(float f) {
-		hpf1.calcCoefs(f, Fs);
+		ladder.hpf1.calcCoefs(f, Fs);
 	}
 
 	void setFeedbackCutoff(float f) {
-		hpf2.calcCoefs(f, Fs);
+		ladder.hpf2.calcCoefs(f, Fs);
 	}
 
 	void setOutputCutoff(float f) {
-		hpf3.calcCoefs(f, Fs);
+		ladder.hpf3.calcCoefs(f, Fs);
 	}
 
 	void print() {
 		d_stdout("Res %f rgc %f k %f", Res, rgc, k);
 	}
 
+	bool hasDenormalState() const {
+		return ladder.hasDenormalState();
+	}
+
 	void calcCoeffs(float Fc, float Resonance) {
 		this->Fc = Fc;
 		Res = Resonance;
+		tuning(Fc, Resonance, Fs, a, k, rgc);
+	}
+
+	static void tuning(float Fc, float Resonance, float Fs, float& a, float& k, float& rgc) {
 		// tuning formulas based on antto's work from KVR Open303 thread
 		float fx = Fc/Fs * std::sqrt(2.0);
 		a = (fx * M_PI) / (1.0 + fx * 5.6147717 + fx * fx * 2.7919823);
@@ -66,28 +142,186 @@ struct AcidFilter {
 		k = k*Resonance; // now K is the feedback level based on the Resonance param
 	}
 
-	float processSample(float* x) {
-    	float _x;
+	// one input sample worth of 4x oversampled input in x, 4x oversampled output in os, decimate() afterwards
+	void processOversampled(const float* x, float* os) {
+		// 4x oversampled filter
+		for (int i = 0; i < oversampling; ++i)
+			os[i] = ladder.process(x[i], a, k, rgc);
+	}
+
+};
+
+// The same ladder for a stereo input, one AcidLadder per channel. Both channels share the cutoff, so the
+// tuning is computed once per sample for the two. Both halfband stages of each direction filter the pair
+// together, which is what HalfRateFilter is built for.
+//
+// With SSE2 the two channels run in lanes 0 and 1 of one register: the saturator and the four stages take
+// the operations of AcidLadder::process() in the same order, the highpasses stay the chowdsp filters of
+// each AcidLadder. Only std::tanh is replaced, by tanhLanes(), so the lanes follow the mono ladder to a few
+// ulp per sample (tools/selfcheck measures how far that drifts through the feedback).
+struct AcidFilterStereo {
+
+	static constexpr int oversampling = AcidFilter::oversampling;
+	static constexpr int chunk = AcidFilter::decimatorChunk;
+
+	float Fs = 192000.0f;
+	AcidLadder left, right;
+
+	sst::filters::HalfRate::HalfRateFilter hrfUp = sst::filters::HalfRate::HalfRateFilter(1, true);
+	sst::filters::HalfRate::HalfRateFilter hrfUp2 = sst::filters::HalfRate::HalfRateFilter(1, true);
+	sst::filters::HalfRate::HalfRateFilter hrfDn = sst::filters::HalfRate::HalfRateFilter(1, true);
+	sst::filters::HalfRate::HalfRateFilter hrfDn2 = sst::filters::HalfRate::HalfRateFilter(1, true);
+
+	alignas(16) float halfL[2 * chunk], halfR[2 * chunk]; // 2x, between the upsampling stages
+
+	void prepare(float Sr) {
+		Fs = 4 * Sr;
+		left.prepare(Fs);
+		right.prepare(Fs);
+	}
+
+	// inL/inR hold frames samples, osL/osR receive frames * 4
+	void upsample(const float* inL, const float* inR, float* osL, float* osR, int frames) {
+		for (int start = 0; start < frames; start += chunk)
+		{
+			const int n = std::min(chunk, frames - start);
+			// the halfband filters take output sample counts and do not write their inputs
+			hrfUp.process_block_U2(const_cast<float*>(inL + start), const_cast<float*>(inR + start), halfL, halfR, n * 2);
+			hrfUp2.process_block_U2(halfL, halfR, osL + start * oversampling, osR + start * oversampling, n * 4);
+		}
+	}
+
+	// osL/osR hold frames * 4 oversampled samples and are used as scratch, outL/outR receive frames samples
+	void decimate(float* osL, float* osR, float* outL, float* outR, int frames) {
+		for (int start = 0; start < frames; start += chunk)
+		{
+			const int n = std::min(chunk, frames - start);
+			float* const L = osL + start * oversampling;
+			float* const R = osR + start * oversampling;
+			hrfDn.process_block_D2(L, R, n * 4);
+			hrfDn2.process_block_D2(L, R, n * 2);
+			std::memcpy(outL + start, L, sizeof(float) * n);
+			std::memcpy(outR + start, R, sizeof(float) * n);
+		}
+	}
+
+	void reset() {
+		left.reset();
+		right.reset();
+		hrfUp.reset();
+		hrfUp2.reset();
+		hrfDn.reset();
+		hrfDn2.reset();
+	}
+
+	bool hasDenormalState() const {
+		return left.hasDenormalState() || right.hasDenormalState();
+	}
+
+#if SYNTH303_STEREO_SSE
+	// e^x as exp_poly() in synth303common.cpp computes it, for 0 <= x <= 20
+	static __m128 expLanes(__m128 x) {
+		const __m128 shifted = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504f)), _mm_set1_ps(12582912.0f));
+		const __m128 n = _mm_sub_ps(shifted, _mm_set1_ps(12582912.0f));
+		const __m128 r = _mm_add_ps(_mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(0.693359375f))),
+									_mm_mul_ps(n, _mm_set1_ps(2.12194440e-4f)));
+
+		__m128 p = _mm_set1_ps(1.9875691500e-4f);
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.3981999507e-3f));
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(8.3334519073e-3f));
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(4.1665795894e-2f));
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.6666665459e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(5.0000001201e-1f));
+		p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, r), r), r), _mm_set1_ps(1.0f));
+
+		// 2^n from the integer bits of shifted
+		const __m128i e = _mm_sub_epi32(_mm_castps_si128(shifted), _mm_set1_epi32(0x4B400000 - 127));
+		return _mm_mul_ps(p, _mm_castsi128_ps(_mm_slli_epi32(e, 23)));
+	}
+
+	// tanh the way Cephes' tanhf computes it, a few ulp from std::tanh: an odd polynomial below 0.625,
+	// 1 - 2 / (e^2|x| + 1) above. Past 10 the result is 1 in float anyway.
+	static __m128 tanhLanes(__m128 x) {
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		const __m128 ax = _mm_min_ps(_mm_andnot_ps(signBit, x), _mm_set1_ps(10.0f));
+
+		const __m128 z = _mm_mul_ps(ax, ax);
+		__m128 p = _mm_set1_ps(-5.70498872745e-3f);
+		p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(2.06390887954e-2f));
+		p = _mm_sub_ps(_mm_mul_ps(p, z), _mm_set1_ps(5.37397155531e-2f));
+		p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.33314422036e-1f));
+		p = _mm_sub_ps(_mm_mul_ps(p, z), _mm_set1_ps(3.33332819422e-1f));
+		const __m128 small = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), ax), ax);
+
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 large = _mm_sub_ps(one, _mm_div_ps(_mm_set1_ps(2.0f),
+											_mm_add_ps(expLanes(_mm_add_ps(ax, ax)), one)));
+
+		const __m128 isSmall = _mm_cmplt_ps(ax, _mm_set1_ps(0.625f));
+		const __m128 t = _mm_or_ps(_mm_and_ps(isSmall, small), _mm_andnot_ps(isSmall, large));
+		return _mm_or_ps(t, _mm_and_ps(signBit, x));
+	}
+
+	static __m128 lanes(float l, float r) {
+		return _mm_unpacklo_ps(_mm_set_ss(l), _mm_set_ss(r));
+	}
+
+	static float lane1(__m128 v) {
+		return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+	}
+#endif
+
+	// per-sample cutoff in freq, frames input samples 4x oversampled in inL/inR, 4x output in osL/osR
+	void process(const float* freq, float resonance, const float* inL, const float* inR, float* osL, float* osR,
+				 int frames) {
+#if SYNTH303_STEREO_SSE
+		__m128 y1 = lanes(left.y1, right.y1), y2 = lanes(left.y2, right.y2);
+		__m128 y3 = lanes(left.y3, right.y3), y4 = lanes(left.y4, right.y4);
+		__m128 last_output = lanes(left.last_output, right.last_output);
+
+		for (int i = 0; i < frames; ++i)
+		{
+			float fa, fk, frgc;
+			AcidFilter::tuning(freq[i], resonance, Fs, fa, fk, frgc);
+			const __m128 a = _mm_set1_ps(fa), a2 = _mm_set1_ps(2 * fa), k = _mm_set1_ps(fk);
+			const __m128 rgc = _mm_set1_ps(frgc), two = _mm_set1_ps(2.0f);
+
+			for (int j = i * oversampling; j < (i + 1) * oversampling; ++j)
+			{
+				const __m128 _x = lanes(left.hpf1.processSample(inL[j]), right.hpf1.processSample(inR[j]));
 
-    	// 4x oversampled filter (based on kunn's filter from KVR Open303 thread)
-    	for (int i = 0; i < 4; ++i)
-    	{	
-			_x = hpf1.processSample(x[i]); // input HPF DC block
+				__m128 fb = _mm_sub_ps(_x, _mm_mul_ps(k, last_output));
+				fb = _mm_div_ps(tanhLanes(_mm_mul_ps(fb, rgc)), rgc);
+				fb = lanes(left.hpf2.processSample(_mm_cvtss_f32(fb)), right.hpf2.processSample(lane1(fb)));
 
-    		float fb = _x - k * last_output;
-    		fb = std::tanh(fb*rgc)/rgc;
-    		fb = hpf2.processSample(fb);
+				y1 = _mm_add_ps(y1, _mm_mul_ps(a2, _mm_add_ps(_mm_sub_ps(fb, y1), y2)));
+				y2 = _mm_add_ps(y2, _mm_mul_ps(a, _mm_add_ps(_mm_sub_ps(y1, _mm_mul_ps(two, y2)), y3)));
+				y3 = _mm_add_ps(y3, _mm_mul_ps(a, _mm_add_ps(_mm_sub_ps(y2, _mm_mul_ps(two, y3)), y4)));
+				y4 = _mm_add_ps(y4, _mm_mul_ps(a, _mm_sub_ps(y3, _mm_mul_ps(two, y4))));
+				last_output = _mm_mul_ps(y4, rgc);
 
-			y1 += 2 * a * (fb - y1 + y2);
-			y2 +=  a * (y1 - 2 * y2 + y3);
-			y3 +=  a * (y2 - 2 * y3 + y4);
-			y4 +=  a * (y3 - 2 * y4);
-			last_output = y4 * rgc;
+				osL[j] = left.hpf3.processSample(_mm_cvtss_f32(last_output));
+				osR[j] = right.hpf3.processSample(lane1(last_output));
+			}
+		}
 
-			dL4[i] = hpf3.processSample(last_output);
-    	}
+		left.y1 = _mm_cvtss_f32(y1); right.y1 = lane1(y1);
+		left.y2 = _mm_cvtss_f32(y2); right.y2 = lane1(y2);
+		left.y3 = _mm_cvtss_f32(y3); right.y3 = lane1(y3);
+		left.y4 = _mm_cvtss_f32(y4); right.y4 = lane1(y4);
+		left.last_output = _mm_cvtss_f32(last_output); right.last_output = lane1(last_output);
+#else
+		for (int i = 0; i < frames; ++i)
+		{
+			float a, k, rgc;
+			AcidFilter::tuning(freq[i], resonance, Fs, a, k, rgc);
 
-		return downsample4();
+			for (int j = i * oversampling; j < (i + 1) * oversampling; ++j)
+			{
+				osL[j] = left.process(inL[j], a, k, rgc);
+				osR[j] = right.process(inR[j], a, k, rgc);
+			}
+		}
+#endif
 	}
-	
-};
\ No newline at end of file
+};
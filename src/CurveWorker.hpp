@@ -0,0 +1,299 @@
+// Cutoff curves for the editor, simulated on a worker thread so onImGuiDisplay() only ever draws.
+//
+// The UI posts a CurveRequest, a snapshot of the knobs, the formula and the families of curves to show.
+// Posting again while a job runs makes that job stale, the worker notices within a few thousand samples and
+// starts over with the newest snapshot. Finished curves come back through three CurveSets swapped with
+// atomic exchanges: the worker fills one, the UI draws another and the third is the handoff slot, so
+// neither side ever waits for the other or sees a half written set.
+
+#ifndef SYNTH303_CURVE_WORKER_H
+#define SYNTH303_CURVE_WORKER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "extra/Mutex.hpp"
+#include "extra/Thread.hpp"
+
+#include "ADAREnvelope.h"
+#include "WowFilter.h"
+
+#include "CutoffFormula.hpp"
+#include "synth303common.hpp"
+#include "Synth303Parameters.hpp"
+
+START_NAMESPACE_DISTRHO
+
+// --------------------------------------------------------------------------------------------------------------------
+
+// min and max of every bucket in the order they occur, so a curve keeps its peaks and steps at a few hundred
+// points. outX/outY hold 2 * buckets values, returns how many were written.
+static inline int decimateMinMax(const float* y, int size, int buckets, float* outX, float* outY)
+{
+    int points = 0;
+    for (int b = 0; b < buckets; ++b)
+    {
+        const int start = (int)((int64_t)size * b / buckets);
+        const int end = (int)((int64_t)size * (b + 1) / buckets);
+        if (start == end)
+            continue;
+
+        int lo = start, hi = start;
+        for (int i = start + 1; i < end; ++i)
+        {
+            if (y[i] < y[lo]) lo = i;
+            if (y[i] > y[hi]) hi = i;
+        }
+
+        const int first = std::min(lo, hi), second = std::max(lo, hi);
+        outX[points] = first;
+        outY[points++] = y[first];
+        if (second != first) {
+            outX[points] = second;
+            outY[points++] = y[second];
+        }
+    }
+    return points;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+struct CurveRequest {
+    double sampleRate = 48000.0;
+
+    float fVco = parameterDefault(kParamCutoff);
+    float fRes = parameterDefault(kParamResonance);
+    float fVmod = parameterDefault(kParamVmod);
+    float fVacc_amt = parameterDefault(kParamAccent);
+    float atkTime = parameterDefault(kParamVcfAttack);
+    float decTime = parameterDefault(kParamDecay);
+
+    float A = parameterDefault(kParamFormulaA);
+    float B = parameterDefault(kParamFormulaB);
+    float C = parameterDefault(kParamFormulaC);
+    float D = parameterDefault(kParamFormulaD);
+    float E = parameterDefault(kParamFormulaE);
+    float base = parameterDefault(kParamFormulaBase);
+    float VaccMul = parameterDefault(kParamFormulaVaccMul);
+
+    bool accent = true;
+    CutoffFormula formula; // empty for vcf_env_freq
+
+    // besides the curve of the settings above
+    bool accentPair = false;  // the same with accent toggled
+    bool envmodSweep = false; // envmod at 0, 0.5 and 1
+    bool shortDecay = false;  // the shortest decay
+};
+
+struct CurveSet {
+    static constexpr int kMaxCurves = 8;
+    static constexpr int kBuckets = 400;
+
+    struct Curve {
+        char label[32];
+        int points;
+        float x[2 * kBuckets]; // sample index
+        float y[2 * kBuckets]; // cutoff in Hz
+    };
+
+    Curve curves[kMaxCurves];
+    int count = 0;
+    int frames = 0; // longest simulation, for fitting the axes
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+class CurveWorker : public Thread
+{
+public:
+    static constexpr float kShortestDecay = -2.223f;
+
+    CurveWorker()
+        : Thread("synth303 curves") {}
+
+    ~CurveWorker() override {
+        stop();
+    }
+
+    void start() {
+        startThread();
+    }
+
+    void stop() {
+        signalThreadShouldExit();
+        wakeup.signal();
+        stopThread(2000);
+    }
+
+    // UI thread, replaces whatever was posted before
+    void post(const CurveRequest& request) {
+        {
+            const MutexLocker cml(requestMutex);
+            pending = request;
+            serial.fetch_add(1, std::memory_order_release);
+        }
+        wakeup.signal();
+    }
+
+    // any thread, true when fetch() would adopt a new set
+    bool hasNewCurves() const {
+        return (handoff.load(std::memory_order_acquire) & kFresh) != 0;
+    }
+
+    // UI thread, adopts the newest finished set. Returns false when there is none since the last call and
+    // the set from curves() stays the same.
+    bool fetch() {
+        if ((handoff.load(std::memory_order_acquire) & kFresh) == 0)
+            return false;
+        front = handoff.exchange(front, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    // UI thread, valid until the next fetch()
+    const CurveSet& curves() const {
+        return sets[front];
+    }
+
+    // worker thread
+    static int curveFrames(double sampleRate, float atkTime, float decTime) {
+        // long enough for the decay to reach about -70 dB: the analog envelope's stages have time constants
+        // of 2^time / 4 seconds
+        const double seconds = 2.0 * (std::exp2(atkTime) + std::exp2(decTime));
+        return (int)std::ceil(std::min(std::max(seconds, 0.05), 10.0) * sampleRate);
+    }
+
+protected:
+    void run() override {
+        uint32_t done = 0;
+        while (!shouldThreadExit())
+        {
+            uint32_t job = serial.load(std::memory_order_acquire);
+            if (job == done) {
+                wakeup.wait();
+                continue;
+            }
+
+            CurveRequest request;
+            {
+                const MutexLocker cml(requestMutex);
+                request = pending;
+                job = serial.load(std::memory_order_relaxed);
+            }
+
+            if (simulate(request, job, sets[back]))
+                back = handoff.exchange(back | kFresh, std::memory_order_acq_rel) & kIndexMask;
+            done = job;
+        }
+    }
+
+private:
+    static constexpr int kIndexMask = 3;
+    static constexpr int kFresh = 4;
+
+    CurveSet sets[3];
+    int front = 0;                    // UI thread
+    int back = 2;                     // worker thread
+    std::atomic<int> handoff { 1 };   // index, plus kFresh when the worker put a set there
+
+    Mutex requestMutex;
+    CurveRequest pending;
+    std::atomic<uint32_t> serial { 0 };
+    Signal wakeup;
+
+    // worker thread only
+    sst::surgext_rack::dsp::envelopes::ADAREnvelope vcf_env;
+    double envRate = 0.0;
+    std::vector<float> envBuffer, vaccBuffer, freqBuffer;
+    float formulaRegisters[CutoffFormula::kMaxRegisters * 256];
+
+    bool stale(uint32_t job) const {
+        return shouldThreadExit() || serial.load(std::memory_order_relaxed) != job;
+    }
+
+    bool simulate(const CurveRequest& request, uint32_t job, CurveSet& set) {
+        struct Variant { const char* label; float vmod; bool accent; float decTime; };
+        Variant variants[CurveSet::kMaxCurves];
+        int count = 0;
+
+        variants[count++] = { "Freq", request.fVmod, request.accent, request.decTime };
+        if (request.accentPair)
+            variants[count++] = { request.accent ? "no accent" : "accent", request.fVmod, !request.accent, request.decTime };
+        if (request.envmodSweep) {
+            variants[count++] = { "envmod 0", 0.0f, request.accent, request.decTime };
+            variants[count++] = { "envmod 0.5", 0.5f, request.accent, request.decTime };
+            variants[count++] = { "envmod 1", 1.0f, request.accent, request.decTime };
+        }
+        if (request.shortDecay)
+            variants[count++] = { "shortest decay", request.fVmod, request.accent, kShortestDecay };
+
+        if (envRate != request.sampleRate) {
+            vcf_env.activate(request.sampleRate);
+            envRate = request.sampleRate;
+        }
+
+        set.count = 0;
+        set.frames = 0;
+        for (int v = 0; v < count; ++v)
+        {
+            const Variant& variant = variants[v];
+            CurveSet::Curve& curve = set.curves[set.count];
+            const int frames = curveFrames(request.sampleRate, request.atkTime, variant.decTime);
+            if (!simulateCurve(request, variant.vmod, variant.accent, variant.decTime, frames, job))
+                return false;
+
+            std::snprintf(curve.label, sizeof(curve.label), "%s", variant.label);
+            curve.points = decimateMinMax(freqBuffer.data(), frames, CurveSet::kBuckets, curve.x, curve.y);
+            set.frames = std::max(set.frames, frames);
+            ++set.count;
+        }
+        return true;
+    }
+
+    // one envelope cycle into freqBuffer, false when the job went stale on the way
+    bool simulateCurve(const CurveRequest& r, float vmod, bool accent, float decTime, int frames, uint32_t job) {
+        constexpr int kCheckEvery = 4096;
+
+        envBuffer.resize(frames);
+        vaccBuffer.resize(frames);
+        freqBuffer.resize(frames);
+
+        WowFilter wowFilter;
+        wowFilter.prepare(r.sampleRate);
+        wowFilter.setResonancePot(r.fRes);
+
+        vcf_env.immediatelyEnd();
+        vcf_env.attackFrom(0.0f, 3, false, false);
+
+        for (int i = 0; i < frames; ++i)
+        {
+            if (i % kCheckEvery == 0 && stale(job))
+                return false;
+
+            vcf_env.process(r.atkTime, decTime, 3, 1, false);
+            const float Vacc = wowFilter.processSample(accent ? vcf_env.output * r.fVacc_amt : 0.0f);
+            envBuffer[i] = vcf_env.output;
+            vaccBuffer[i] = Vacc;
+            if (r.formula.empty())
+                freqBuffer[i] = vcf_env_freq(vcf_env.output, r.fVco, vmod, Vacc, r.A, r.B, r.C, r.D, r.E, r.base, r.VaccMul);
+        }
+
+        if (!r.formula.empty()) {
+            const float uniforms[CutoffFormula::kUniformCount] = { r.fVco, vmod, r.A, r.B, r.C, r.D, r.E, r.base, r.VaccMul };
+            for (int i = 0; i < frames; i += 256)
+                r.formula.evaluate(uniforms, &envBuffer[i], &vaccBuffer[i], &freqBuffer[i], std::min(256, frames - i),
+                                   formulaRegisters, 256);
+        }
+        return true;
+    }
+
+    DISTRHO_DECLARE_NON_COPYABLE(CurveWorker)
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+END_NAMESPACE_DISTRHO
+
+#endif // SYNTH303_CURVE_WORKER_H
@@ -0,0 +1,534 @@
+// Parser, folding and block evaluation of CutoffFormula.
+
+#include "CutoffFormula.hpp"
+#include "synth303common.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// --------------------------------------------------------------------------------------------------------------------
+// syntax tree, only lives while compiling
+
+namespace {
+
+enum NodeKind { kNodeLiteral, kNodeUniform, kNodeInput, kNodeOp };
+
+// what a subtree depends on, a node is the maximum of its children
+enum Variance { kConstant, kPerBlock, kPerSample };
+
+struct Node {
+    NodeKind kind;
+    CutoffFormula::OpCode code;
+    float value;
+    int index; // uniform or input
+    int a, b;  // children, -1 if unused
+    Variance variance;
+};
+
+struct NamedOp {
+    const char* name;
+    CutoffFormula::OpCode code;
+    int arguments;
+};
+
+const NamedOp kFunctions[] = {
+    { "exp", CutoffFormula::kExp, 1 },
+    { "log", CutoffFormula::kLog, 1 },
+    { "sqrt", CutoffFormula::kSqrt, 1 },
+    { "tanh", CutoffFormula::kTanh, 1 },
+    { "abs", CutoffFormula::kAbs, 1 },
+    { "fabs", CutoffFormula::kAbs, 1 },
+    { "pow", CutoffFormula::kPow, 2 },
+    { "min", CutoffFormula::kMin, 2 },
+    { "max", CutoffFormula::kMax, 2 },
+};
+
+const struct { const char* name; int uniform; } kUniformNames[] = {
+    { "Vco", CutoffFormula::kVco },
+    { "Vmod_amt", CutoffFormula::kVmodAmt },
+    { "A", CutoffFormula::kA },
+    { "B", CutoffFormula::kB },
+    { "C", CutoffFormula::kC },
+    { "D", CutoffFormula::kD },
+    { "E", CutoffFormula::kE },
+    { "base", CutoffFormula::kBase },
+    { "VaccMul", CutoffFormula::kVaccMul },
+};
+
+float applyScalar(CutoffFormula::OpCode code, float a, float b)
+{
+    switch (code)
+    {
+    case CutoffFormula::kAdd: return a + b;
+    case CutoffFormula::kSub: return a - b;
+    case CutoffFormula::kMul: return a * b;
+    case CutoffFormula::kDiv: return a / b;
+    case CutoffFormula::kPow: return std::pow(a, b);
+    case CutoffFormula::kMin: return a < b ? a : b;
+    case CutoffFormula::kMax: return a > b ? a : b;
+    case CutoffFormula::kNeg: return -a;
+    case CutoffFormula::kExp: return std::exp(a);
+    case CutoffFormula::kLog: return std::log(a);
+    case CutoffFormula::kSqrt: return std::sqrt(a);
+    case CutoffFormula::kTanh: return std::tanh(a);
+    case CutoffFormula::kAbs: return std::fabs(a);
+    case CutoffFormula::kCopy: return a;
+    }
+    return a;
+}
+
+bool isUnary(CutoffFormula::OpCode code)
+{
+    return code >= CutoffFormula::kNeg;
+}
+
+// ----------------------------------------------------------------------------------------------------------------
+
+struct Parser {
+    const char* text;
+    const char* p;
+    std::vector<Node> nodes;
+    char message[128] = {};
+
+    explicit Parser(const char* t) : text(t), p(t) {}
+
+    bool failed() const {
+        return message[0] != '\0';
+    }
+
+    int fail(const char* format, ...) {
+        if (!failed())
+        {
+            char what[96];
+            va_list args;
+            va_start(args, format);
+            std::vsnprintf(what, sizeof(what), format, args);
+            va_end(args);
+            std::snprintf(message, sizeof(message), "%s at column %d", what, (int)(p - text) + 1);
+        }
+        return -1;
+    }
+
+    void skipSpace() {
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+            ++p;
+    }
+
+    bool accept(char c) {
+        skipSpace();
+        if (*p != c)
+            return false;
+        ++p;
+        return true;
+    }
+
+    // identifier at p without consuming it, length 0 if none
+    std::size_t peekIdentifier() const {
+        std::size_t length = 0;
+        if (std::isalpha((unsigned char)*p) || *p == '_')
+            while (std::isalnum((unsigned char)p[length]) || p[length] == '_' || (p[length] == ':' && p[length + 1] == ':'))
+                length += p[length] == ':' ? 2 : 1;
+        return length;
+    }
+
+    bool acceptWord(const char* word) {
+        skipSpace();
+        const std::size_t length = std::strlen(word);
+        if (peekIdentifier() != length || std::strncmp(p, word, length) != 0)
+            return false;
+        p += length;
+        return true;
+    }
+
+    int add(Node node) {
+        // fold as we go: a node over constants is a constant
+        Variance variance = kConstant;
+        if (node.kind == kNodeUniform)
+            variance = kPerBlock;
+        else if (node.kind == kNodeInput)
+            variance = kPerSample;
+        else if (node.kind == kNodeOp)
+        {
+            variance = std::max(variance, nodes[node.a].variance);
+            if (node.b >= 0)
+                variance = std::max(variance, nodes[node.b].variance);
+
+            if (variance == kConstant)
+            {
+                const float b = node.b >= 0 ? nodes[node.b].value : 0.0f;
+                node = Node { kNodeLiteral, CutoffFormula::kCopy, applyScalar(node.code, nodes[node.a].value, b), 0, -1, -1, kConstant };
+            }
+        }
+        node.variance = variance;
+        nodes.push_back(node);
+        return (int)nodes.size() - 1;
+    }
+
+    int literal(float value) {
+        return add(Node { kNodeLiteral, CutoffFormula::kCopy, value, 0, -1, -1, kConstant });
+    }
+
+    int op(CutoffFormula::OpCode code, int a, int b = -1) {
+        if (a < 0 || (b < 0 && !isUnary(code)))
+            return -1;
+        return add(Node { kNodeOp, code, 0.0f, 0, a, b, kConstant });
+    }
+
+    // Vmod as vcf_env_freq computes it: (6.9*Vmod_amt + 1.3) * env + (-1.2*Vmod_amt + 3) - 3.2
+    int vmod() {
+        const int amount = add(Node { kNodeUniform, CutoffFormula::kCopy, 0.0f, CutoffFormula::kVmodAmt, -1, -1, kConstant });
+        const int env = add(Node { kNodeInput, CutoffFormula::kCopy, 0.0f, CutoffFormula::kInputEnv, -1, -1, kConstant });
+        const int scale = op(CutoffFormula::kAdd, op(CutoffFormula::kMul, literal(6.9f), amount), literal(1.3f));
+        const int bias = op(CutoffFormula::kAdd, op(CutoffFormula::kMul, literal(-1.2f), amount), literal(3.0f));
+        return op(CutoffFormula::kSub, op(CutoffFormula::kAdd, op(CutoffFormula::kMul, scale, env), bias), literal(3.2f));
+    }
+
+    int primary() {
+        skipSpace();
+
+        if (accept('('))
+        {
+            const int inner = expression();
+            if (!accept(')'))
+                return fail("expected ')'");
+            return inner;
+        }
+
+        if (std::isdigit((unsigned char)*p) || *p == '.')
+        {
+            char* end;
+            const float value = std::strtof(p, &end);
+            if (end == p)
+                return fail("bad number");
+            p = end;
+            if (*p == 'f' || *p == 'F')
+                ++p;
+            return literal(value);
+        }
+
+        const std::size_t length = peekIdentifier();
+        if (length == 0)
+            return fail(*p == '\0' ? "unexpected end" : "unexpected '%c'", *p);
+
+        const char* name = p;
+        std::size_t nameLength = length;
+        if (nameLength > 5 && std::strncmp(name, "std::", 5) == 0)
+            name += 5, nameLength -= 5;
+        auto is = [&](const char* word) { return std::strlen(word) == nameLength && std::strncmp(name, word, nameLength) == 0; };
+
+        for (const NamedOp& function : kFunctions)
+        {
+            if (!is(function.name))
+                continue;
+            p += length;
+            if (!accept('('))
+                return fail("expected '(' after %s", function.name);
+            const int a = expression();
+            int b = -1;
+            if (function.arguments == 2 && !accept(','))
+                return fail("%s takes two arguments", function.name);
+            if (function.arguments == 2)
+                b = expression();
+            if (!accept(')'))
+                return fail("expected ')'");
+            return op(function.code, a, b);
+        }
+
+        p += length;
+        if (is("env") || is("vcf_env"))
+            return add(Node { kNodeInput, CutoffFormula::kCopy, 0.0f, CutoffFormula::kInputEnv, -1, -1, kConstant });
+        if (is("Vacc"))
+            return add(Node { kNodeInput, CutoffFormula::kCopy, 0.0f, CutoffFormula::kInputVacc, -1, -1, kConstant });
+        if (is("Vmod"))
+            return vmod();
+        for (const auto& uniform : kUniformNames)
+            if (is(uniform.name))
+                return add(Node { kNodeUniform, CutoffFormula::kCopy, 0.0f, uniform.uniform, -1, -1, kConstant });
+
+        p -= length;
+        return fail("unknown name '%.*s'", (int)length, p);
+    }
+
+    // right associative, binds tighter than unary minus on its left: -x^2 == -(x^2)
+    int power() {
+        const int base = primary();
+        if (base >= 0 && accept('^'))
+            return op(CutoffFormula::kPow, base, unary());
+        return base;
+    }
+
+    int unary() {
+        if (accept('-'))
+            return op(CutoffFormula::kNeg, unary());
+        if (accept('+'))
+            return unary();
+        return power();
+    }
+
+    int term() {
+        int left = unary();
+        while (left >= 0)
+        {
+            if (accept('*'))
+                left = op(CutoffFormula::kMul, left, unary());
+            else if (accept('/'))
+                left = op(CutoffFormula::kDiv, left, unary());
+            else
+                break;
+        }
+        return left;
+    }
+
+    int expression() {
+        int left = term();
+        while (left >= 0)
+        {
+            if (accept('+'))
+                left = op(CutoffFormula::kAdd, left, term());
+            else if (accept('-'))
+                left = op(CutoffFormula::kSub, left, term());
+            else
+                break;
+        }
+        return left;
+    }
+
+    // [float] [freq =] | [return] expression [;]
+    int formula() {
+        acceptWord("float");
+        const char* const before = p;
+        if (!(acceptWord("freq") && accept('=')))
+            p = before;
+        acceptWord("return");
+
+        const int root = expression();
+        accept(';');
+        skipSpace();
+        if (root >= 0 && *p != '\0')
+            return fail("unexpected '%c'", *p);
+        return root;
+    }
+};
+
+// ----------------------------------------------------------------------------------------------------------------
+
+struct CodeGen {
+    CutoffFormula& f;
+    const std::vector<Node>& nodes;
+    unsigned freeRegisters = (1u << CutoffFormula::kMaxRegisters) - 1;
+    uint64_t literalSlots = 0; // slots holding a literal, the others are overwritten by per-block ops
+    const char* error = nullptr;
+
+    static_assert(CutoffFormula::kMaxSlots <= 64, "literalSlots has one bit per slot");
+
+    int slot(float value) {
+        for (int s = CutoffFormula::kUniformCount; s < f.slotCount; ++s)
+            if ((literalSlots >> s & 1) != 0 && std::memcmp(&f.slots[s], &value, sizeof(float)) == 0)
+                return s;
+        if (f.slotCount == CutoffFormula::kMaxSlots)
+            return error = "too many constants", 0;
+        f.slots[f.slotCount] = value;
+        literalSlots |= uint64_t(1) << f.slotCount;
+        return f.slotCount++;
+    }
+
+    int newSlot() {
+        if (f.slotCount == CutoffFormula::kMaxSlots)
+            return error = "too many constants", 0;
+        f.slots[f.slotCount] = 0.0f;
+        return f.slotCount++;
+    }
+
+    int newRegister() {
+        if (freeRegisters == 0)
+            return error = "formula too deeply nested", 0;
+        int r = 0;
+        while ((freeRegisters & (1u << r)) == 0)
+            ++r;
+        freeRegisters &= ~(1u << r);
+        f.registerCount = std::max(f.registerCount, r + 1);
+        return r;
+    }
+
+    void release(CutoffFormula::Operand operand) {
+        if (operand.kind == CutoffFormula::kRegister)
+            freeRegisters |= 1u << operand.index;
+    }
+
+    CutoffFormula::Op* push(CutoffFormula::Op* ops, int& count) {
+        if (count == CutoffFormula::kMaxOps)
+        {
+            error = "formula too long";
+            return nullptr;
+        }
+        return &ops[count++];
+    }
+
+    CutoffFormula::Operand emit(int index) {
+        const Node& node = nodes[index];
+
+        switch (node.kind)
+        {
+        case kNodeLiteral:
+            return { CutoffFormula::kSlot, (uint8_t)slot(node.value) };
+        case kNodeUniform:
+            return { CutoffFormula::kSlot, (uint8_t)node.index };
+        case kNodeInput:
+            return { CutoffFormula::kInput, (uint8_t)node.index };
+        case kNodeOp:
+            break;
+        }
+
+        const CutoffFormula::Operand a = emit(node.a);
+        const CutoffFormula::Operand b = node.b >= 0 ? emit(node.b) : CutoffFormula::Operand { CutoffFormula::kSlot, 0 };
+        if (error != nullptr)
+            return a;
+
+        if (node.variance == kPerBlock)
+        {
+            CutoffFormula::Op* const op = push(f.scalarOps, f.scalarOpCount);
+            const int dst = newSlot();
+            if (op == nullptr || error != nullptr)
+                return a;
+            *op = { node.code, (uint8_t)dst, a, b };
+            return { CutoffFormula::kSlot, (uint8_t)dst };
+        }
+
+        // children's registers are free again before the result is allocated, ops may run in place
+        release(a);
+        release(b);
+        CutoffFormula::Op* const op = push(f.blockOps, f.blockOpCount);
+        const int dst = newRegister();
+        if (op == nullptr || error != nullptr)
+            return a;
+        *op = { node.code, (uint8_t)dst, a, b };
+        return { CutoffFormula::kRegister, (uint8_t)dst };
+    }
+};
+
+} // namespace
+
+// --------------------------------------------------------------------------------------------------------------------
+
+bool CutoffFormula::compile(const char* text, char* error, std::size_t errorSize)
+{
+    *this = CutoffFormula();
+    slotCount = kUniformCount;
+    if (error != nullptr && errorSize != 0)
+        error[0] = '\0';
+
+    Parser parser(text != nullptr ? text : "");
+    parser.skipSpace();
+    if (*parser.p == '\0')
+        return true;
+
+    const int root = parser.formula();
+    const char* message = parser.failed() ? parser.message : nullptr;
+
+    if (message == nullptr)
+    {
+        CodeGen gen { *this, parser.nodes };
+        Operand result = gen.emit(root);
+
+        // a formula without per-sample terms still fills the block
+        if (gen.error == nullptr && result.kind != kRegister)
+        {
+            Op* const op = gen.push(blockOps, blockOpCount);
+            const int dst = gen.newRegister();
+            if (op != nullptr)
+                *op = { kCopy, (uint8_t)dst, result, result };
+            result = { kRegister, (uint8_t)dst };
+        }
+        resultRegister = result.index;
+        message = gen.error;
+    }
+
+    if (message != nullptr)
+    {
+        if (error != nullptr && errorSize != 0)
+            std::snprintf(error, errorSize, "%s", message);
+        *this = CutoffFormula();
+        return false;
+    }
+
+    compiled = true;
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// evaluation, one loop per op over the whole block
+
+template <typename F>
+static inline void blockLoop(float* dst, const float* a, float as, const float* b, float bs, uint32_t frames, F f)
+{
+    if (a != nullptr && b != nullptr)
+        for (uint32_t i = 0; i < frames; ++i)
+            dst[i] = f(a[i], b[i]);
+    else if (a != nullptr)
+        for (uint32_t i = 0; i < frames; ++i)
+            dst[i] = f(a[i], bs);
+    else if (b != nullptr)
+        for (uint32_t i = 0; i < frames; ++i)
+            dst[i] = f(as, b[i]);
+    else
+        std::fill(dst, dst + frames, f(as, bs));
+}
+
+void CutoffFormula::evaluate(const float uniforms[kUniformCount], const float* env, const float* vacc, float* out,
+                             uint32_t frames, float* registers, uint32_t registerStride) const
+{
+    // per-block part
+    float s[kMaxSlots];
+    std::memcpy(s, uniforms, sizeof(float) * kUniformCount);
+    std::memcpy(s + kUniformCount, slots + kUniformCount, sizeof(float) * (slotCount - kUniformCount));
+    for (int i = 0; i < scalarOpCount; ++i)
+    {
+        const Op& op = scalarOps[i];
+        s[op.dst] = applyScalar(op.code, s[op.a.index], s[op.b.index]);
+    }
+
+    // the last op writes straight into out
+    float* r[kMaxRegisters];
+    for (int k = 0; k < kMaxRegisters; ++k)
+        r[k] = registers + k * registerStride;
+    r[resultRegister] = out;
+
+    const float* const inputs[kInputCount] = { env, vacc };
+    auto array = [&](Operand o) -> const float* {
+        return o.kind == kRegister ? r[o.index] : o.kind == kInput ? inputs[o.index] : nullptr;
+    };
+
+    for (int i = 0; i < blockOpCount; ++i)
+    {
+        const Op& op = blockOps[i];
+        float* const dst = r[op.dst];
+        const float* const a = array(op.a);
+        const float* const b = array(op.b);
+        const float as = op.a.kind == kSlot ? s[op.a.index] : 0.0f;
+        const float bs = op.b.kind == kSlot ? s[op.b.index] : 0.0f;
+
+        switch (op.code)
+        {
+        case kAdd: blockLoop(dst, a, as, b, bs, frames, [](float x, float y) { return x + y; }); break;
+        case kSub: blockLoop(dst, a, as, b, bs, frames, [](float x, float y) { return x - y; }); break;
+        case kMul: blockLoop(dst, a, as, b, bs, frames, [](float x, float y) { return x * y; }); break;
+        case kDiv: blockLoop(dst, a, as, b, bs, frames, [](float x, float y) { return x / y; }); break;
+        case kMin: blockLoop(dst, a, as, b, bs, frames, [](float x, float y) { return x < y ? x : y; }); break;
+        case kMax: blockLoop(dst, a, as, b, bs, frames, [](float x, float y) { return x > y ? x : y; }); break;
+        case kPow: blockLoop(dst, a, as, b, bs, frames, [](float x, float y) { return std::pow(x, y); }); break;
+        case kNeg: blockLoop(dst, a, as, nullptr, 0.0f, frames, [](float x, float) { return -x; }); break;
+        case kAbs: blockLoop(dst, a, as, nullptr, 0.0f, frames, [](float x, float) { return std::fabs(x); }); break;
+        case kSqrt: blockLoop(dst, a, as, nullptr, 0.0f, frames, [](float x, float) { return std::sqrt(x); }); break;
+        case kLog: blockLoop(dst, a, as, nullptr, 0.0f, frames, [](float x, float) { return std::log(x); }); break;
+        case kTanh: blockLoop(dst, a, as, nullptr, 0.0f, frames, [](float x, float) { return std::tanh(x); }); break;
+        case kCopy: blockLoop(dst, a, as, nullptr, 0.0f, frames, [](float x, float) { return x; }); break;
+        case kExp: exp_batch(a, dst, frames); break;
+        }
+    }
+}
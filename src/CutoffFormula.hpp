@@ -0,0 +1,81 @@
+// Runtime-editable cutoff formula, the text form of vcf_env_freq.
+//
+// The text is parsed off the audio thread into a small register program. Literal subexpressions are folded
+// when compiling and the ones that only depend on knobs and formula constants are computed once per block,
+// so what runs per sample is a few whole-block loops that vectorize like the built-in formula does.
+//
+// Per sample: env (VCF envelope, also vcf_env), Vacc (accent sweep) and Vmod, the envmod-scaled envelope
+// exactly as vcf_env_freq derives it. Per block: Vco, Vmod_amt, A, B, C, D, E, base and VaccMul.
+// Operators + - * / ^ and exp log pow sqrt tanh abs min max. A leading "float freq =" or "return", a
+// trailing ';', 'f' literal suffixes and "std::" prefixes are accepted, so the C++ line can be pasted.
+
+#ifndef SYNTH303_CUTOFF_FORMULA_H
+#define SYNTH303_CUTOFF_FORMULA_H
+
+#include <cstddef>
+#include <cstdint>
+
+struct CutoffFormula {
+
+    // the formula vcf_env_freq hardcodes
+    static constexpr const char* kBuiltinText = "(A * Vco + B) * exp(C * Vmod + D * (Vacc * VaccMul) + E) + base";
+
+    // per-block values, in the order evaluate() takes them
+    enum Uniform { kVco, kVmodAmt, kA, kB, kC, kD, kE, kBase, kVaccMul, kUniformCount };
+
+    // per-sample inputs
+    enum Input { kInputEnv, kInputVacc, kInputCount };
+
+    static constexpr int kMaxOps = 64;
+    static constexpr int kMaxSlots = 64;    // scalars: uniforms, literals and per-block results
+    static constexpr int kMaxRegisters = 8; // block-sized temporaries
+
+    enum OpCode : uint8_t { kAdd, kSub, kMul, kDiv, kPow, kMin, kMax, kNeg, kExp, kLog, kSqrt, kTanh, kAbs, kCopy };
+    enum OperandKind : uint8_t { kSlot, kRegister, kInput };
+
+    struct Operand {
+        OperandKind kind;
+        uint8_t index;
+    };
+
+    struct Op {
+        OpCode code;
+        uint8_t dst; // slot for scalar ops, register for block ops
+        Operand a, b;
+    };
+
+    // fixed size and trivially copyable, nothing is allocated once compiled
+    Op scalarOps[kMaxOps];
+    Op blockOps[kMaxOps];
+    float slots[kMaxSlots];
+    int scalarOpCount = 0;
+    int blockOpCount = 0;
+    int slotCount = 0;
+    int registerCount = 0;
+    uint8_t resultRegister = 0;
+    bool compiled = false;
+
+    // true for empty text, which means the built-in vcf_env_freq
+    bool empty() const {
+        return !compiled;
+    }
+
+    // not realtime safe. On errors returns false, writes a message with the column to `error` and
+    // leaves the formula empty.
+    bool compile(const char* text, char* error = nullptr, std::size_t errorSize = 0);
+
+    // realtime safe. `registers` holds kMaxRegisters * registerStride floats and frames <= registerStride;
+    // out must not alias env or vacc.
+    void evaluate(const float uniforms[kUniformCount], const float* env, const float* vacc, float* out,
+                  uint32_t frames, float* registers, uint32_t registerStride) const;
+
+    // single point, for printing limits
+    float evaluate(const float uniforms[kUniformCount], float env, float vacc) const {
+        float registers[kMaxRegisters];
+        float out;
+        evaluate(uniforms, &env, &vacc, &out, 1, registers, 1);
+        return out;
+    }
+};
+
+#endif // SYNTH303_CUTOFF_FORMULA_H
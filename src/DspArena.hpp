@@ -0,0 +1,64 @@
+// Scratch memory for the DSP stages, allocated once in activate() and handed out as
+// cache-aligned slices. Nothing is allocated or freed while processing.
+
+#ifndef SYNTH303_DSP_ARENA_H
+#define SYNTH303_DSP_ARENA_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+struct DspArena {
+
+    static constexpr std::size_t alignment = 64; // one cache line
+
+    unsigned char* data = nullptr;
+    std::size_t capacity = 0;
+    std::size_t used = 0;
+
+    DspArena() = default;
+    DspArena(const DspArena&) = delete;
+    DspArena& operator=(const DspArena&) = delete;
+
+    ~DspArena() {
+        release();
+    }
+
+    static constexpr std::size_t roundUp(std::size_t bytes) {
+        return (bytes + alignment - 1) & ~(alignment - 1);
+    }
+
+    // not realtime safe, grows the arena if needed and rewinds it
+    void reserve(std::size_t bytes) {
+        bytes = roundUp(bytes);
+        used = 0;
+        if (bytes <= capacity)
+            return;
+
+        release();
+        data = static_cast<unsigned char*>(::operator new(bytes, std::align_val_t(alignment)));
+        capacity = bytes;
+    }
+
+    void release() {
+        if (data != nullptr)
+            ::operator delete(data, std::align_val_t(alignment));
+        data = nullptr;
+        capacity = used = 0;
+    }
+
+    // returns a zeroed slice of `count` elements, or nullptr if the arena is too small
+    template <typename T = float>
+    T* take(std::size_t count) {
+        const std::size_t bytes = roundUp(count * sizeof(T));
+        if (used + bytes > capacity)
+            return nullptr;
+
+        T* const ptr = reinterpret_cast<T*>(data + used);
+        std::memset(ptr, 0, bytes);
+        used += bytes;
+        return ptr;
+    }
+};
+
+#endif // SYNTH303_DSP_ARENA_H
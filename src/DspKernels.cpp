@@ -0,0 +1,189 @@
+#include "DistrhoUtils.hpp"
+
+#include "DspKernels.hpp"
+#include "Osc303.hpp"
+#include "AcidFilter.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define SYNTH303_MULTI_ISA 1
+# define SYNTH303_TARGET(isa) __attribute__((target(isa), flatten))
+# define SYNTH303_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+# define SYNTH303_MULTI_ISA 0
+# define SYNTH303_ALWAYS_INLINE inline
+#endif
+
+// flatten inlines the whole call tree of an entry point, AcidFilterStereo::process() and the sst halfband
+// filters included, so none of it stays at the baseline ISA. Only the libm calls (tanhf, powf, exp2f, tanf)
+// remain calls, check with objdump -dr on the object file.
+#if defined(__GNUC__)
+# define SYNTH303_FLATTEN __attribute__((flatten))
+#else
+# define SYNTH303_FLATTEN
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+// kernel bodies, inlined into one entry point per instruction set
+
+static SYNTH303_ALWAYS_INLINE void oscBody(Osc303& osc, const float* pitch, float* square, float* saw, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        osc.setPitchCV(pitch[i]);
+        osc.process(square + i * Osc303::oversampling, saw + i * Osc303::oversampling, Osc303::oversampling);
+    }
+}
+
+static SYNTH303_ALWAYS_INLINE void ladderBody(AcidFilter& filter, const float* freq, float resonance,
+                                              const float* in, float* os, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        filter.calcCoeffs(freq[i], resonance);
+        filter.processOversampled(in + i * AcidFilter::oversampling, os + i * AcidFilter::oversampling);
+    }
+}
+
+static SYNTH303_ALWAYS_INLINE void decimateBody(AcidFilter& filter, float* osL, float* osR, float* out, uint32_t frames)
+{
+    filter.decimate(osL, osR, out, frames);
+}
+
+static SYNTH303_ALWAYS_INLINE void upsampleStereoBody(AcidFilterStereo& filter, const float* inL, const float* inR,
+                                                      float* osL, float* osR, uint32_t frames)
+{
+    filter.upsample(inL, inR, osL, osR, frames);
+}
+
+static SYNTH303_ALWAYS_INLINE void ladderStereoBody(AcidFilterStereo& filter, const float* freq, float resonance,
+                                                    const float* inL, const float* inR, float* osL, float* osR,
+                                                    uint32_t frames)
+{
+    filter.process(freq, resonance, inL, inR, osL, osR, frames);
+}
+
+static SYNTH303_ALWAYS_INLINE void decimateStereoBody(AcidFilterStereo& filter, float* osL, float* osR,
+                                                      float* outL, float* outR, uint32_t frames)
+{
+    filter.decimate(osL, osR, outL, outR, frames);
+}
+
+#define SYNTH303_KERNELS(suffix, attributes)                                                                       \
+    attributes static void osc_##suffix(Osc303& osc, const float* pitch, float* square, float* saw, uint32_t frames) \
+    {                                                                                                              \
+        oscBody(osc, pitch, square, saw, frames);                                                                  \
+    }                                                                                                              \
+    attributes static void ladder_##suffix(AcidFilter& filter, const float* freq, float resonance,                 \
+                                           const float* in, float* os, uint32_t frames)                            \
+    {                                                                                                              \
+        ladderBody(filter, freq, resonance, in, os, frames);                                                       \
+    }                                                                                                              \
+    attributes static void decimate_##suffix(AcidFilter& filter, float* osL, float* osR, float* out, uint32_t frames) \
+    {                                                                                                              \
+        decimateBody(filter, osL, osR, out, frames);                                                               \
+    }                                                                                                              \
+    attributes static void upsampleStereo_##suffix(AcidFilterStereo& filter, const float* inL, const float* inR,   \
+                                                   float* osL, float* osR, uint32_t frames)                        \
+    {                                                                                                              \
+        upsampleStereoBody(filter, inL, inR, osL, osR, frames);                                                    \
+    }                                                                                                              \
+    attributes static void ladderStereo_##suffix(AcidFilterStereo& filter, const float* freq, float resonance,     \
+                                                 const float* inL, const float* inR, float* osL, float* osR,       \
+                                                 uint32_t frames)                                                  \
+    {                                                                                                              \
+        ladderStereoBody(filter, freq, resonance, inL, inR, osL, osR, frames);                                     \
+    }                                                                                                              \
+    attributes static void decimateStereo_##suffix(AcidFilterStereo& filter, float* osL, float* osR,               \
+                                                   float* outL, float* outR, uint32_t frames)                      \
+    {                                                                                                              \
+        decimateStereoBody(filter, osL, osR, outL, outR, frames);                                                  \
+    }
+
+SYNTH303_KERNELS(generic, SYNTH303_FLATTEN)
+#if SYNTH303_MULTI_ISA
+SYNTH303_KERNELS(avx2, SYNTH303_TARGET("avx2,fma"))
+SYNTH303_KERNELS(avx512, SYNTH303_TARGET("avx512f,avx512vl,avx2,fma"))
+#endif
+
+static const DspKernels kKernels[] = {
+    { CpuIsa::Generic, "sse2", osc_generic, ladder_generic, decimate_generic,
+      upsampleStereo_generic, ladderStereo_generic, decimateStereo_generic },
+#if SYNTH303_MULTI_ISA
+    { CpuIsa::AVX2, "avx2", osc_avx2, ladder_avx2, decimate_avx2,
+      upsampleStereo_avx2, ladderStereo_avx2, decimateStereo_avx2 },
+    { CpuIsa::AVX512, "avx512", osc_avx512, ladder_avx512, decimate_avx512,
+      upsampleStereo_avx512, ladderStereo_avx512, decimateStereo_avx512 },
+#endif
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+bool isCpuIsaSupported(CpuIsa isa)
+{
+    switch (isa)
+    {
+    case CpuIsa::Generic:
+        return true;
+#if SYNTH303_MULTI_ISA
+    case CpuIsa::AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case CpuIsa::AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")
+            && isCpuIsaSupported(CpuIsa::AVX2);
+#endif
+    default:
+        return false;
+    }
+}
+
+const char* cpuIsaName(CpuIsa isa)
+{
+    for (const DspKernels& kernels : kKernels)
+        if (kernels.isa == isa)
+            return kernels.name;
+    return isa == CpuIsa::Auto ? "auto" : "unavailable";
+}
+
+CpuIsa detectCpuIsa()
+{
+    CpuIsa best = CpuIsa::Generic;
+    for (int i = (int)CpuIsa::Count - 1; i > 0; --i)
+    {
+        if (isCpuIsaSupported((CpuIsa)i))
+        {
+            best = (CpuIsa)i;
+            break;
+        }
+    }
+
+    if (const char* const forced = std::getenv("SYNTH303_ISA"))
+    {
+        for (int i = 0; i < (int)CpuIsa::Count; ++i)
+        {
+            if (std::strcmp(forced, cpuIsaName((CpuIsa)i)) == 0)
+                return (CpuIsa)i < best ? (CpuIsa)i : best;
+        }
+        d_stderr("SYNTH303_ISA=%s is not known, using %s", forced, cpuIsaName(best));
+    }
+
+    return best;
+}
+
+const DspKernels& getDspKernels(CpuIsa isa)
+{
+    if (isa == CpuIsa::Auto)
+        isa = detectCpuIsa();
+
+    const DspKernels* selected = &kKernels[0];
+    for (const DspKernels& kernels : kKernels)
+    {
+        if (kernels.isa <= isa && isCpuIsaSupported(kernels.isa))
+            selected = &kernels;
+    }
+    return *selected;
+}
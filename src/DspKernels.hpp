@@ -0,0 +1,55 @@
+// Hot DSP loops built for several instruction sets, picked once per activation.
+//
+// The baseline build targets SSE2 on x86_64; DspKernels.cpp compiles the same loops again for
+// AVX2+FMA and AVX-512 and cpuid decides which ones run. Set SYNTH303_ISA=sse2|avx2|avx512
+// in the environment (or Synth303Engine::isaOverride) to force a path for testing.
+
+#ifndef SYNTH303_DSP_KERNELS_H
+#define SYNTH303_DSP_KERNELS_H
+
+#include <cstdint>
+
+struct Osc303;
+struct AcidFilter;
+struct AcidFilterStereo;
+
+enum class CpuIsa {
+    Auto = -1,
+    Generic = 0, // SSE2 on x86_64, whatever the compiler targets elsewhere
+    AVX2,        // AVX2 + FMA
+    AVX512,      // AVX-512F
+    Count
+};
+
+struct DspKernels {
+    CpuIsa isa;
+    const char* name;
+
+    // setPitchCV + 4x oversampled square and saw for every input sample
+    void (*osc)(Osc303& osc, const float* pitch, float* square, float* saw, uint32_t frames);
+
+    // per-sample coefficient update + 4x oversampled ladder
+    void (*ladder)(AcidFilter& filter, const float* freq, float resonance, const float* in, float* os, uint32_t frames);
+
+    // 4x -> 1x half-band decimation, osL/osR are used as scratch
+    void (*decimate)(AcidFilter& filter, float* osL, float* osR, float* out, uint32_t frames);
+
+    // stereo input mode: 1x -> 4x, the ladder on both channels at once and 4x -> 1x
+    void (*upsampleStereo)(AcidFilterStereo& filter, const float* inL, const float* inR, float* osL, float* osR,
+                           uint32_t frames);
+    void (*ladderStereo)(AcidFilterStereo& filter, const float* freq, float resonance, const float* inL, const float* inR,
+                         float* osL, float* osR, uint32_t frames);
+    void (*decimateStereo)(AcidFilterStereo& filter, float* osL, float* osR, float* outL, float* outR, uint32_t frames);
+};
+
+// best instruction set this CPU runs, lowered by SYNTH303_ISA if set
+CpuIsa detectCpuIsa();
+
+bool isCpuIsaSupported(CpuIsa isa);
+
+const char* cpuIsaName(CpuIsa isa);
+
+// kernels for `isa`, falling back to the best supported set below it
+const DspKernels& getDspKernels(CpuIsa isa = CpuIsa::Auto);
+
+#endif // SYNTH303_DSP_KERNELS_H
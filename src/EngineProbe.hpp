@@ -0,0 +1,34 @@
+// Optional observer of the engine's block stages, for tracing and profiling tools.
+// The engine checks for a probe once per stage and block, nothing is called when none is set.
+
+#ifndef SYNTH303_ENGINE_PROBE_H
+#define SYNTH303_ENGINE_PROBE_H
+
+#include <cstdint>
+
+enum class EngineStage {
+    Envelopes,
+    Wow,
+    Coeffs,
+    Osc,
+    Ladder,
+    Decimator,
+    Outputs,
+    Count
+};
+
+static inline const char* engineStageName(EngineStage stage)
+{
+    static const char* const names[] = { "envelopes", "WowFilter", "coeffs", "Osc303", "ladder", "decimator", "outputs" };
+    return stage < EngineStage::Count ? names[(int)stage] : "unknown";
+}
+
+struct EngineProbe {
+    virtual ~EngineProbe() = default;
+
+    // called on the audio thread around every stage, `frames` is the size of the block being rendered
+    virtual void stageBegin(EngineStage stage, uint32_t frames) = 0;
+    virtual void stageEnd(EngineStage stage, uint32_t frames) = 0;
+};
+
+#endif // SYNTH303_ENGINE_PROBE_H
@@ -2,6 +2,8 @@
 #include "chowdsp_dsp_utils/chowdsp_dsp_utils.h"
 #include "chowdsp_filters/chowdsp_filters.h"
 
+#include "SharedTables.hpp"
+
 struct Osc303 {
 
     float pow = 0.0f;
@@ -14,16 +16,19 @@ struct Osc303 {
     float amplitude, targetAmplitude;
     float cv;
 
+    static constexpr int oversampling = 4;
+
     Osc303() {
-        spec.maximumBlockSize = 2048;
+        spec.maximumBlockSize = 2048 * oversampling;
         spec.numChannels = 1;
     }
 
     // set CV value, accepted range is 0v-5.0v
     void setPitchCV(float value) {
         cv = value;
-        saw.setFrequency(16.35 * std::pow(2, value));
-        lp1.calcCoefs(16.35 * std::pow(2, value) * 16, spec.sampleRate);
+        const float hz = osc303PitchTable.lookup(value);
+        saw.setFrequency(hz);
+        lp1.calcCoefs(hz * 16, spec.sampleRate);
         breakpoint = cvToPw(value);
         breakpoint2 = cvToEdge(value);
         amplitude = cvToAmplitude(value);
@@ -68,8 +73,10 @@ struct Osc303 {
         }
     }
 
-    void prepare(float sampleRate, float defaultCV = 1.0) {
-        spec.sampleRate = sampleRate * 4.0;
+    // maxBlockSize is in host samples, the saw runs 4x oversampled
+    void prepare(float sampleRate, uint32_t maxBlockSize = 2048, float defaultCV = 1.0) {
+        spec.sampleRate = sampleRate * oversampling;
+        spec.maximumBlockSize = maxBlockSize * oversampling;
         saw.prepare(spec);
 
         setPitchCV(defaultCV);
@@ -86,7 +93,9 @@ struct Osc303 {
 
     inline float cvToEdge(float in) {
         in /= 5;
-        float out = std::pow(0.94 * in - 1, 4);
+        float x = 0.94 * in - 1;
+        x *= x;
+        float out = x * x;
         out = (out * 0.371393200647557) + 0.0380916103228264;
         // d_stdout("Set edge w for cv %f (%f) to %f", in*5, in, out);
         return out;
@@ -105,7 +114,10 @@ struct Osc303 {
 
     inline float cvToPow(float in) {
         in /= 5;
-        float out = (std::pow(in, 8) + 0.1 * in) * 0.9;
+        float in8 = in * in;
+        in8 *= in8;
+        in8 *= in8;
+        float out = (in8 + 0.1 * in) * 0.9;
         return 33.0 * out + 2.879;
     }
 
@@ -0,0 +1,77 @@
+// Parameter changes on their way to the audio thread.
+//
+// A bounded lock-free FIFO after Dmitry Vyukov's queue: every cell carries a sequence number telling
+// whether it is free for the push of that lap or holds a change for the pop. The audio thread is the only
+// consumer; hosts may set parameters from their UI thread and their audio thread at once, so pushes claim
+// cells with a compare-exchange and several threads may push.
+
+#ifndef SYNTH303_PARAMETER_QUEUE_H
+#define SYNTH303_PARAMETER_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+
+struct ParameterQueue {
+    static constexpr uint32_t kCapacity = 256; // power of two
+
+    struct Change {
+        uint32_t index;
+        float value;
+    };
+
+    ParameterQueue() {
+        for (uint32_t i = 0; i < kCapacity; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // any thread, false when the queue is full and the change was not queued
+    bool push(uint32_t index, float value) {
+        uint32_t position = head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = cells[position & (kCapacity - 1)];
+            const int32_t lap = (int32_t)(cell.sequence.load(std::memory_order_acquire) - position);
+            if (lap == 0)
+            {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.change = { index, value };
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (lap < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // audio thread only
+    bool pop(Change& change) {
+        Cell& cell = cells[tail & (kCapacity - 1)];
+        if ((int32_t)(cell.sequence.load(std::memory_order_acquire) - (tail + 1)) < 0)
+            return false;
+
+        change = cell.change;
+        cell.sequence.store(tail + kCapacity, std::memory_order_release);
+        ++tail;
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        Change change;
+    };
+
+    Cell cells[kCapacity];
+    alignas(64) std::atomic<uint32_t> head { 0 }; // producers
+    alignas(64) uint32_t tail = 0;                // consumer
+};
+
+#endif // SYNTH303_PARAMETER_QUEUE_H
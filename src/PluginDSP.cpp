@@ -6,97 +6,42 @@
  */
 
 #include "DistrhoPlugin.hpp"
-#include "CParamSmooth.hpp"
+#include "DistrhoPluginUtils.hpp"
 
 #include "chowdsp_dsp_utils/chowdsp_dsp_utils.h"
 
-#include "ADAREnvelope.h"
-#include "WowFilter.h"
-#include "Osc303.hpp"
-#include "AcidFilter.hpp"
-#include "SlideFilter.hpp"
+#include "RealtimeMode.hpp"
+#include "StepSequencer.hpp"
+#include "Synth303Engine.hpp"
+#include "Synth303Parameters.hpp"
 
+#include <cstdlib>
+#include <cstring>
 #include <memory>
 
-#include "synth303common.hpp"
-
-#ifndef MIN
-#define MIN(a,b) ( (a) < (b) ? (a) : (b) )
-#endif
-
-#ifndef MAX
-#define MAX(a,b) ( (a) > (b) ? (a) : (b) )
-#endif
-
-#ifndef CLAMP
-#define CLAMP(v, min, max) (MIN((max), MAX((min), (v))))
-#endif
-
-#ifndef DB_CO
-#define DB_CO(g) ((g) > -90.0f ? powf(10.0f, (g) * 0.05f) : 0.0f)
-#endif
-
 START_NAMESPACE_DISTRHO
 
 // --------------------------------------------------------------------------------------------------------------------
 
 class PluginDSP : public Plugin
 {
-    enum Parameters {
-        kParamGain = 0,
-        kParamA,
-        kParamB,
-        kParamC,
-        kParamD,
-        kParamCutoff,
-        kParamResonance,
-        kParamVmod,
-        kParamAccent,
-        kParamDecay,
-        kParamVcfAttack,
-        kParamFormulaA,
-        kParamFormulaB,
-        kParamFormulaC,
-        kParamFormulaD,
-        kParamFormulaE,
-        kParamFormulaBase,
-        kParamFormulaVaccMul,
-        kParamFormulaLimiter,
-        kParamPrintParameters,
-        kParamCount
-    };
-
-    double fSampleRate = getSampleRate();
-    float fGainDB = 0.0f;
-    float fGainLinear = 1.0f;
-    std::unique_ptr<CParamSmooth> fSmoothGain = std::make_unique<CParamSmooth>(20.0f, fSampleRate);
-
-    static constexpr int BLOCK_SIZE{32};
-    float squareBuffer[4];
-    float sawBuffer[4];
-    Osc303 osc = Osc303();
-    AcidFilter filter;
-    WowFilter wowFilter;
-    SlideFilter slideFilter;
-
-    float atkTime = -9.482;
-    float decTime = -2.223;
-
-    float fVco = 12.0;
-    float fRes = 1.0;
-    float fVmod = 1.0;
-    float fVacc_amt = 1.0;
-
-    float A = 1.633001;
-    float B = 0.626000;
-    float C = 0.324000;
-    float D = 0.191000;
-    float E = 4.462000;
-    float base = -119.205;
-    float VaccMul = 2.0;
-
-    sst::surgext_rack::dsp::envelopes::ADAREnvelope vca_env;
-    sst::surgext_rack::dsp::envelopes::ADAREnvelope vcf_env;
+    Synth303Engine engine;
+
+    // the editor finds this through ScopeRegistry with the id from kParamScopeId
+    std::shared_ptr<ScopeRing> scope;
+    uint32_t scopeId;
+
+    // memory locking, thread pinning and callback stats, only for the JACK standalone
+    RealtimeMode realtime;
+
+    // plays its pattern instead of the MIDI input while kParamSequencer is on
+    StepSequencer sequencer;
+    bool sequencerOn = false;
+
+    // the states as last set, for getState(): hosts save them with programs enabled
+    String formulaState;
+    String morphState;
+    String patternState;
 
 public:
    /**
@@ -104,12 +49,23 @@ public:
       You must set all parameter values to their defaults, matching ParameterRanges::def.
     */
     PluginDSP()
-        : Plugin(kParamCount, 0, 0) // parameters, programs, states
+        : Plugin(kParamCount, kFactoryPresetCount, 3), // parameters, programs, states
+          scope(std::make_shared<ScopeRing>()),
+          scopeId(ScopeRegistry::add(scope)),
+          patternState(SequencerPattern::kDefaultText)
     {
+        engine.sampleRateChanged(getSampleRate());
+        engine.scope = scope.get();
+        engine.cvOutputs = false;
+        // note events and activations are printed, from the audio thread too, only for debugging
+        engine.logEvents = std::getenv("SYNTH303_LOG_EVENTS") != nullptr;
+        if (std::strcmp(getPluginFormatName(), "JACK/Standalone") == 0)
+            realtime.configure();
     }
 
     ~PluginDSP() {
-        printParameters();
+        ScopeRegistry::remove(scopeId);
+        engine.printParameters();
     }
 
 protected:
@@ -117,30 +73,6 @@ protected:
     // ----------------------------------------------------------------------------------------------------------------
     // Init
 
-    void printParameters() {
-        d_stdout("---------");
-
-        d_stdout("float atkTime = %f;", atkTime);
-        d_stdout("float decTime = %f;", decTime);
-
-        d_stdout("float fVco = %f;", fVco);
-        d_stdout("float fRes = %f;", fRes);
-        d_stdout("float fVmod = %f;", fVmod);
-        d_stdout("float fVacc_amt = %f;", fVacc_amt);
-
-        d_stdout("float A = %f;", A);
-        d_stdout("float B = %f;", B);
-        d_stdout("float C = %f;", C);
-        d_stdout("float D = %f;", D);
-        d_stdout("float E = %f;", E);
-        d_stdout("float base = %f;", base);
-        d_stdout("float VaccMul = %f;", VaccMul);
-
-        print_limits();
-
-        d_stdout("---------");
-    }
-
    /**
       Initialize the parameter @a index.@n
       This function will be called once, shortly after the plugin is created.
@@ -151,7 +83,7 @@ protected:
         case kParamGain:
             parameter.ranges.min = -90.0f;
             parameter.ranges.max = 30.0f;
-            parameter.ranges.def = -0.0f;
+            parameter.ranges.def = parameterDefault(kParamGain);
             parameter.hints = kParameterIsAutomatable;
             parameter.name = "Gain";
             parameter.shortName = "Gain";
@@ -164,93 +96,175 @@ protected:
         case kParamCutoff:
             parameter.ranges.min = 1.321f;
             parameter.ranges.max = 12.0f;
-            parameter.ranges.def = 12.0f;
+            parameter.ranges.def = parameterDefault(kParamCutoff);
             parameter.name = "Cutoff";
             return;
         case kParamResonance:
             parameter.ranges.min = 0.0f;
             parameter.ranges.max = 1.0f;
-            parameter.ranges.def = 1.0f;
+            parameter.ranges.def = parameterDefault(kParamResonance);
             parameter.name = "Resonance";
             return;
         case kParamVmod:
             parameter.ranges.min = 0.0f;
             parameter.ranges.max = 1.0f;
-            parameter.ranges.def = 1.0f;
+            parameter.ranges.def = parameterDefault(kParamVmod);
             parameter.name = "Envmod";
             return;
         case kParamDecay:
             parameter.ranges.min = -2.223f;
             parameter.ranges.max = 1.32f;
-            parameter.ranges.def = -2.223f;
+            parameter.ranges.def = parameterDefault(kParamDecay);
             parameter.name = "Decay";
             return;
         case kParamVcfAttack:
             parameter.ranges.min = -9.482;
             parameter.ranges.max = -4.0f;
-            parameter.ranges.def = -9.482f;
+            parameter.ranges.def = parameterDefault(kParamVcfAttack);
             parameter.name = "Vcf Attack";
             return;
         case kParamAccent:
             parameter.ranges.min = 0.0f;
             parameter.ranges.max = 1.0f;
-            parameter.ranges.def = 0.0f;
+            parameter.ranges.def = parameterDefault(kParamAccent);
             parameter.name = "Accent";
             return;
-        // float A = 2.243000;
         case kParamFormulaA:
             parameter.ranges.min = 0.0;
             parameter.ranges.max = 10.0;
-            parameter.ranges.def = 2.243;
+            parameter.ranges.def = parameterDefault(kParamFormulaA);
             parameter.name = "A";
             return;
-        // float B = 0.626000;
         case kParamFormulaB:
             parameter.ranges.min = 0.0;
             parameter.ranges.max = 10.0;
-            parameter.ranges.def = 0.626;
+            parameter.ranges.def = parameterDefault(kParamFormulaB);
             parameter.name = "B";
             return;
-        // float C = 0.364000;
         case kParamFormulaC:
             parameter.ranges.min = 0.0;
             parameter.ranges.max = 10.0;
-            parameter.ranges.def = 0.364;
+            parameter.ranges.def = parameterDefault(kParamFormulaC);
             parameter.name = "C";
             return;
-        // float D = 0.25;
         case kParamFormulaD:
             parameter.ranges.min = 0.0;
             parameter.ranges.max = 10.0;
-            parameter.ranges.def = 1.121;
+            parameter.ranges.def = parameterDefault(kParamFormulaD);
             parameter.name = "D";
             return;
-        // float E = 4.462000;
         case kParamFormulaE:
             parameter.ranges.min = 0.0;
             parameter.ranges.max = 10.0;
-            parameter.ranges.def = 4.462;
+            parameter.ranges.def = parameterDefault(kParamFormulaE);
             parameter.name = "E";
             return;
-        // float base = -119.205;
         case kParamFormulaBase:
             parameter.ranges.min = -200.0;
             parameter.ranges.max = 200.0;
-            parameter.ranges.def = -119.205;
+            parameter.ranges.def = parameterDefault(kParamFormulaBase);
             parameter.name = "base";
             return;
         case kParamFormulaVaccMul:
             parameter.ranges.min = 0.0;
             parameter.ranges.max = 20.0;
-            parameter.ranges.def = 2.0;
+            parameter.ranges.def = parameterDefault(kParamFormulaVaccMul);
             parameter.name = "Vacc multiplier";
             return;
         case kParamFormulaLimiter:
-            parameter.hints = kParameterIsOutput;
+            parameter.hints = kParameterIsOutput | kParameterIsBoolean;
+            parameter.name = "Cutoff limited";
+            parameter.symbol = "cutoff_limited";
             return;
         case kParamPrintParameters:
+            // unused, kept so the indices after it stay stable; the UI prints on its own thread
             parameter.name = "foo";
             return;
+        case kParamCvOutputs:
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 1.0f;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable | kParameterIsBoolean | kParameterIsInteger;
+            parameter.name = "CV outputs";
+            parameter.shortName = "CV outs";
+            parameter.symbol = "cv_outputs";
+            return;
+        case kParamScopeId:
+            // which ScopeRing in this process belongs to this instance, meaningless to the host
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 16777215.0f;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsOutput | kParameterIsInteger | kParameterIsHidden;
+            parameter.name = "Scope id";
+            parameter.symbol = "scope_id";
+            return;
+        case kParamStereoInput:
+            // the 303 filter on the audio inputs, left and right out of outputs 1 and 2
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 1.0f;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable | kParameterIsBoolean | kParameterIsInteger;
+            parameter.name = "Stereo input filter";
+            parameter.shortName = "Stereo in";
+            parameter.symbol = "stereo_input";
+            return;
+        case kParamMorph:
+            // blends the knobs between the two presets of the "morph" state
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 1.0f;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable;
+            parameter.name = "Morph";
+            parameter.symbol = "morph";
+            return;
+        case kParamSequencer:
+            // the "pattern" state on the host transport, the MIDI input is ignored meanwhile
+            parameter.ranges.min = 0.0f;
+            parameter.ranges.max = 1.0f;
+            parameter.ranges.def = 0.0f;
+            parameter.hints = kParameterIsAutomatable | kParameterIsBoolean | kParameterIsInteger;
+            parameter.name = "Step sequencer";
+            parameter.shortName = "Sequencer";
+            parameter.symbol = "sequencer";
+            return;
+        }
+    }
+
+   /**
+      Set the name of the program @a index.@n
+      This function will be called once, shortly after the plugin is created.
+    */
+    void initProgramName(uint32_t index, String& programName) override
+    {
+        if (index < kFactoryPresetCount)
+            programName = kFactoryPresets[index].name;
+    }
+
+   /**
+      Initialize the state @a index.@n
+      This function will be called once, shortly after the plugin is created.
+    */
+    void initState(uint32_t index, State& state) override
+    {
+        switch (index) {
+        case 0:
+            // cutoff formula text, empty for the built-in one
+            state.key = "formula";
+            state.defaultValue = "";
+            state.label = "Cutoff formula";
+            return;
+        case 1:
+            // two presets in the compact format separated by a space, the ends of kParamMorph
+            state.key = "morph";
+            state.defaultValue = "";
+            state.label = "Morph presets";
+            return;
+        case 2:
+            // steps of the built-in sequencer, see StepSequencer.hpp
+            state.key = "pattern";
+            state.defaultValue = SequencerPattern::kDefaultText;
+            state.label = "Sequencer pattern";
+            return;
         }
     }
 
@@ -263,18 +277,11 @@ protected:
     */
     float getParameterValue(uint32_t index) const override
     {
-        switch (index) {
-        case kParamD:
-            return 0.314f;
-        case kParamGain:
-            return fGainDB;
-        }
-    }
-
-    void print_limits() {
-        float freq_min = vcf_env_freq(0.0, fVco, fVmod, 0.0, A, B, C, D, E, base, VaccMul);
-        float freq_max = vcf_env_freq(1.01, fVco, fVmod, 0.0, A, B, C, D, E, base, VaccMul);
-        d_stdout("Freq min %f Freq max %f", freq_min, freq_max);
+        if (index == kParamScopeId)
+            return (float)scopeId;
+        if (index == kParamSequencer)
+            return sequencerOn ? 1.0f : 0.0f;
+        return engine.getParameter(index);
     }
 
    /**
@@ -285,71 +292,76 @@ protected:
     */
     void setParameterValue(uint32_t index, float value) override
     {
-        switch (index) {
-        case kParamGain:
-            fGainDB = value;
-            fGainLinear = DB_CO(CLAMP(value, -90.0, 30.0));
-            break;
-        case kParamCutoff:
-            fVco = value;
-            d_stdout("fVco %f", fVco);
-            // d_stdout("Min %0.3fHz Max %0.3f", vcf_env_freq(0.0, fVco, fVmod), vcf_env_freq(1.01, fVco, fVmod));
-            break;
-        case kParamResonance:
-            fRes = value;
-            d_stdout("fRes %f", fRes);
-            break;
-        case kParamVmod:
-            fVmod = value;
-            d_stdout("fVmod %f", fVmod);
-            // d_stdout("Min %0.3fHz Max %0.3f", vcf_env_freq(0.0, fVco, fVmod), vcf_env_freq(1.01, fVco, fVmod));
-            break;
-        case kParamAccent:
-            fVacc_amt = value;
-            d_stdout("fVacc_amt %f", fVacc_amt);
-            break;
-        case kParamDecay:
-            decTime = value;
-            d_stdout("decTime %f", decTime);
-            break;
-        case kParamVcfAttack:
-            atkTime = value;
-            d_stdout("atkTime %f", atkTime);
-            break;
-        case kParamFormulaA:
-            A = value;
-            d_stdout("DSP A %f", A);
-            break;
-        case kParamFormulaB:
-            B = value;
-            d_stdout("DSP B %f", B);
-            break;
-        case kParamFormulaC:
-            C = value;
-            d_stdout("DSP C %f", C);
-            break;
-        case kParamFormulaD:
-            D = value;
-            d_stdout("DSP D %f", D);
-            break;
-        case kParamFormulaE:
-            E = value;
-            d_stdout("DSP E %f", E);
-            break;
-        case kParamFormulaBase:
-            base = value;
-            d_stdout("DSP base %f", base);
-            break;
-        case kParamFormulaVaccMul:
-            VaccMul = value;
-            d_stdout("DSP VaccMul %f", VaccMul);
-            break;
-        case kParamPrintParameters:
-            printParameters();
-            break;
-        }
+        if (index == kParamSequencer)
+            sequencerOn = value > 0.5f;
+        else
+            engine.setParameter(index, value);
+    }
 
-        print_limits();
+   /**
+      Load a program.@n
+      The parameters glide to the preset like automation does, so switching mid-pattern does not click.
+    */
+    void loadProgram(uint32_t index) override
+    {
+        if (index < kFactoryPresetCount)
+            engine.applyPreset(kFactoryPresets[index].preset);
+    }
+
+   /**
+      Get the value of an internal state.@n
+      The host may call this function from any non-realtime context.
+    */
+    String getState(const char* key) const override
+    {
+        if (std::strcmp(key, "formula") == 0)
+            return formulaState;
+        if (std::strcmp(key, "morph") == 0)
+            return morphState;
+        if (std::strcmp(key, "pattern") == 0)
+            return patternState;
+        return String();
+    }
+
+   /**
+      Change an internal state @a key to @a value.@n
+      Never called from the audio thread, the formula is compiled here and picked up by the next run().
+    */
+    void setState(const char* key, const char* value) override
+    {
+        if (std::strcmp(key, "formula") == 0)
+        {
+            char error[128];
+            if (!engine.setFormula(value, error, sizeof(error)))
+                d_stderr("Cutoff formula not applied: %s", error);
+            else
+                formulaState = value;
+        }
+        else if (std::strcmp(key, "morph") == 0)
+        {
+            Synth303Preset a, b;
+            const char* const second = std::strchr(value, ' ');
+            if (second == nullptr || !a.decode(value) || !b.decode(second + 1))
+            {
+                if (value[0] != '\0')
+                    d_stderr("Morph presets not applied: expected two presets");
+                return;
+            }
+            engine.setMorph(a, b);
+            morphState = value;
+        }
+        else if (std::strcmp(key, "pattern") == 0)
+        {
+            char error[128];
+            SequencerPattern pattern;
+            if (!pattern.parse(value, error, sizeof(error)))
+            {
+                d_stderr("Sequencer pattern not applied: %s", error);
+                return;
+            }
+            sequencer.setPattern(pattern);
+            patternState = value;
+        }
     }
 
     // ----------------------------------------------------------------------------------------------------------------
@@ -360,132 +372,66 @@ protected:
     */
     void activate() override
     {
-        fSmoothGain->flush();
-
-        osc.prepare(getSampleRate());
-        osc.setPitchCV(1.0f);
+        engine.activate(getSampleRate(), getBufferSize());
+        realtime.activate();
 
-        vca_env.activate(getSampleRate());
-        vcf_env.activate(getSampleRate());
-        wowFilter.prepare(getSampleRate());
-        slideFilter.prepare(getSampleRate());
-
-        filter.prepare(getSampleRate(), 300.0, 0.66);
-
-        d_stdout("DSP Activate @ %.0fHz (%d samples)", getSampleRate(), getBufferSize());
+        // no stdio in activate()/deactivate() unless debugging, some hosts call them from the audio thread
+        if (engine.logEvents)
+            d_stdout("DSP Activate @ %.0fHz (%d samples)", getSampleRate(), getBufferSize());
     }
 
     void deactivate() override
     {
-        d_stdout("DSP Deactivate");
+        realtime.report(getBufferSize(), getSampleRate());
+        if (engine.logEvents)
+            d_stdout("DSP Deactivate");
     }
 
-    // long int total_frames;
-    // bool hiOrLo = false;
-    bool gate;
-    bool accent;
-    bool slide;
-
-    int nextGateOff = -1;
-    float note_cv;
    /**
       Run/process function for plugins without MIDI input.
       @note Some parameters might be null if there are no audio inputs or outputs.
     */
     void run(const float** inputs, float** outputs, uint32_t frames, const MidiEvent* midiEvents, uint32_t midiEventCount) override
     {
-        // get the left and right audio inputs
-        const float* const inpL = inputs[0];
-        const float* const inpR = inputs[1];
-
-        // get the left and right audio outputs
-        float* const outL = outputs[0];
-        float* const outR = outputs[1];
-
-        for (int m = 0; m < midiEventCount; ++m)
-        {   
-            uint8_t b0 = midiEvents[m].data[0]; // status + channel
-            uint8_t b1 = midiEvents[m].data[1]; // note
-            uint8_t b2 = midiEvents[m].data[2]; // velocity
-            // d_stdout("0x%x %d %d", b0, b1, b2);
-            // if ((b0 != 0x90) || (b0 != 0x80)) {
-            //     d_stdout("Blaaa");
-            //     continue;
-            // }
-            if (b0 == 0x90) {
-                if (nextGateOff == -1) {
-                    d_stdout("Gate ON after rest, disable slide, nextGateOff is %d", b1);
-                    nextGateOff = b1;
-                    accent = b2 > 100;
-                    gate = true;
-                    slide = false;
-                    if (accent) d_stdout("Accent!");
-                    note_cv = (std::clamp((int)b1, 12, 72) - 12) / 12.0;
-                    vcf_env.attackFrom(0.0f, 3, false, false); // from, shape, isDigital, isGated
-                    vca_env.attackFrom(0.0f, 1, false, false); // from, shape, isDigital, isGated
-                } else {
-                    d_stdout("Gate ON Slide to %d, nextGateOff is %d", b1, b1);
-                    nextGateOff = b1;
-                    slide = true;
-                    note_cv = (std::clamp((int)b1, 12, 72) - 12) / 12.0;
-                }
-                // osc.setPitchCV(note_cv);
-                // d_stdout("Note: %d CV %f", b1, note_cv);
-            }
-            if (b0 == 0x80) {
-                if (b1 == nextGateOff) {
-                    d_stdout("Gate OFF (%d)", b1);
-                    gate = false;
-                    nextGateOff = -1;
-                } else {
-                    d_stdout("Ignored off for %d != %d", b1, nextGateOff);
-                }
-            }
+        // the left and right audio inputs only feed the stereo input filter mode
+        const double start = realtime.begin();
 
-            // gate = _gate;
-            // bool _gate =  (0x90 & midiEvents[m].data[0]) ? true : false;
-            // uint8_t note = midiEvents[m].data[1];
-            // bool _accent = midiEvents[m].data[2] > 110 ? true : false;
+        sequencer.schedule(getTransport(), getSampleRate(), frames, sequencerOn);
+        if (sequencerOn)
+        {
+            engine.run(outputs, frames, sequencer.events, sequencer.eventCount, inputs);
         }
-
-        wowFilter.setResonancePot(fRes);
-
-        // apply gain against all samples
-        for (uint32_t i=0; i < frames; ++i)
+        else
         {
-            vcf_env.process(atkTime, accent ? -2.223 : decTime, 3, 1, false); // atk, dec, atk shape, dec shape, gate
-
-            // if ((i % BLOCK_SIZE) == 0) {
-                // update coefs
-            float Vacc = wowFilter.processSample(accent ? vcf_env.output * fVacc_amt : 0.0f);
-            float freq = vcf_env_freq(vcf_env.output, fVco, fVmod, Vacc, A, B, C, D, E, base, VaccMul);
-            if (freq >= (getSampleRate() / 2.0)) {
-                d_stdout("!!!!! limit freq %f", freq);
-            }
-            freq = std::clamp((double)freq, 1.0, getSampleRate() / 2.0);
-            filter.calcCoeffs(freq, fRes);
-            // }
-
-            slideFilter.processSample(note_cv);
-            osc.setPitchCV((slide ? slideFilter.lastSample : note_cv));
-
-            osc.process(squareBuffer, sawBuffer, 4);
-            float filt;
-            // square
-            // filt = filter.processSample(squareBuffer);
-            // saw
-            filt = filter.processSample(sawBuffer);
+            // just switched off, the note the sequencer held ends before the MIDI input takes over
+            for (uint32_t i = 0; i < sequencer.eventCount; ++i)
+                engine.midiEvent(sequencer.events[i].data[0], sequencer.events[i].data[1], sequencer.events[i].data[2]);
+            engine.run(outputs, frames, midiEvents, midiEventCount, inputs);
+        }
 
-            vca_env.process(-10.2877, gate ? std::log2(10.0f) : -7.38f, 1, 1, false); // atk, dec, atk shape, dec shape, gate
+        realtime.end(start, frames, getSampleRate());
+    }
 
-            float lastVCAEnv = vca_env.output;
-            const float gain = fSmoothGain->process(fGainLinear);
+    // song position in quarter notes; without bar/beat/tick from the host it is counted from the frame at 120 BPM
+    SequencerTransport getTransport() const
+    {
+        const TimePosition& position = getTimePosition();
+        SequencerTransport transport;
+        transport.playing = position.playing;
+        transport.frame = position.frame;
 
-            outputs[0][i] = filt * lastVCAEnv * gain;
-            outputs[1][i] = gate ? 1.0 : 0.0;
-            outputs[2][i] = (slide ? slideFilter.lastSample : note_cv) / 5.0;
-            outputs[3][i] = freq/(getSampleRate() / 2.0);
+        if (position.bbt.valid && position.bbt.beatsPerMinute > 0.0)
+        {
+            const double quarters = 4.0 / position.bbt.beatType;
+            transport.bpm = position.bbt.beatsPerMinute;
+            transport.beat = quarters * ((position.bbt.bar - 1) * position.bbt.beatsPerBar + (position.bbt.beat - 1)
+                                         + position.bbt.tick / position.bbt.ticksPerBeat);
+        }
+        else
+        {
+            transport.beat = position.frame * transport.bpm / (60.0 * getSampleRate());
         }
+        return transport;
     }
 
     // ----------------------------------------------------------------------------------------------------------------
@@ -498,8 +444,7 @@ protected:
     */
     void sampleRateChanged(double newSampleRate) override
     {
-        fSampleRate = newSampleRate;
-        fSmoothGain->setSampleRate(newSampleRate);
+        engine.sampleRateChanged(newSampleRate);
     }
 
     // ----------------------------------------------------------------------------------------------------------------
@@ -10,10 +10,19 @@
 
 #include "implot.h"
 
-#include "ADAREnvelope.h"
-#include "WowFilter.h"
-
+#include "CurveWorker.hpp"
+#include "CutoffFormula.hpp"
+#include "ScopeRing.hpp"
+#include "StepSequencer.hpp"
 #include "synth303common.hpp"
+#include "Synth303Parameters.hpp"
+#include "Synth303Preset.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 
 START_NAMESPACE_DISTRHO
 
@@ -21,56 +30,87 @@ START_NAMESPACE_DISTRHO
 
 class PluginUI : public UI
 {
-    enum Parameters {
-        kParamGain = 0,
-        kParamA,
-        kParamB,
-        kParamC,
-        kParamD,
-        kParamCutoff,
-        kParamResonance,
-        kParamVmod,
-        kParamAccent,
-        kParamDecay,
-        kParamVcfAttack,
-        kParamFormulaA,
-        kParamFormulaB,
-        kParamFormulaC,
-        kParamFormulaD,
-        kParamFormulaE,
-        kParamFormulaBase,
-        kParamFormulaVaccMul,
-        kParamFormulaLimiter,
-        kParamPrintParameters,
-        kParamCount
-    };
-
-    float fGain = 0.0f;
+    float fGain = parameterDefault(kParamGain);
     float fOutputParam = 0.0f;
     ResizeHandle fResizeHandle;
-    float fVco = 12.0;
-    float fRes = 1.0;
-    float fVmod = 1.0;
-    float fVacc_amt = 1.0;
+    float fVco = parameterDefault(kParamCutoff);
+    float fRes = parameterDefault(kParamResonance);
+    float fVmod = parameterDefault(kParamVmod);
+    float fVacc_amt = parameterDefault(kParamAccent);
 
     bool accent = true;
-
-    sst::surgext_rack::dsp::envelopes::ADAREnvelope vcf_env;
-    WowFilter wowFilter;
-
-    float atkTime = -9.482;
-    float decTime = -2.223;
-
-    float A = 1.633001;
-    float B = 0.626000;
-    float C = 0.324000;
-    float D = 0.191000;
-    float E = 4.462000;
-    float base = -119.205;
-    float VaccMul = 2.0;
+    bool cvOutputs = false;
+    bool stereoInput = false;
+
+    float atkTime = parameterDefault(kParamVcfAttack);
+    float decTime = parameterDefault(kParamDecay);
+
+    float A = parameterDefault(kParamFormulaA);
+    float B = parameterDefault(kParamFormulaB);
+    float C = parameterDefault(kParamFormulaC);
+    float D = parameterDefault(kParamFormulaD);
+    float E = parameterDefault(kParamFormulaE);
+    float base = parameterDefault(kParamFormulaBase);
+    float VaccMul = parameterDefault(kParamFormulaVaccMul);
     
     bool do_update = true;
 
+    // factory bank and the two ends of the morph; the DSP does not report the knobs it moves, so the
+    // editor blends its own copy of the pair to follow kParamMorph
+    int program = 0;
+    float morph = 0.0f;
+    Synth303Morph morphPair;
+
+    // built-in sequencer, the text is checked here before it goes to the DSP
+    bool sequencerOn = false;
+    char patternText[256] = "";
+    char patternError[128] = "";
+
+    // the DSP side compiles its own copy, this one draws the plot and checks the text before sending it
+    char formulaText[1024] = "";
+    char formulaError[128] = "";
+    CutoffFormula formula;
+
+    // the curves are simulated off the UI thread, do_update posts the current settings
+    CurveWorker curveWorker;
+    bool plotAccentPair = false;
+    bool plotEnvmodSweep = false;
+    bool plotShortDecay = false;
+    int plotFrames = 0;
+
+    // what the engine renders, streamed through the DSP instance's ScopeRing. The ring is only found when
+    // the editor lives in the same process as the DSP, the id arrives as the kParamScopeId output.
+    static constexpr int kScopeHistory = 1536; // frames of ScopeRing::kDecimation samples, ~1 s at 48 kHz
+    std::shared_ptr<ScopeRing> scope;
+    uint32_t scopeId = 0;
+    bool showScope = false;
+    bool scopeReading = false; // attach() succeeded, another editor of the same instance may hold the ring
+    int scopeFrames = 0;
+    float scopeTime[kScopeHistory];
+    float scopeAudioMin[kScopeHistory];
+    float scopeAudioMax[kScopeHistory];
+    float scopeFreq[kScopeHistory];
+    float scopeEnv[kScopeHistory];
+    float scopeWow[kScopeHistory];
+    float scopeGate[kScopeHistory];
+    std::chrono::steady_clock::time_point lastScopeFrame;
+
+    // The widget repaints on every idle callback, 60 times a second. Instead, input, parameter and state
+    // changes and new curves each draw a few frames (ImGui settles hover and layout over more than one), a
+    // held control or an active text field keeps drawing at up to kAnimationFps and an idle window draws
+    // nothing at all.
+    static constexpr int kEventFrames = 3;
+    static constexpr double kAnimationFps = 30.0;
+    int redrawFrames = kEventFrames;
+    bool animating = false; // from ImGui's state at the end of the last frame
+    std::chrono::steady_clock::time_point lastAnimationFrame;
+
+    // SYNTH303_UI_STATS=1 prints frames and drawing time every few seconds, for measuring an idle editor
+    bool printStats = false;
+    uint32_t statsFrames = 0;
+    double statsDrawSeconds = 0.0;
+    std::chrono::steady_clock::time_point statsStart = std::chrono::steady_clock::now();
+
     // inline float vcf_env_freq(float vcf_env, float Vco, float Vmod_amt, float Vacc) {
     //     float Vmod_scale = 6.9*Vmod_amt+1.3;
     //     float Vmod_bias = -1.2*Vmod_amt+3;
@@ -92,6 +132,8 @@ public:
         : UI(DISTRHO_UI_DEFAULT_WIDTH, DISTRHO_UI_DEFAULT_HEIGHT),
           fResizeHandle(this)
     {   
+        std::snprintf(patternText, sizeof(patternText), "%s", SequencerPattern::kDefaultText);
+
         ImPlot::CreateContext();
         setGeometryConstraints(DISTRHO_UI_DEFAULT_WIDTH, DISTRHO_UI_DEFAULT_HEIGHT, true);
 
@@ -99,11 +141,15 @@ public:
         if (isResizable())
             fResizeHandle.hide();
 
-        vcf_env.activate(getSampleRate());
-        wowFilter.prepare(getSampleRate());
+        curveWorker.start();
+
+        const char* const stats = std::getenv("SYNTH303_UI_STATS");
+        printStats = stats != nullptr && std::atoi(stats) != 0;
     }
 
     ~PluginUI() {
+        detachScope();
+        curveWorker.stop();
         ImPlot::DestroyContext();
 
         // d_stdout("float Vco = %f;", Vco);
@@ -123,38 +169,321 @@ protected:
         switch (index) {
         case kParamGain:
             fGain = value;
-            repaint();
+            redraw();
             return;
         case kParamD:
             fOutputParam = value;
             return;
+        case kParamCvOutputs:
+            cvOutputs = value > 0.5f;
+            redraw();
+            return;
+        case kParamStereoInput:
+            stereoInput = value > 0.5f;
+            redraw();
+            return;
+        case kParamSequencer:
+            sequencerOn = value > 0.5f;
+            redraw();
+            return;
+        case kParamMorph:
+            morph = value;
+            if (morphPair.ready)
+                showPreset(morphPair.at(morph));
+            redraw();
+            return;
+        case kParamScopeId:
+            if ((uint32_t)value != scopeId) {
+                scopeId = (uint32_t)value;
+                setScope(ScopeRegistry::find(scopeId));
+            }
+            return;
+        }
+
+        // inputs of the cutoff curve
+        float* curveParam = nullptr;
+        switch (index) {
+        case kParamCutoff: curveParam = &fVco; break;
+        case kParamResonance: curveParam = &fRes; break;
+        case kParamVmod: curveParam = &fVmod; break;
+        case kParamAccent: curveParam = &fVacc_amt; break;
+        case kParamDecay: curveParam = &decTime; break;
+        case kParamVcfAttack: curveParam = &atkTime; break;
+        case kParamFormulaA: curveParam = &A; break;
+        case kParamFormulaB: curveParam = &B; break;
+        case kParamFormulaC: curveParam = &C; break;
+        case kParamFormulaD: curveParam = &D; break;
+        case kParamFormulaE: curveParam = &E; break;
+        case kParamFormulaBase: curveParam = &base; break;
+        case kParamFormulaVaccMul: curveParam = &VaccMul; break;
+        }
+        if (curveParam != nullptr && *curveParam != value) {
+            *curveParam = value;
+            do_update = true;
+            redraw();
+        }
+    }
+
+   /**
+      A program has been loaded on the plugin side.@n
+      This is called by the host to inform the UI about program changes.
+    */
+    void programLoaded(uint32_t index) override
+    {
+        if (index < kFactoryPresetCount) {
+            program = (int)index;
+            showPreset(kFactoryPresets[index].preset);
+        }
+    }
+
+   /**
+      The host changed the sample rate, the curve is simulated at the plugin's rate.
+    */
+    void sampleRateChanged(double) override
+    {
+        do_update = true;
+        redraw();
+    }
+
+   /**
+      A state has changed on the plugin side.@n
+      This is called by the host to inform the UI about state changes.
+    */
+    void stateChanged(const char* key, const char* value) override
+    {
+        if (std::strcmp(key, "formula") == 0) {
+            std::snprintf(formulaText, sizeof(formulaText), "%s", value);
+            formula.compile(formulaText, formulaError, sizeof(formulaError));
+            do_update = true;
+            redraw();
+        } else if (std::strcmp(key, "morph") == 0) {
+            Synth303Preset a, b;
+            const char* const second = std::strchr(value, ' ');
+            if (second != nullptr && a.decode(value) && b.decode(second + 1))
+                morphPair.prepare(a, b);
+        } else if (std::strcmp(key, "pattern") == 0) {
+            std::snprintf(patternText, sizeof(patternText), "%s", value);
+            patternError[0] = '\0';
+            redraw();
         }
     }
 
-    float plot_accent_y[48000];
-    void plot_vcf_env(float* dest_x, float* dest_y, int size) {
-        vcf_env.immediatelyEnd();
-        vcf_env.attackFrom(0.0f, 3, false, false);
+    // the knobs as one preset, in Synth303Preset::kParams order
+    Synth303Preset currentPreset() const {
+        Synth303Preset preset;
+        const float values[Synth303Preset::kValueCount] = {
+            fGain, fVco, fRes, fVmod, fVacc_amt, decTime, atkTime, A, B, C, D, E, base, VaccMul,
+        };
+        std::copy(values, values + Synth303Preset::kValueCount, preset.values);
+        return preset;
+    }
+
+    void showPreset(const Synth303Preset& preset) {
+        for (int i = 0; i < Synth303Preset::kValueCount; ++i)
+            parameterChanged(Synth303Preset::kParams[i], preset.values[i]);
+    }
+
+    // the DSP glides to each value, so this is as click free as automation
+    void sendPreset(const Synth303Preset& preset) {
+        showPreset(preset);
+        for (int i = 0; i < Synth303Preset::kValueCount; ++i)
+            setParameterValue(Synth303Preset::kParams[i], preset.values[i]);
+    }
+
+    // the current knobs become one end of the morph
+    void storeMorph(bool first) {
+        const Synth303Preset current = currentPreset();
+        morphPair.prepare(first || !morphPair.ready ? current : morphPair.a,
+                          !first || !morphPair.ready ? current : morphPair.b);
+
+        char text[2 * Synth303Preset::kEncodedSize];
+        morphPair.a.encode(text);
+        text[Synth303Preset::kEncodedSize - 1] = ' ';
+        morphPair.b.encode(text + Synth303Preset::kEncodedSize);
+        setState("morph", text);
+    }
+
+    // a pattern that does not parse stays in the field with the error, the DSP keeps playing the old one
+    void applyPattern() {
+        SequencerPattern pattern;
+        if (pattern.parse(patternText, patternError, sizeof(patternError)))
+            setState("pattern", patternText);
+    }
+
+    // a text that does not parse keeps the current formula on both sides
+    void applyFormula() {
+        CutoffFormula next;
+        if (next.compile(formulaText, formulaError, sizeof(formulaError))) {
+            formula = next;
+            setState("formula", formulaText);
+        }
+    }
+
+    void printParameters() {
+        print_parameters(atkTime, decTime, fVco, fRes, fVmod, fVacc_amt, A, B, C, D, E, base, VaccMul, &formula);
+    }
+
+    void redraw() {
+        redrawFrames = kEventFrames;
+    }
+
+    void setScope(std::shared_ptr<ScopeRing> next) {
+        detachScope();
+        scope = std::move(next);
+        scopeFrames = 0;
+        if (showScope)
+            attachScope();
+        redraw();
+    }
 
-        for (int i = 0; i < size; ++i)
+    // the ring takes one reader; a second editor of the instance shows a note and tries again from idle
+    void attachScope() {
+        if (scope == nullptr || scopeReading || !scope->attach())
+            return;
+        scopeReading = true;
+        scopeFrames = 0;
+    }
+
+    void detachScope() {
+        if (scopeReading)
+            scope->detach();
+        scopeReading = false;
+    }
+
+    // appends whatever the engine pushed since the last call to the history, dropping the oldest frames
+    void drainScope() {
+        ScopeFrame frames[kScopeHistory];
+        const int count = (int)scope->pop(frames, kScopeHistory);
+        if (count == 0)
+            return;
+
+        const int keep = std::min(scopeFrames, kScopeHistory - count);
+        const int from = scopeFrames - keep;
+        float* const columns[] = { scopeAudioMin, scopeAudioMax, scopeFreq, scopeEnv, scopeWow, scopeGate };
+        for (float* column : columns)
+            std::memmove(column, column + from, keep * sizeof(float));
+
+        for (int i = 0; i < count; ++i)
         {
-            vcf_env.process(atkTime, decTime, 3, 1, false);
-            float Vacc = wowFilter.processSample(accent ? vcf_env.output * fVacc_amt : 0.0f);
-            plot_accent_y[i] = Vacc;
-            float freq = vcf_env_freq(vcf_env.output, fVco, fVmod, Vacc, A, B, C, D, E, base, VaccMul);
-            dest_x[i] = i;
-            dest_y[i] = freq;
+            scopeAudioMin[keep + i] = frames[i].audioMin;
+            scopeAudioMax[keep + i] = frames[i].audioMax;
+            scopeFreq[keep + i] = frames[i].freq;
+            scopeEnv[keep + i] = frames[i].env;
+            scopeWow[keep + i] = frames[i].wow;
+            scopeGate[keep + i] = frames[i].gate ? 1.0f : 0.0f;
         }
+        scopeFrames = keep + count;
+
+        // seconds before the newest frame
+        const float step = ScopeRing::kDecimation / (float)getSampleRate();
+        for (int i = 0; i < scopeFrames; ++i)
+            scopeTime[i] = (i - scopeFrames + 1) * step;
+    }
+
+    void postCurves() {
+        CurveRequest request;
+        request.sampleRate = getSampleRate();
+        request.fVco = fVco;
+        request.fRes = fRes;
+        request.fVmod = fVmod;
+        request.fVacc_amt = fVacc_amt;
+        request.atkTime = atkTime;
+        request.decTime = decTime;
+        request.A = A;
+        request.B = B;
+        request.C = C;
+        request.D = D;
+        request.E = E;
+        request.base = base;
+        request.VaccMul = VaccMul;
+        request.accent = accent;
+        request.formula = formula;
+        request.accentPair = plotAccentPair;
+        request.envmodSweep = plotEnvmodSweep;
+        request.shortDecay = plotShortDecay;
+        curveWorker.post(request);
     }
 
     // ----------------------------------------------------------------------------------------------------------------
     // Widget Callbacks
 
+    void idleCallback() override
+    {
+        if (curveWorker.hasNewCurves())
+            redrawFrames = std::max(redrawFrames, 1);
+
+        // the scope draws at the animation rate while the engine has something to show
+        const auto now = std::chrono::steady_clock::now();
+        if (showScope && !scopeReading)
+            attachScope();
+        if (scopeReading && !scope->empty()
+            && now - lastScopeFrame >= std::chrono::duration<double>(1.0 / kAnimationFps)) {
+            lastScopeFrame = now;
+            drainScope();
+            redrawFrames = std::max(redrawFrames, 1);
+        }
+
+        if (redrawFrames > 0) {
+            repaint();
+        } else if (animating && now - lastAnimationFrame >= std::chrono::duration<double>(1.0 / kAnimationFps)) {
+            lastAnimationFrame = now;
+            repaint();
+        }
+
+        if (printStats && now - statsStart >= std::chrono::seconds(5)) {
+            const double seconds = std::chrono::duration<double>(now - statsStart).count();
+            d_stdout("editor: %u frames, %.1f ms drawing in %.1f s, %.2f%% of a core",
+                     statsFrames, statsDrawSeconds * 1e3, seconds, 100.0 * statsDrawSeconds / seconds);
+            statsFrames = 0;
+            statsDrawSeconds = 0.0;
+            statsStart = now;
+        }
+    }
+
+    void onDisplay() override
+    {
+        const auto start = std::chrono::steady_clock::now();
+        UI::onDisplay();
+        statsDrawSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++statsFrames;
+
+        if (redrawFrames > 0)
+            --redrawFrames;
+    }
+
+    bool onMouse(const MouseEvent& event) override
+    {
+        redraw();
+        return UI::onMouse(event);
+    }
+
+    bool onMotion(const MotionEvent& event) override
+    {
+        redraw();
+        return UI::onMotion(event);
+    }
+
+    bool onScroll(const ScrollEvent& event) override
+    {
+        redraw();
+        return UI::onScroll(event);
+    }
+
+    bool onKeyboard(const KeyboardEvent& event) override
+    {
+        redraw();
+        return UI::onKeyboard(event);
+    }
+
+    void onResize(const ResizeEvent& event) override
+    {
+        redraw();
+        UI::onResize(event);
+    }
+
    /**
       ImGui specific onDisplay function.
     */
-    float plot_vcf_x[48000];
-    float plot_vcf_y[48000];
     void onImGuiDisplay() override
     {
         const float width = getWidth();
@@ -166,6 +495,45 @@ protected:
 
         if (ImGui::Begin("synth 303 maker", nullptr, ImGuiWindowFlags_NoResize))
         {
+            if (ImGui::BeginCombo("Preset", kFactoryPresets[program].name)) {
+                for (int i = 0; i < (int)kFactoryPresetCount; ++i) {
+                    if (ImGui::Selectable(kFactoryPresets[i].name, i == program)) {
+                        program = i;
+                        sendPreset(kFactoryPresets[i].preset);
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Store A")) {
+                storeMorph(true);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Store B")) {
+                storeMorph(false);
+            }
+            if (ImGui::SliderFloat("Morph A-B", &morph, 0.0f, 1.0f)) {
+                if (ImGui::IsItemActivated())
+                    editParameter(kParamMorph, true);
+
+                setParameterValue(kParamMorph, morph);
+                if (morphPair.ready)
+                    showPreset(morphPair.at(morph));
+            }
+            if (ImGui::IsItemDeactivated())
+                editParameter(kParamMorph, false);
+
+            if (ImGui::Checkbox("Sequencer", &sequencerOn)) {
+                setParameterValue(kParamSequencer, sequencerOn ? 1.0f : 0.0f);
+            }
+            ImGui::SameLine();
+            // steps like "36a 48s - t", see StepSequencer.hpp
+            if (ImGui::InputTextWithHint("Pattern", "note[a][s] | - | t[s] per step", patternText, sizeof(patternText),
+                                         ImGuiInputTextFlags_EnterReturnsTrue)) {
+                applyPattern();
+            }
+            if (patternError[0] != '\0')
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", patternError);
 
             if (ImGui::SliderFloat("Gain (dB)", &fGain, -90.0f, 30.0f))
             {
@@ -186,24 +554,30 @@ protected:
             // 0.099 = 0%
             if (ImGui::SliderFloat("Cutoff", &fVco, 2.3f, 12.0f)) {
                 setParameterValue(kParamCutoff, fVco);
+                do_update |= true;
             }
             if (ImGui::SliderFloat("Resonance", &fRes, 0.099f, 1.0f)) {
                 setParameterValue(kParamResonance, fRes);
+                do_update |= true;
             }
             if (ImGui::SliderFloat("Envmod", &fVmod, 0.0f, 1.0f)) {
                 setParameterValue(kParamVmod, fVmod);
+                do_update |= true;
             }
 
             if (ImGui::SliderFloat("Accent amount", &fVacc_amt, 0.0f, 1.0f)) {
                 setParameterValue(kParamAccent, fVacc_amt);
+                do_update |= true;
             }
 
             if (ImGui::SliderFloat("Decay", &decTime, -2.223, 1.223)) {
                 setParameterValue(kParamDecay, decTime);
+                do_update |= true;
             }
 
             if (ImGui::SliderFloat("Vcf Attack", &atkTime, -9.482, -4.0)) {
                 setParameterValue(kParamVcfAttack, atkTime);
+                do_update |= true;
             }
 
             // A B C D : step 0.01 step fast 0.1
@@ -211,8 +585,20 @@ protected:
             // base 0.5 2.0
             // VaccMull 0.2 0.6
 
-            static char formulaText[2048] = "float freq = (A * Vco + B) * std::exp(C * Vmod + D * (Vacc * VaccMul) + E) + base;";
-            ImGui::Text(formulaText, sizeof(formulaText));
+            // empty for the built-in formula, the hint shows what that is
+            if (ImGui::InputTextWithHint("Cutoff formula", CutoffFormula::kBuiltinText, formulaText, sizeof(formulaText),
+                                         ImGuiInputTextFlags_EnterReturnsTrue)) {
+                applyFormula();
+                do_update |= true;
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Built-in")) {
+                formulaText[0] = '\0';
+                applyFormula();
+                do_update |= true;
+            }
+            if (formulaError[0] != '\0')
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", formulaError);
 
             if (ImGui::InputFloat("A - base scaling", &A, 0.01, 0.1)) {
                 setParameterValue(kParamFormulaA, A);
@@ -246,15 +632,20 @@ protected:
 
             if (ImGui::SliderFloat("VaccMul", &VaccMul, 0.0, 20.0)) {
                 setParameterValue(kParamFormulaVaccMul, VaccMul);
+                do_update |= true;
             }
 
+            // printed here, the DSP side may only receive parameters on the audio thread
             if (ImGui::Button("Print parameters and limits")) {
-                setParameterValue(kParamPrintParameters, 1.0f);
+                printParameters();
             }
 
-            if (do_update) {
-                d_stdout("Update!");
-                do_update = false;
+            if (ImGui::Checkbox("CV outputs (gate, pitch, cutoff)", &cvOutputs)) {
+                setParameterValue(kParamCvOutputs, cvOutputs ? 1.0f : 0.0f);
+            }
+            ImGui::SameLine();
+            if (ImGui::Checkbox("Filter the stereo input (outputs 1-2)", &stereoInput)) {
+                setParameterValue(kParamStereoInput, stereoInput ? 1.0f : 0.0f);
             }
 
             // if (ImGui::SliderFloat("D", &D, 0.0f, 2.0f)) {
@@ -269,23 +660,80 @@ protected:
             // ImGui::LabelText("<- OutputParam", "%f", fOutputParam);
             if (ImGui::Checkbox("Accent", &accent)) {
                 d_stdout("Accent! %d", accent);
+                do_update |= true;
+            }
+            ImGui::SameLine();
+            do_update |= ImGui::Checkbox("Accent toggled", &plotAccentPair);
+            ImGui::SameLine();
+            do_update |= ImGui::Checkbox("Envmod 0 / 0.5 / 1", &plotEnvmodSweep);
+            ImGui::SameLine();
+            do_update |= ImGui::Checkbox("Shortest decay", &plotShortDecay);
+            ImGui::SameLine();
+            if (ImGui::Checkbox("Scope", &showScope)) {
+                if (showScope)
+                    attachScope();
+                else
+                    detachScope();
             }
 
             // static char aboutText[2048] = "float A = 2.243000;\nfloat B = 0.626000;\nfloat C = 0.364000;\nfloat D = xx;\nfloat E = 4.462000;\nfloat base = -119.205;\n// guest formula\nIc,11 = (A*Vco + B)*e^(C*Vmod + D*Vacc +E) + base\n";
 
-            wowFilter.setResonancePot(fRes);
+            if (do_update) {
+                postCurves();
+                do_update = false;
+            }
 
-            plot_vcf_env(plot_vcf_x, plot_vcf_y, 48000);
-            if (ImPlot::BeginPlot("Guest formula!", ImVec2(-1.0,-1.0))) {
+            // fit the axes again when the curves got longer or shorter
+            if (curveWorker.fetch() && curveWorker.curves().frames != plotFrames) {
+                ImPlot::SetNextAxesToFit();
+                plotFrames = curveWorker.curves().frames;
+            }
+            const CurveSet& curves = curveWorker.curves();
+            const float curveHeight = showScope ? ImGui::GetContentRegionAvail().y * 0.5f : -1.0f;
+            if (ImPlot::BeginPlot("Guest formula!", ImVec2(-1.0, curveHeight))) {
                 // ImPlot::SetupAxis(ImAxis_Y2, "", ImPlotAxisFlags_AuxDefault);
                 // ImPlot::SetAxes(ImAxis_X1, ImAxis_Y1);
-                ImPlot::PlotLine("Freq", plot_vcf_x, plot_vcf_y, 48000);
-                // ImPlot::SetAxes(ImAxis_X1, ImAxis_Y2);
-                // ImPlot::PlotLine("Accent", plot_vcf_x, plot_accent_y, 48000);
+                for (int c = 0; c < curves.count; ++c)
+                    ImPlot::PlotLine(curves.curves[c].label, curves.curves[c].x, curves.curves[c].y, curves.curves[c].points);
                 ImPlot::EndPlot();
             }
+
+            if (showScope)
+                drawScope();
         }
         ImGui::End();
+
+        animating = ImGui::IsAnyItemActive() || ImGui::GetIO().WantTextInput;
+    }
+
+    void drawScope()
+    {
+        if (scope == nullptr) {
+            ImGui::TextUnformatted("Scope unavailable, the editor runs in another process than the DSP");
+            return;
+        }
+        if (!scopeReading) {
+            ImGui::TextUnformatted("Scope unavailable, another editor of this instance shows it");
+            return;
+        }
+
+        const float history = kScopeHistory * ScopeRing::kDecimation / (float)getSampleRate();
+        const float height = ImGui::GetContentRegionAvail().y * 0.5f;
+        if (ImPlot::BeginPlot("Scope", ImVec2(-1.0, height))) {
+            ImPlot::SetupAxisLimits(ImAxis_X1, -history, 0.0, ImPlotCond_Always);
+            ImPlot::SetupAxisLimits(ImAxis_Y1, -1.1, 1.1, ImPlotCond_Once);
+            ImPlot::PlotShaded("Audio", scopeTime, scopeAudioMin, scopeAudioMax, scopeFrames);
+            ImPlot::PlotLine("Env", scopeTime, scopeEnv, scopeFrames);
+            ImPlot::PlotLine("Wow", scopeTime, scopeWow, scopeFrames);
+            ImPlot::PlotLine("Gate", scopeTime, scopeGate, scopeFrames);
+            ImPlot::EndPlot();
+        }
+        if (ImPlot::BeginPlot("Scope cutoff", ImVec2(-1.0, -1.0))) {
+            ImPlot::SetupAxisLimits(ImAxis_X1, -history, 0.0, ImPlotCond_Always);
+            ImPlot::SetupAxisLimits(ImAxis_Y1, 0.0, 0.5 * getSampleRate(), ImPlotCond_Once);
+            ImPlot::PlotLine("Cutoff Hz", scopeTime, scopeFreq, scopeFrames);
+            ImPlot::EndPlot();
+        }
     }
 
     DISTRHO_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginUI)
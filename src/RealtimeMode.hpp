@@ -0,0 +1,150 @@
+// Real-time hardening for live rigs running the JACK standalone, off unless SYNTH303_REALTIME=1.
+//
+//   SYNTH303_REALTIME=1      lock the process memory at activation and prefault the audio thread's stack
+//   SYNTH303_RT_CPU=n        also pin the audio thread to CPU n (Linux)
+//
+// Plugin hosts own their process, so the plugin formats never lock or pin anything. Callback durations and
+// late callbacks are counted on the audio thread and printed at deactivation. A late callback is one that
+// started more than one and a half periods after the previous one, which is how an xrun looks from inside
+// the process callback; JACK's own xrun count comes from tools/jack-xrun-test.sh.
+
+#ifndef SYNTH303_REALTIME_MODE_H
+#define SYNTH303_REALTIME_MODE_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#if defined(__linux__)
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+#include "DistrhoUtils.hpp"
+
+struct RealtimeMode {
+
+    static constexpr std::size_t kStackPrefault = 256 * 1024;
+
+    bool enabled = false;
+    int cpu = -1;
+
+    // audio thread, reset by activate() and read by deactivate() while no callback runs
+    bool threadReady = false;
+    int pinError = 0; // from prepareThread(), printed by report()
+    int lockError = 0; // from activate(), printed by report() too: some hosts activate on the audio thread
+    uint64_t callbacks = 0;
+    uint64_t late = 0;
+    uint64_t overBudget = 0;
+    double totalSeconds = 0.0;
+    double maxSeconds = 0.0;
+    double lastStart = 0.0;
+
+    void configure() {
+        const char* const realtime = std::getenv("SYNTH303_REALTIME");
+        enabled = realtime != nullptr && std::atoi(realtime) != 0;
+        const char* const pin = std::getenv("SYNTH303_RT_CPU");
+        cpu = enabled && pin != nullptr ? std::atoi(pin) : -1;
+    }
+
+    // not realtime safe, after the engine allocated its arena and tables for this activation
+    void activate() {
+        threadReady = false;
+        pinError = 0;
+        lockError = 0;
+        callbacks = late = overBudget = 0;
+        totalSeconds = maxSeconds = lastStart = 0.0;
+        if (!enabled)
+            return;
+
+#if defined(__linux__)
+        // keep freed memory in the process and serve large blocks from the locked heap instead of new mappings
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+#endif
+#if !defined(_WIN32)
+        // MCL_CURRENT faults in and locks what exists now: the arena slices, which DspArena::take() already
+        // zeroed, and the shared tables. MCL_FUTURE does the same for anything mapped later.
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+            lockError = errno;
+#else
+        lockError = ENOSYS;
+#endif
+    }
+
+    // audio thread, once per activation before the first block: system calls are fine here, not later, and
+    // nothing is printed from here either
+    void prepareThread() {
+        threadReady = true;
+        if (!enabled)
+            return;
+
+        // touch the stack the callback can grow into so the first deep call does not page fault
+        volatile unsigned char stack[kStackPrefault];
+        for (std::size_t i = 0; i < kStackPrefault; i += 4096)
+            stack[i] = 0;
+
+#if defined(__linux__)
+        if (cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pinError = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+#endif
+    }
+
+    static double now() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+
+    // audio thread, around each process callback
+    double begin() {
+        if (!threadReady)
+            prepareThread();
+        return now();
+    }
+
+    void end(double start, uint32_t frames, double sampleRate) {
+        const double seconds = now() - start;
+        const double period = frames / sampleRate;
+        if (callbacks != 0 && start - lastStart > 1.5 * period)
+            ++late;
+        if (seconds > period)
+            ++overBudget;
+        lastStart = start;
+        totalSeconds += seconds;
+        if (seconds > maxSeconds)
+            maxSeconds = seconds;
+        ++callbacks;
+    }
+
+    // not realtime safe, after the last callback of an activation
+    void report(uint32_t bufferSize, double sampleRate) const {
+        if (!enabled)
+            return;
+        if (lockError == ENOSYS)
+            d_stderr("realtime: memory locking is not supported on this platform");
+        else if (lockError != 0)
+            d_stderr("realtime: mlockall failed (%s), check the memlock limit", std::strerror(lockError));
+        if (pinError != 0)
+            d_stderr("realtime: cannot pin the audio thread to CPU %d (%s)", cpu, std::strerror(pinError));
+        if (callbacks == 0)
+            return;
+        const double period = bufferSize / sampleRate;
+        d_stdout("realtime: %llu callbacks of %u frames, mean %.1f us, max %.1f us (%.0f%% of the period), "
+                 "%llu over budget, %llu late",
+                 (unsigned long long)callbacks, bufferSize, 1e6 * totalSeconds / callbacks, 1e6 * maxSeconds,
+                 100.0 * maxSeconds / period, (unsigned long long)overBudget, (unsigned long long)late);
+    }
+};
+
+#endif // SYNTH303_REALTIME_MODE_H
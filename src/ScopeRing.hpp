@@ -0,0 +1,133 @@
+// Decimated traces of what the engine renders, streamed from the audio thread to the editor.
+//
+// The engine pushes one ScopeFrame every kDecimation samples into a single-producer/single-consumer ring,
+// but only while an editor is attached, so with the editor closed the cost is one relaxed load per block.
+// A full ring drops frames instead of waiting. Without direct access the editor cannot reach the DSP
+// instance, so rings are registered process-wide under a small integer id that the DSP reports as an
+// output parameter; an editor running in another process finds nothing under that id and shows no scope.
+
+#ifndef SYNTH303_SCOPE_RING_H
+#define SYNTH303_SCOPE_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+struct ScopeFrame {
+    float audioMin;  // over the decimation window
+    float audioMax;
+    float freq;      // cutoff in Hz, at the end of the window
+    float env;       // vcf_env.output
+    float wow;       // WowFilter output, the accent sweep
+    uint8_t gate;
+    uint8_t slide;
+    uint8_t accent;
+};
+
+struct ScopeRing {
+    static constexpr uint32_t kDecimation = 32;
+    static constexpr uint32_t kCapacity = 4096; // frames, a power of two, ~2.7 s at 48 kHz
+
+    ScopeFrame frames[kCapacity];
+
+    alignas(64) std::atomic<uint32_t> writeIndex { 0 };
+    alignas(64) std::atomic<uint32_t> readIndex { 0 };
+    alignas(64) std::atomic<bool> attached { false };
+    uint32_t dropped = 0; // producer only
+
+    // audio thread
+    bool push(const ScopeFrame& frame) {
+        const uint32_t write = writeIndex.load(std::memory_order_relaxed);
+        if (write - readIndex.load(std::memory_order_acquire) >= kCapacity) {
+            ++dropped;
+            return false;
+        }
+        frames[write & (kCapacity - 1)] = frame;
+        writeIndex.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    // attached editor thread, returns how many frames were copied to `out`
+    uint32_t pop(ScopeFrame* out, uint32_t maxFrames) {
+        const uint32_t read = readIndex.load(std::memory_order_relaxed);
+        const uint32_t count = std::min(writeIndex.load(std::memory_order_acquire) - read, maxFrames);
+        for (uint32_t i = 0; i < count; ++i)
+            out[i] = frames[(read + i) & (kCapacity - 1)];
+        readIndex.store(read + count, std::memory_order_release);
+        return count;
+    }
+
+    bool empty() const {
+        return writeIndex.load(std::memory_order_acquire) == readIndex.load(std::memory_order_relaxed);
+    }
+
+    // editor thread, makes it the one reader, starting from what the engine renders next instead of what
+    // piled up before. false while another editor is attached: two readers popping would break the ring.
+    bool attach() {
+        bool expected = false;
+        if (!attached.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+            return false;
+        readIndex.store(writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+        return true;
+    }
+
+    // only from the editor whose attach() succeeded
+    void detach() {
+        attached.store(false, std::memory_order_release);
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// process-wide ids, never taken on the audio thread
+
+struct ScopeRegistry
+{
+    // ids stay below 2^24 so they survive the trip through a float parameter
+    static uint32_t add(const std::shared_ptr<ScopeRing>& ring)
+    {
+        const std::lock_guard<std::mutex> lock(mutex());
+        uint32_t& next = nextId();
+        const uint32_t id = next;
+        next = next % 0xffffff + 1;
+        rings()[id] = ring;
+        return id;
+    }
+
+    static void remove(uint32_t id)
+    {
+        const std::lock_guard<std::mutex> lock(mutex());
+        rings().erase(id);
+    }
+
+    // a ring found here stays valid for as long as the caller keeps the pointer, even after its plugin is gone
+    static std::shared_ptr<ScopeRing> find(uint32_t id)
+    {
+        const std::lock_guard<std::mutex> lock(mutex());
+        const auto it = rings().find(id);
+        return it != rings().end() ? it->second : nullptr;
+    }
+
+private:
+    static std::mutex& mutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    static uint32_t& nextId()
+    {
+        static uint32_t id = 1;
+        return id;
+    }
+
+    static std::map<uint32_t, std::shared_ptr<ScopeRing>>& rings()
+    {
+        static std::map<uint32_t, std::shared_ptr<ScopeRing>> map;
+        return map;
+    }
+};
+
+#endif // SYNTH303_SCOPE_RING_H
@@ -0,0 +1,141 @@
+// Immutable lookup tables shared by every plugin instance in the process.
+//
+// Sample-rate dependent tables are built once per rate and handed out as
+// reference-counted pointers; the last instance to let go of a rate frees it.
+// Sample-rate independent tables are generated at compile time.
+
+#ifndef SYNTH303_SHARED_TABLES_H
+#define SYNTH303_SHARED_TABLES_H
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// --------------------------------------------------------------------------------------------------------------------
+// compile-time helpers, std::pow and std::exp2 are not constexpr in C++17
+
+constexpr double ct_exp2(double x)
+{
+    // split into integer octaves and a fractional part in [0, 1)
+    int octaves = (int)x;
+    if ((double)octaves > x)
+        --octaves;
+    const double f = (x - octaves) * 0.69314718055994530942; // ln(2)
+
+    double term = 1.0, sum = 1.0;
+    for (int n = 1; n < 24; ++n)
+    {
+        term *= f / n;
+        sum += term;
+    }
+
+    for (; octaves > 0; --octaves)
+        sum *= 2.0;
+    for (; octaves < 0; ++octaves)
+        sum *= 0.5;
+    return sum;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// process-wide, reference-counted cache keyed by sample rate
+
+template <typename Table>
+struct SharedTableCache
+{
+    static std::shared_ptr<const Table> acquire(double sampleRate)
+    {
+        // only taken while activating, never on the audio thread
+        static std::mutex mutex;
+        static std::map<double, std::weak_ptr<const Table>> tables;
+
+        const std::lock_guard<std::mutex> lock(mutex);
+
+        for (auto it = tables.begin(); it != tables.end();)
+        {
+            if (it->second.expired())
+                it = tables.erase(it);
+            else
+                ++it;
+        }
+
+        std::weak_ptr<const Table>& slot = tables[sampleRate];
+        if (std::shared_ptr<const Table> table = slot.lock())
+            return table;
+
+        std::shared_ptr<const Table> table = std::make_shared<const Table>(sampleRate);
+        slot = table;
+        return table;
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// ADAREnvelope rates, from SurgeStorage::init_tables
+
+// 2^-((i - 256) / 16), the rate independent part of the table
+struct EnvRateOctaves
+{
+    static constexpr int size = 512;
+    double data[size];
+
+    constexpr EnvRateOctaves() : data()
+    {
+        for (int i = 0; i < size; ++i)
+            data[i] = ct_exp2(-((double)i - 256.0) / 16.0);
+    }
+};
+
+inline constexpr EnvRateOctaves envRateOctaves{};
+
+struct EnvRateTable
+{
+    static constexpr int size = EnvRateOctaves::size;
+    static constexpr int block_size_os = 4; // ADAREnvelope::BLOCK_SIZE_OS
+
+    float data alignas(16)[size];
+
+    explicit EnvRateTable(double sampleRate)
+    {
+        const double dsamplerate_os = sampleRate * 2.0;
+        for (int i = 0; i < size; ++i)
+            data[i] = (float)((double)block_size_os / dsamplerate_os * envRateOctaves.data[i]);
+    }
+
+    static std::shared_ptr<const EnvRateTable> acquire(double sampleRate)
+    {
+        return SharedTableCache<EnvRateTable>::acquire(sampleRate);
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Osc303 pitch CV map, 16.35Hz * 2^cv over the 0-5V range
+
+struct Osc303PitchTable
+{
+    static constexpr int size = 1024;
+    static constexpr float maxCV = 5.0f;
+    static constexpr float c0 = 16.35f;
+
+    float hz[size + 1];
+
+    constexpr Osc303PitchTable() : hz()
+    {
+        for (int i = 0; i <= size; ++i)
+            hz[i] = (float)(c0 * ct_exp2((double)i * maxCV / size));
+    }
+
+    // linear interpolation, error is well below 0.01 cent
+    inline float lookup(float cv) const
+    {
+        const float x = cv * (size / maxCV);
+        if (!(x >= 0.0f) || x >= (float)size)
+            return c0 * std::exp2(cv);
+        const int e = (int)x;
+        const float a = x - (float)e;
+        return hz[e] + a * (hz[e + 1] - hz[e]);
+    }
+};
+
+inline constexpr Osc303PitchTable osc303PitchTable{};
+
+#endif // SYNTH303_SHARED_TABLES_H
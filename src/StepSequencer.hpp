@@ -0,0 +1,240 @@
+// Built-in 303 step sequencer, following the host transport.
+//
+// Steps are sixteenth notes and a gate lasts half a step, like the original; step 0 falls on beat 0 of the
+// host's song position, so the pattern stays locked to its bars through loops and locates. Every block the
+// step and gate boundaries inside it are turned into note events at their exact frame, in a preallocated
+// list Synth303Engine::run() takes like host MIDI.
+//
+// Between locates the steps follow a sample clock of its own, started from the host position: hosts that
+// quantize the position to ticks (JACK BBT masters report whole ticks) would otherwise jitter every note by
+// a few frames. The clock picks up the host position again only on a real discontinuity, a transport
+// start, a jump of the host frame or a position more than a step away from the clock.
+//
+// Pattern text, one space separated token per step (up to kMaxSteps):
+//   36      note 36             36a   accented
+//   36s     slides into the next step, the gate stays open
+//   -       rest                t     tie, holds the previous note through this step (ts: and slides on)
+
+#ifndef SYNTH303_STEP_SEQUENCER_H
+#define SYNTH303_STEP_SEQUENCER_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include "TripleBuffer.hpp"
+
+struct SequencerStep {
+    uint8_t note = 36;
+    bool gate = true;
+    bool accent = false;
+    bool slide = false;
+    bool tie = false;
+};
+
+struct SequencerPattern {
+    static constexpr int kMaxSteps = 32;
+
+    // the default pattern of tools/Workload.hpp
+    static constexpr const char* kDefaultText = "36a 36 48s 39 - 43a 36s 51a 36 24 36as 38 - 36 48as 46";
+
+    SequencerStep steps[kMaxSteps];
+    int length = 0;
+
+    // false, leaving the pattern alone, on an empty or malformed text; `error` says why
+    bool parse(const char* text, char* error = nullptr, std::size_t errorSize = 0) {
+        SequencerPattern next;
+        const char* c = text;
+        for (;;)
+        {
+            while (*c == ' ' || *c == '\t' || *c == '\n')
+                ++c;
+            if (*c == '\0')
+                break;
+
+            if (next.length == kMaxSteps)
+                return fail(error, errorSize, "more than 32 steps");
+            SequencerStep& step = next.steps[next.length];
+
+            if (*c == '-') {
+                step.gate = false;
+                ++c;
+            } else if (*c == 't') {
+                step.tie = true;
+                ++c;
+            } else if (*c >= '0' && *c <= '9') {
+                int note = 0;
+                for (; *c >= '0' && *c <= '9'; ++c)
+                    note = note * 10 + (*c - '0');
+                if (note > 127)
+                    return fail(error, errorSize, "note above 127 in step %d", next.length + 1);
+                step.note = (uint8_t)note;
+            } else {
+                return fail(error, errorSize, "step %d is not a note, '-' or 't'", next.length + 1);
+            }
+
+            for (; *c != '\0' && *c != ' ' && *c != '\t' && *c != '\n'; ++c)
+            {
+                if (*c == 'a' && step.gate && !step.tie)
+                    step.accent = true;
+                else if (*c == 's' && step.gate)
+                    step.slide = true;
+                else
+                    return fail(error, errorSize, "unknown flag '%c' in step %d", *c, next.length + 1);
+            }
+            ++next.length;
+        }
+
+        if (next.length == 0)
+            return fail(error, errorSize, "no steps");
+        *this = next;
+        if (error != nullptr && errorSize != 0)
+            error[0] = '\0';
+        return true;
+    }
+
+private:
+    template <typename... Args>
+    static bool fail(char* error, std::size_t errorSize, const char* format, Args... args) {
+        if (error != nullptr && errorSize != 0)
+            std::snprintf(error, errorSize, format, args...);
+        return false;
+    }
+};
+
+// where the host is: song position in quarter notes and the transport frame
+struct SequencerTransport {
+    bool playing = false;
+    double beat = 0.0;
+    double bpm = 120.0;
+    uint64_t frame = 0;
+};
+
+struct StepSequencer {
+    struct Event {
+        uint32_t frame;
+        uint8_t data[3];
+    };
+
+    static constexpr uint32_t kMaxEvents = 256;
+    static constexpr double kHalfStepBeats = 0.125;
+    static constexpr double kResyncBeats = 0.25; // a step
+
+    // setPattern() writes, schedule() reads
+    TripleBuffer<SequencerPattern> patterns;
+
+    // the events of the last schedule(), in frame order
+    Event events[kMaxEvents];
+    uint32_t eventCount = 0;
+
+    int heldNote = -1;
+    int64_t nextHalfStep = 0;
+    bool running = false;
+
+    // the clock: `elapsed` frames since it was at `originBeat`, at `clockBpm`
+    double originBeat = 0.0;
+    double clockBpm = 120.0;
+    uint64_t elapsed = 0;
+    uint64_t expectedFrame = 0;
+
+    StepSequencer() {
+        SequencerPattern pattern;
+        pattern.parse(SequencerPattern::kDefaultText);
+        patterns.reset(pattern);
+    }
+
+    // not realtime safe, from one non-audio thread; the pattern plays from the next block on
+    void setPattern(const SequencerPattern& pattern) {
+        patterns.write() = pattern;
+        patterns.publish();
+    }
+
+    // audio thread, every block: the step events that fall into the next `frames` frames. Stopped or
+    // disabled, it only releases the note it holds, at frame 0.
+    void schedule(const SequencerTransport& transport, double sampleRate, uint32_t frames, bool enabled) {
+        eventCount = 0;
+        if (!enabled || !transport.playing || !(transport.bpm > 0.0) || frames == 0) {
+            release(0);
+            running = false;
+            return;
+        }
+
+        const double beatsPerFrame = transport.bpm / (60.0 * sampleRate);
+
+        // a new tempo carries on from where the clock is
+        if (running && transport.bpm != clockBpm) {
+            originBeat += elapsed * clockBpm / (60.0 * sampleRate);
+            elapsed = 0;
+            clockBpm = transport.bpm;
+        }
+
+        // started, located or looped: pick up at the next boundary, the note that was held ends here
+        const double clockBeat = originBeat + elapsed * beatsPerFrame;
+        if (!running || transport.frame != expectedFrame || std::fabs(transport.beat - clockBeat) > kResyncBeats) {
+            release(0);
+            originBeat = transport.beat;
+            clockBpm = transport.bpm;
+            elapsed = 0;
+            nextHalfStep = (int64_t)std::ceil(originBeat / kHalfStepBeats - 1e-9);
+            running = true;
+        }
+
+        // a boundary belongs to the first frame at or after it; counted from the clock's origin, so it
+        // rounds the same way whatever the block size
+        const SequencerPattern& pattern = patterns.read();
+        for (; eventCount + 2 <= kMaxEvents; ++nextHalfStep)
+        {
+            const double frame = std::ceil((nextHalfStep * kHalfStepBeats - originBeat) / beatsPerFrame - 1e-6)
+                               - (double)elapsed;
+            if (frame >= frames)
+                break;
+            halfStep(pattern, nextHalfStep, frame > 0.0 ? (uint32_t)frame : 0);
+        }
+
+        elapsed += frames;
+        expectedFrame = transport.frame + frames;
+    }
+
+private:
+    void push(uint32_t frame, uint8_t status, uint8_t note, uint8_t velocity) {
+        events[eventCount++] = { frame, { status, note, velocity } };
+    }
+
+    void release(uint32_t frame) {
+        if (heldNote < 0)
+            return;
+        push(frame, 0x80, (uint8_t)heldNote, 0);
+        heldNote = -1;
+    }
+
+    // even half steps start a step, odd ones end its gate
+    void halfStep(const SequencerPattern& pattern, int64_t index, uint32_t frame) {
+        const int64_t whole = index >= 0 ? index / 2 : (index - 1) / 2;
+        const int step = (int)(((whole % pattern.length) + pattern.length) % pattern.length);
+        const SequencerStep& s = pattern.steps[step];
+
+        if (index - 2 * whole == 0)
+        {
+            if (!s.gate)
+            {
+                release(frame);
+            }
+            else if (!s.tie)
+            {
+                // with a note still held the engine slides into this one
+                push(frame, 0x90, s.note, s.accent ? 127 : 80);
+                if (heldNote >= 0 && heldNote != s.note)
+                    push(frame, 0x80, (uint8_t)heldNote, 0);
+                heldNote = s.note;
+            }
+        }
+        else
+        {
+            const SequencerStep& next = pattern.steps[(step + 1) % pattern.length];
+            if (!s.slide && !(next.gate && next.tie))
+                release(frame);
+        }
+    }
+};
+
+#endif // SYNTH303_STEP_SEQUENCER_H
@@ -0,0 +1,432 @@
+// Activation and block rendering of Synth303Engine.
+// Kept out of line in its own translation unit so the plugin and the offline tools share one
+// compiled copy, and one profile in PGO builds.
+
+#include "Synth303Engine.hpp"
+
+#include <cstring>
+
+// --------------------------------------------------------------------------------------------------------------------
+
+void Synth303Engine::activate(double sampleRate, uint32_t maxBlockSize)
+{
+    sampleRateChanged(sampleRate);
+    fSmoothGain.flush();
+
+    blockCapacity = std::max(maxBlockSize, 1u);
+    const std::size_t base = DspArena::roundUp(sizeof(float) * blockCapacity);
+    const std::size_t oversampled = DspArena::roundUp(sizeof(float) * blockCapacity * kOversampling);
+    arena.reserve(7 * base + 6 * oversampled + CutoffFormula::kMaxRegisters * base);
+
+    vcfEnvBuffer = arena.take(blockCapacity);
+    vcaEnvBuffer = arena.take(blockCapacity);
+    pitchBuffer = arena.take(blockCapacity);
+    vaccBuffer = arena.take(blockCapacity);
+    freqBuffer = arena.take(blockCapacity);
+    filterBuffer = arena.take(blockCapacity);
+    squareBuffer = arena.take(blockCapacity * kOversampling);
+    sawBuffer = arena.take(blockCapacity * kOversampling);
+    ladderLBuffer = arena.take(blockCapacity * kOversampling);
+    ladderRBuffer = arena.take(blockCapacity * kOversampling);
+    filterRBuffer = arena.take(blockCapacity);
+    inputLBuffer = arena.take(blockCapacity * kOversampling);
+    inputRBuffer = arena.take(blockCapacity * kOversampling);
+    formulaRegisters = arena.take(CutoffFormula::kMaxRegisters * blockCapacity);
+
+    kernels = &getDspKernels(isaOverride);
+
+    osc.prepare(sampleRate, blockCapacity);
+    osc.setPitchCV(1.0f);
+
+    vca_env.activate(sampleRate);
+    vcf_env.activate(sampleRate);
+    wowFilter.prepare(sampleRate);
+    slideFilter.prepare(sampleRate);
+
+    filter.prepare(sampleRate, 300.0, 0.66);
+    stereoFilter.prepare(sampleRate);
+
+    // every activation starts silent: no note held, envelopes ended, filter and decimator histories cleared
+    gate = accent = slide = false;
+    nextGateOff = -1;
+    vca_env.immediatelyEnd();
+    vcf_env.immediatelyEnd();
+    filter.reset();
+    stereoFilter.reset();
+}
+
+void Synth303Engine::process(float** outputs, uint32_t frames, const float* const* inputs)
+{
+    adoptFormula();
+    applyParameterChanges();
+    wowFilter.setResonancePot(fRes);
+
+    // while parameters glide, blocks are cut at control rate so each one runs with the next step
+    uint32_t length;
+    for (uint32_t offset = 0; offset < frames; offset += length)
+    {
+        length = std::min(blockCapacity, frames - offset);
+        if (glidesActive != 0)
+        {
+            advanceGlides();
+            length = std::min(length, kControlFrames);
+            ++stats.controlBlocks;
+        }
+
+        float* blockOutputs[4];
+        for (int k = 0; k < 4; ++k)
+            blockOutputs[k] = outputs[k] != nullptr ? outputs[k] + offset : nullptr;
+
+        const float* blockInputs[2] = {};
+        for (int k = 0; k < 2 && inputs != nullptr; ++k)
+            blockInputs[k] = inputs[k] != nullptr ? inputs[k] + offset : nullptr;
+
+        renderBlock(blockOutputs, length, blockInputs);
+    }
+}
+
+void Synth303Engine::applyParameterChanges()
+{
+    ParameterQueue::Change change;
+    while (changes.pop(change))
+    {
+        if (change.index == kParamMorph)
+            setMorphPosition(change.value);
+        else
+            glideParameter(change.index, change.value);
+    }
+
+    // some were dropped on a full queue, `requested` has the latest of every one
+    if (changesLost.exchange(false, std::memory_order_acquire))
+    {
+        for (uint32_t index = 0; index < kParamCount; ++index)
+            if (glidedMember(index) != nullptr)
+                glideParameter(index, requested[index].load(std::memory_order_relaxed));
+    }
+}
+
+void Synth303Engine::advanceGlides()
+{
+    for (uint32_t index = 0; index < kParamCount && glidesActive != 0; ++index)
+    {
+        Glide& glide = glides[index];
+        if (glide.stepsLeft == 0)
+            continue;
+
+        float* const member = glidedMember(index);
+        if (--glide.stepsLeft == 0)
+        {
+            *member = glide.target;
+            --glidesActive;
+        }
+        else
+        {
+            *member += glide.step;
+        }
+    }
+    wowFilter.setResonancePot(fRes);
+}
+
+bool Synth303Engine::setFormula(const char* text, char* error, std::size_t errorSize)
+{
+    CutoffFormula* const next = new CutoffFormula();
+    if (!next->compile(text, error, errorSize))
+    {
+        delete next;
+        return false;
+    }
+
+    // publish first, one that was never picked up is ours again; then free what the audio thread handed
+    // back. In the other order the audio thread could retire a formula in between, and with the hand-back
+    // slot taken it would not adopt this one until the next call.
+    delete pendingFormula.exchange(next, std::memory_order_acq_rel);
+    delete retiredFormula.exchange(nullptr, std::memory_order_acq_rel);
+    return true;
+}
+
+void Synth303Engine::adoptFormula()
+{
+    // the old one can only be handed back once the previous hand-back was freed
+    if (retiredFormula.load(std::memory_order_acquire) != nullptr)
+        return;
+
+    CutoffFormula* const next = pendingFormula.exchange(nullptr, std::memory_order_acq_rel);
+    if (next == nullptr)
+        return;
+
+    retiredFormula.store(formula, std::memory_order_release);
+    formula = next;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// stage variants, indexed by voice state and output mask
+
+using EnvelopeStage = void (Synth303Engine::*)(uint32_t);
+using WowStage = void (Synth303Engine::*)(uint32_t);
+using BlockStage = void (Synth303Engine::*)(uint32_t);
+using OutputStage = void (Synth303Engine::*)(float* const*, uint32_t);
+
+// accent | slide << 1 | gate << 2
+static const EnvelopeStage kEnvelopeStages[8] = {
+    &Synth303Engine::renderEnvelopes<false, false, false>,
+    &Synth303Engine::renderEnvelopes<true,  false, false>,
+    &Synth303Engine::renderEnvelopes<false, true,  false>,
+    &Synth303Engine::renderEnvelopes<true,  true,  false>,
+    &Synth303Engine::renderEnvelopes<false, false, true>,
+    &Synth303Engine::renderEnvelopes<true,  false, true>,
+    &Synth303Engine::renderEnvelopes<false, true,  true>,
+    &Synth303Engine::renderEnvelopes<true,  true,  true>,
+};
+
+static const WowStage kWowStages[2] = {
+    &Synth303Engine::renderWow<false>,
+    &Synth303Engine::renderWow<true>,
+};
+
+// Synth303Engine::OutputMask
+static const OutputStage kOutputStages[8] = {
+    &Synth303Engine::renderOutputs<0>,
+    &Synth303Engine::renderOutputs<1>,
+    &Synth303Engine::renderOutputs<2>,
+    &Synth303Engine::renderOutputs<3>,
+    &Synth303Engine::renderOutputs<4>,
+    &Synth303Engine::renderOutputs<5>,
+    &Synth303Engine::renderOutputs<6>,
+    &Synth303Engine::renderOutputs<7>,
+};
+
+// Synth303Engine::OutputMask without kOutputGate, indexed by mask >> 1
+static const OutputStage kStereoOutputStages[4] = {
+    &Synth303Engine::renderStereoOutputs<0>,
+    &Synth303Engine::renderStereoOutputs<2>,
+    &Synth303Engine::renderStereoOutputs<4>,
+    &Synth303Engine::renderStereoOutputs<6>,
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// stages
+
+void Synth303Engine::renderBlock(float* const* outputs, uint32_t frames, const float* const* inputs)
+{
+    const bool stereo = stereoInput && inputs[0] != nullptr && inputs[1] != nullptr && outputs[1] != nullptr;
+    blockInputs[0] = inputs[0];
+    blockInputs[1] = inputs[1];
+
+    int connected = 0;
+    for (int k = stereo ? 2 : 1; k < 4; ++k)
+    {
+        if (outputs[k] == nullptr)
+            continue;
+        if (cvOutputs)
+            connected |= 1 << (k - 1);
+        else
+            std::memset(outputs[k], 0, sizeof(float) * frames);
+    }
+
+    const EnvelopeStage envelopes = kEnvelopeStages[accent | slide << 1 | gate << 2];
+    const WowStage wow = kWowStages[accent];
+    const OutputStage output = stereo ? kStereoOutputStages[connected >> 1] : kOutputStages[connected];
+    const BlockStage source = stereo ? &Synth303Engine::renderStereoInput : &Synth303Engine::renderOsc;
+    const BlockStage ladder = stereo ? &Synth303Engine::renderStereoLadder : &Synth303Engine::renderLadder;
+    const BlockStage decimator = stereo ? &Synth303Engine::renderStereoDecimator : &Synth303Engine::renderDecimator;
+
+    if (probe == nullptr)
+    {
+        (this->*envelopes)(frames);
+        (this->*wow)(frames);
+        renderCoeffs(frames);
+        (this->*source)(frames);
+        (this->*ladder)(frames);
+        (this->*decimator)(frames);
+        (this->*output)(outputs, frames);
+        if (scope != nullptr && scope->attached.load(std::memory_order_relaxed))
+            renderScope(outputs[0], frames);
+        return;
+    }
+
+    runStage(EngineStage::Envelopes, frames, [&] { (this->*envelopes)(frames); });
+    runStage(EngineStage::Wow, frames, [&] { (this->*wow)(frames); });
+    runStage(EngineStage::Coeffs, frames, [&] { renderCoeffs(frames); });
+    // the input upsampling of the stereo mode stands in for the oscillator
+    runStage(EngineStage::Osc, frames, [&] { (this->*source)(frames); });
+    runStage(EngineStage::Ladder, frames, [&] { (this->*ladder)(frames); });
+    runStage(EngineStage::Decimator, frames, [&] { (this->*decimator)(frames); });
+    runStage(EngineStage::Outputs, frames, [&] { (this->*output)(outputs, frames); });
+    if (scope != nullptr && scope->attached.load(std::memory_order_relaxed))
+        renderScope(outputs[0], frames);
+}
+
+template <typename Stage>
+void Synth303Engine::runStage(EngineStage stage, uint32_t frames, Stage&& render)
+{
+    probe->stageBegin(stage, frames);
+    render();
+    probe->stageEnd(stage, frames);
+}
+
+template <bool Accent, bool Slide, bool Gate>
+void Synth303Engine::renderEnvelopes(uint32_t frames)
+{
+    const float vcfDecay = Accent ? -2.223f : decTime;
+    const float vcaDecay = Gate ? std::log2(10.0f) : -7.38f;
+
+    for (uint32_t i=0; i < frames; ++i)
+    {
+        vcf_env.process(atkTime, vcfDecay, 3, 1, false); // atk, dec, atk shape, dec shape, gate
+        vcfEnvBuffer[i] = vcf_env.output;
+
+        slideFilter.processSample(note_cv);
+        pitchBuffer[i] = Slide ? slideFilter.lastSample : note_cv;
+
+        vca_env.process(-10.2877, vcaDecay, 1, 1, false); // atk, dec, atk shape, dec shape, gate
+        vcaEnvBuffer[i] = vca_env.output;
+    }
+}
+
+template <bool Accent>
+void Synth303Engine::renderWow(uint32_t frames)
+{
+    for (uint32_t i=0; i < frames; ++i)
+        vaccBuffer[i] = wowFilter.processSample(Accent ? vcfEnvBuffer[i] * fVacc_amt : 0.0f);
+}
+
+void Synth303Engine::renderCoeffs(uint32_t frames)
+{
+    const double nyquist = fSampleRate / 2.0;
+    uint32_t clamped = 0;
+
+    if (formula != nullptr && !formula->empty())
+    {
+        const float uniforms[CutoffFormula::kUniformCount] = { fVco, fVmod, A, B, C, D, E, base, VaccMul };
+        formula->evaluate(uniforms, vcfEnvBuffer, vaccBuffer, freqBuffer, frames, formulaRegisters, blockCapacity);
+
+        for (uint32_t i=0; i < frames; ++i)
+        {
+            float freq = freqBuffer[i];
+            if (!(freq < nyquist)) {
+                freq = nyquist;
+                ++clamped;
+            }
+            freqBuffer[i] = std::max(freq, 1.0f);
+        }
+    }
+    else
+    {
+        for (uint32_t i=0; i < frames; ++i)
+        {
+            double freq = vcf_env_freq(vcfEnvBuffer[i], fVco, fVmod, vaccBuffer[i], A, B, C, D, E, base, VaccMul);
+            // extreme formula coefficients overflow exp(), NaN must not reach the ladder state
+            if (!(freq < nyquist)) {
+                freq = nyquist;
+                ++clamped;
+            }
+            freqBuffer[i] = std::max(freq, 1.0);
+        }
+    }
+
+    stats.nyquistClamps += clamped;
+    stats.lastBlockClamps = clamped;
+}
+
+void Synth303Engine::renderOsc(uint32_t frames)
+{
+    kernels->osc(osc, pitchBuffer, squareBuffer, sawBuffer, frames);
+}
+
+void Synth303Engine::renderLadder(uint32_t frames)
+{
+    // square
+    // kernels->ladder(filter, freqBuffer, fRes, squareBuffer, ladderLBuffer, frames);
+    // saw
+    kernels->ladder(filter, freqBuffer, fRes, sawBuffer, ladderLBuffer, frames);
+}
+
+void Synth303Engine::renderDecimator(uint32_t frames)
+{
+    kernels->decimate(filter, ladderLBuffer, ladderRBuffer, filterBuffer, frames);
+
+    ++stats.blocks;
+    if (filter.hasDenormalState())
+        ++stats.denormalBlocks;
+}
+
+void Synth303Engine::renderStereoInput(uint32_t frames)
+{
+    kernels->upsampleStereo(stereoFilter, blockInputs[0], blockInputs[1], inputLBuffer, inputRBuffer, frames);
+}
+
+void Synth303Engine::renderStereoLadder(uint32_t frames)
+{
+    kernels->ladderStereo(stereoFilter, freqBuffer, fRes, inputLBuffer, inputRBuffer, ladderLBuffer, ladderRBuffer, frames);
+}
+
+void Synth303Engine::renderStereoDecimator(uint32_t frames)
+{
+    kernels->decimateStereo(stereoFilter, ladderLBuffer, ladderRBuffer, filterBuffer, filterRBuffer, frames);
+
+    ++stats.blocks;
+    if (stereoFilter.hasDenormalState())
+        ++stats.denormalBlocks;
+}
+
+template <int Outputs>
+void Synth303Engine::renderOutputs(float* const* outputs, uint32_t frames)
+{
+    float* const audio = outputs[0];
+    for (uint32_t i=0; i < frames; ++i)
+        audio[i] = filterBuffer[i] * vcaEnvBuffer[i] * fSmoothGain.process(fGainLinear);
+
+    renderCvOutputs<Outputs>(outputs, frames);
+}
+
+template <int Outputs>
+void Synth303Engine::renderStereoOutputs(float* const* outputs, uint32_t frames)
+{
+    float* const left = outputs[0];
+    float* const right = outputs[1];
+    for (uint32_t i=0; i < frames; ++i)
+    {
+        const float gain = vcaEnvBuffer[i] * fSmoothGain.process(fGainLinear);
+        left[i] = filterBuffer[i] * gain;
+        right[i] = filterRBuffer[i] * gain;
+    }
+
+    renderCvOutputs<Outputs>(outputs, frames);
+}
+
+template <int Outputs>
+void Synth303Engine::renderCvOutputs(float* const* outputs, uint32_t frames)
+{
+    if (Outputs & kOutputGate)
+        std::fill_n(outputs[1], frames, gate ? 1.0f : 0.0f);
+
+    if (Outputs & kOutputPitch)
+        for (uint32_t i=0; i < frames; ++i)
+            outputs[2][i] = pitchBuffer[i] / 5.0;
+
+    if (Outputs & kOutputCutoff)
+    {
+        const double nyquist = fSampleRate / 2.0;
+        for (uint32_t i=0; i < frames; ++i)
+            outputs[3][i] = freqBuffer[i] / nyquist;
+    }
+}
+
+void Synth303Engine::renderScope(const float* audio, uint32_t frames)
+{
+    for (uint32_t i=0; i < frames; ++i)
+    {
+        if (scopeCount == 0)
+            scopeMin = scopeMax = audio[i];
+        scopeMin = std::min(scopeMin, audio[i]);
+        scopeMax = std::max(scopeMax, audio[i]);
+
+        if (++scopeCount < ScopeRing::kDecimation)
+            continue;
+        scopeCount = 0;
+
+        const ScopeFrame frame = { scopeMin, scopeMax, freqBuffer[i], vcfEnvBuffer[i], vaccBuffer[i],
+                                   (uint8_t)gate, (uint8_t)slide, (uint8_t)accent };
+        scope->push(frame);
+    }
+}
@@ -0,0 +1,443 @@
+// The 303 voice without any plugin framework around it.
+// PluginDSP forwards parameters, MIDI and audio buffers here; the offline tools drive it directly.
+
+#ifndef SYNTH303_ENGINE_H
+#define SYNTH303_ENGINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#include "DistrhoUtils.hpp"
+#include "CParamSmooth.hpp"
+#include "CutoffFormula.hpp"
+#include "DspArena.hpp"
+#include "DspKernels.hpp"
+#include "EngineProbe.hpp"
+#include "ParameterQueue.hpp"
+#include "ScopeRing.hpp"
+#include "TripleBuffer.hpp"
+
+#include "ADAREnvelope.h"
+#include "WowFilter.h"
+#include "Osc303.hpp"
+#include "AcidFilter.hpp"
+#include "SlideFilter.hpp"
+
+#include "synth303common.hpp"
+#include "Synth303Parameters.hpp"
+#include "Synth303Preset.hpp"
+
+#ifndef MIN
+#define MIN(a,b) ( (a) < (b) ? (a) : (b) )
+#endif
+
+#ifndef MAX
+#define MAX(a,b) ( (a) > (b) ? (a) : (b) )
+#endif
+
+#ifndef CLAMP
+#define CLAMP(v, min, max) (MIN((max), MAX((min), (v))))
+#endif
+
+#ifndef DB_CO
+#define DB_CO(g) ((g) > -90.0f ? powf(10.0f, (g) * 0.05f) : 0.0f)
+#endif
+
+struct Synth303Engine {
+
+    double fSampleRate = 48000.0;
+    float fGainDB = parameterDefault(kParamGain);
+    float fGainLinear = 1.0f;
+    CParamSmooth fSmoothGain { 20.0f, 48000.0f };
+
+    static constexpr int kOversampling = 4;
+
+    Osc303 osc = Osc303();
+    AcidFilter filter;
+    AcidFilterStereo stereoFilter;
+    WowFilter wowFilter;
+    SlideFilter slideFilter;
+
+    float atkTime = parameterDefault(kParamVcfAttack);
+    float decTime = parameterDefault(kParamDecay);
+
+    float fVco = parameterDefault(kParamCutoff);
+    float fRes = parameterDefault(kParamResonance);
+    float fVmod = parameterDefault(kParamVmod);
+    float fVacc_amt = parameterDefault(kParamAccent);
+
+    float A = parameterDefault(kParamFormulaA);
+    float B = parameterDefault(kParamFormulaB);
+    float C = parameterDefault(kParamFormulaC);
+    float D = parameterDefault(kParamFormulaD);
+    float E = parameterDefault(kParamFormulaE);
+    float base = parameterDefault(kParamFormulaBase);
+    float VaccMul = parameterDefault(kParamFormulaVaccMul);
+
+    // Sound parameters set through setParameter() glide to their new value over kGlideSeconds, one step
+    // every kControlFrames, so preset changes, morphs and automation jumps never click. Writing the members
+    // directly, as the offline tools do, takes effect at once.
+    //
+    // setParameter() may run on any host thread, so it only records the value in `requested` and queues it;
+    // the glides themselves are started and advanced by the audio thread alone. If the queue ever fills up,
+    // `changesLost` makes the audio thread glide every parameter to `requested` instead.
+    static constexpr uint32_t kControlFrames = 32;
+    static constexpr double kGlideSeconds = 0.01;
+    struct Glide {
+        float target = 0.0f;
+        float step = 0.0f;
+        uint32_t stepsLeft = 0;
+    };
+    Glide glides[kParamCount]; // by parameter index, see glidedMember(); audio thread only
+    uint32_t glidesActive = 0;
+    uint32_t glideSteps = 1;
+    ParameterQueue changes;
+    std::atomic<bool> changesLost { false };
+    std::atomic<float> requested[kParamCount] = {}; // what the host set last, for getParameter()
+
+    // kParamMorph blends the two presets last handed over by setMorph()
+    TripleBuffer<Synth303Morph> morphs;
+
+    // runtime cutoff formula, used instead of vcf_env_freq when set and not empty. Owned by the audio
+    // thread; setFormula() hands new ones over through `pendingFormula` and frees the ones it gets back
+    // through `retiredFormula`, so the audio thread never allocates or frees.
+    CutoffFormula* formula = nullptr;
+    std::atomic<CutoffFormula*> pendingFormula { nullptr };
+    std::atomic<CutoffFormula*> retiredFormula { nullptr };
+
+    sst::surgext_rack::dsp::envelopes::ADAREnvelope vca_env;
+    sst::surgext_rack::dsp::envelopes::ADAREnvelope vcf_env;
+
+    bool gate = false;
+    bool accent = false;
+    bool slide = false;
+
+    int nextGateOff = -1;
+    float note_cv = 0.0f;
+
+    // print note events as they arrive, from the audio thread, so only for debugging
+    bool logEvents = false;
+
+    // write gate, pitch CV and normalized cutoff to outputs[1..3], when off they are zero filled
+    bool cvOutputs = true;
+
+    // filter the stereo input instead of the oscillator, left and right on outputs[0..1]; the gate output
+    // gives way to the right channel, pitch CV and cutoff stay on outputs[2..3]. Blocks without input
+    // buffers render the oscillator as usual.
+    bool stereoInput = false;
+    const float* blockInputs[2] = {}; // of the block being rendered
+
+    // pathological cases seen while rendering, only written by the audio thread
+    struct Stats {
+        uint64_t blocks = 0;
+        uint64_t nyquistClamps = 0;  // samples whose cutoff hit fs/2 (or was not finite)
+        uint64_t denormalBlocks = 0; // blocks that ended with subnormal ladder state
+        uint64_t controlBlocks = 0;  // blocks cut to kControlFrames because parameters glided
+        uint32_t lastBlockClamps = 0;
+    } stats;
+
+    // observer of the block stages for the offline tools, null in the plugin
+    EngineProbe* probe = nullptr;
+
+    // decimated traces for the editor, written only while one is attached; null in the offline tools
+    ScopeRing* scope = nullptr;
+    uint32_t scopeCount = 0;
+    float scopeMin = 0.0f;
+    float scopeMax = 0.0f;
+
+    // instruction set for the hot loops, Auto picks the best one in activate()
+    CpuIsa isaOverride = CpuIsa::Auto;
+    const DspKernels* kernels = &getDspKernels(CpuIsa::Generic);
+
+    // scratch buffers for one block, carved from the arena in activate()
+    DspArena arena;
+    uint32_t blockCapacity = 0;
+
+    float* vcfEnvBuffer = nullptr;  // cutoff envelope
+    float* vcaEnvBuffer = nullptr;  // amplitude envelope
+    float* pitchBuffer = nullptr;   // oscillator CV after slide
+    float* vaccBuffer = nullptr;    // accent sweep from WowFilter
+    float* freqBuffer = nullptr;    // clamped cutoff in Hz
+    float* filterBuffer = nullptr;  // decimated filter output
+    float* squareBuffer = nullptr;  // oversampled
+    float* sawBuffer = nullptr;     // oversampled
+    float* ladderLBuffer = nullptr; // oversampled
+    float* ladderRBuffer = nullptr; // oversampled, right channel in stereo input mode, else an unused decimator lane
+    float* filterRBuffer = nullptr; // decimated right channel in stereo input mode
+    float* inputLBuffer = nullptr;  // oversampled stereo input
+    float* inputRBuffer = nullptr;  // oversampled stereo input
+    float* formulaRegisters = nullptr; // CutoffFormula::kMaxRegisters blocks
+
+    // ----------------------------------------------------------------------------------------------------------------
+
+    Synth303Engine() {
+        for (uint32_t index = 0; index < kParamCount; ++index)
+            if (const float* const member = glidedMember(index))
+                requested[index].store(*member, std::memory_order_relaxed);
+        requested[kParamMorph].store(0.0f, std::memory_order_relaxed);
+    }
+
+    Synth303Engine(const Synth303Engine&) = delete;
+    Synth303Engine& operator=(const Synth303Engine&) = delete;
+
+    ~Synth303Engine() {
+        delete formula;
+        delete pendingFormula.load();
+        delete retiredFormula.load();
+    }
+
+    void sampleRateChanged(double newSampleRate) {
+        fSampleRate = newSampleRate;
+        fSmoothGain.setSampleRate(newSampleRate);
+        glideSteps = std::max(1u, (uint32_t)std::lround(kGlideSeconds * newSampleRate / kControlFrames));
+    }
+
+    // not realtime safe, sizes the scratch arena for blocks of up to maxBlockSize samples and silences the voice
+    void activate(double sampleRate, uint32_t maxBlockSize);
+
+    // realtime safe, hosts may call these from the audio thread
+    void setParameter(uint32_t index, float value) {
+        // glided ones and the morph, which moves them, are applied by the audio thread
+        if (index == kParamMorph || glidedMember(index) != nullptr) {
+            requested[index].store(value, std::memory_order_relaxed);
+            if (!changes.push(index, value))
+                changesLost.store(true, std::memory_order_release);
+            return;
+        }
+        switch (index) {
+        case kParamGain: setGain(value); break;
+        // gate, pitch CV and cutoff on outputs 2-4, zero filled when off
+        case kParamCvOutputs: cvOutputs = value > 0.5f; break;
+        case kParamStereoInput: stereoInput = value > 0.5f; break;
+        }
+    }
+
+    float getParameter(uint32_t index) const {
+        // where a glide is heading, that is what the host set
+        if (index == kParamMorph || glidedMember(index) != nullptr)
+            return requested[index].load(std::memory_order_relaxed);
+        switch (index) {
+        case kParamGain: return fGainDB;
+        case kParamD: return 0.314f;
+        case kParamCutoff: return fVco;
+        case kParamResonance: return fRes;
+        case kParamVmod: return fVmod;
+        case kParamAccent: return fVacc_amt;
+        case kParamDecay: return decTime;
+        case kParamVcfAttack: return atkTime;
+        case kParamFormulaA: return A;
+        case kParamFormulaB: return B;
+        case kParamFormulaC: return C;
+        case kParamFormulaD: return D;
+        case kParamFormulaE: return E;
+        case kParamFormulaBase: return base;
+        case kParamFormulaVaccMul: return VaccMul;
+        // the cutoff formula ran into fs/2 during the last block
+        case kParamFormulaLimiter: return stats.lastBlockClamps != 0 ? 1.0f : 0.0f;
+        case kParamCvOutputs: return cvOutputs ? 1.0f : 0.0f;
+        case kParamStereoInput: return stereoInput ? 1.0f : 0.0f;
+        default: return 0.0f;
+        }
+    }
+
+    void setGain(float value) {
+        fGainDB = value;
+        fGainLinear = DB_CO(CLAMP(value, -90.0, 30.0));
+    }
+
+    // the member a parameter glides, null for the ones that switch at once (gain has its own smoother)
+    const float* glidedMember(uint32_t index) const {
+        return const_cast<Synth303Engine*>(this)->glidedMember(index);
+    }
+
+    float* glidedMember(uint32_t index) {
+        switch (index) {
+        case kParamCutoff: return &fVco;
+        case kParamResonance: return &fRes;
+        case kParamVmod: return &fVmod;
+        case kParamAccent: return &fVacc_amt;
+        case kParamDecay: return &decTime;
+        case kParamVcfAttack: return &atkTime;
+        case kParamFormulaA: return &A;
+        case kParamFormulaB: return &B;
+        case kParamFormulaC: return &C;
+        case kParamFormulaD: return &D;
+        case kParamFormulaE: return &E;
+        case kParamFormulaBase: return &base;
+        case kParamFormulaVaccMul: return &VaccMul;
+        default: return nullptr;
+        }
+    }
+
+    // audio thread
+    void glideParameter(uint32_t index, float value) {
+        float* const member = glidedMember(index);
+        Glide& glide = glides[index];
+        if (glide.stepsLeft == 0) {
+            if (value == *member)
+                return;
+            ++glidesActive;
+        }
+        glide.target = value;
+        glide.step = (value - *member) / (float)glideSteps;
+        glide.stepsLeft = glideSteps;
+    }
+
+    // audio thread, start of every process(): starts the glides queued by setParameter()
+    void applyParameterChanges();
+
+    // audio thread, once per kControlFrames while anything glides
+    void advanceGlides();
+
+    // realtime safe, all the preset's values glide like any other setParameter()
+    void applyPreset(const Synth303Preset& preset) {
+        for (int i = 0; i < Synth303Preset::kValueCount; ++i)
+            setParameter(Synth303Preset::kParams[i], preset.values[i]);
+    }
+
+    // the values the host set, including glide targets
+    Synth303Preset currentPreset() const {
+        Synth303Preset preset;
+        for (int i = 0; i < Synth303Preset::kValueCount; ++i)
+            preset.values[i] = getParameter(Synth303Preset::kParams[i]);
+        return preset;
+    }
+
+    // not realtime safe, from one non-audio thread: the two ends of kParamMorph; the next morph change
+    // blends between them, until then nothing changes
+    void setMorph(const Synth303Preset& a, const Synth303Preset& b) {
+        morphs.write().prepare(a, b);
+        morphs.publish();
+    }
+
+    // audio thread, the morphed values glide and become what getParameter() reports
+    void setMorphPosition(float position) {
+        const Synth303Morph& morph = morphs.read();
+        if (!morph.ready)
+            return;
+
+        const Synth303Preset preset = morph.at(std::clamp(position, 0.0f, 1.0f));
+        for (int i = 0; i < Synth303Preset::kValueCount; ++i)
+        {
+            const uint32_t index = Synth303Preset::kParams[i];
+            if (glidedMember(index) == nullptr) {
+                setParameter(index, preset.values[i]);
+                continue;
+            }
+            requested[index].store(preset.values[i], std::memory_order_relaxed);
+            glideParameter(index, preset.values[i]);
+        }
+    }
+
+    void printParameters() {
+        print_parameters(atkTime, decTime, fVco, fRes, fVmod, fVacc_amt, A, B, C, D, E, base, VaccMul, formula);
+    }
+
+    // not realtime safe: compiles `text`, empty for the built-in vcf_env_freq, and queues it for the audio
+    // thread, which switches at its next block. On parse errors the current formula stays and `error` says why.
+    bool setFormula(const char* text, char* error = nullptr, std::size_t errorSize = 0);
+
+    // audio thread, start of every process() call
+    void adoptFormula();
+
+    // ----------------------------------------------------------------------------------------------------------------
+
+    void midiEvent(uint8_t b0, uint8_t b1, uint8_t b2) {
+        // b0: status + channel, b1: note, b2: velocity
+        if (b0 == 0x90) {
+            if (nextGateOff == -1) {
+                if (logEvents) d_stdout("Gate ON after rest, disable slide, nextGateOff is %d", b1);
+                nextGateOff = b1;
+                accent = b2 > 100;
+                gate = true;
+                slide = false;
+                if (accent && logEvents) d_stdout("Accent!");
+                note_cv = (std::clamp((int)b1, 12, 72) - 12) / 12.0;
+                vcf_env.attackFrom(0.0f, 3, false, false); // from, shape, isDigital, isGated
+                vca_env.attackFrom(0.0f, 1, false, false); // from, shape, isDigital, isGated
+            } else {
+                if (logEvents) d_stdout("Gate ON Slide to %d, nextGateOff is %d", b1, b1);
+                nextGateOff = b1;
+                slide = true;
+                note_cv = (std::clamp((int)b1, 12, 72) - 12) / 12.0;
+            }
+        }
+        if (b0 == 0x80) {
+            if (b1 == nextGateOff) {
+                if (logEvents) d_stdout("Gate OFF (%d)", b1);
+                gate = false;
+                nextGateOff = -1;
+            } else {
+                if (logEvents) d_stdout("Ignored off for %d != %d", b1, nextGateOff);
+            }
+        }
+    }
+
+    // renders up to each event's frame before applying it, so every sub-block runs with a constant
+    // gate/accent/slide state; Event is anything with `frame` and `data[3]`, like DPF's MidiEvent.
+    // inputs are the two audio inputs for the stereo input mode, may be null
+    template <typename Event>
+    void run(float** outputs, uint32_t frames, const Event* events, uint32_t eventCount,
+             const float* const* inputs = nullptr) {
+        uint32_t offset = 0;
+        for (uint32_t m = 0; m < eventCount; ++m)
+        {
+            const uint32_t frame = std::min<uint32_t>(events[m].frame, frames);
+            if (frame > offset)
+            {
+                processFrom(outputs, offset, frame - offset, inputs);
+                offset = frame;
+            }
+            midiEvent(events[m].data[0], events[m].data[1], events[m].data[2]);
+        }
+
+        if (offset < frames)
+            processFrom(outputs, offset, frames - offset, inputs);
+    }
+
+    void processFrom(float** outputs, uint32_t offset, uint32_t frames, const float* const* inputs = nullptr) {
+        float* blockOutputs[4];
+        for (int k = 0; k < 4; ++k)
+            blockOutputs[k] = outputs[k] != nullptr ? outputs[k] + offset : nullptr;
+        const float* blockInputs[2] = {};
+        for (int k = 0; k < 2 && inputs != nullptr; ++k)
+            blockInputs[k] = inputs[k] != nullptr ? inputs[k] + offset : nullptr;
+        process(blockOutputs, frames, blockInputs);
+    }
+
+    // outputs: audio, gate, pitch CV and normalized cutoff, outputs[1..3] may be null
+    // blocks larger than the arena are rendered in several passes
+    void process(float** outputs, uint32_t frames, const float* const* inputs = nullptr);
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // stages, each one runs over the whole block, see Synth303Engine.cpp
+    //
+    // gate, accent and slide only change between blocks (on MIDI events), so the stages that depend on them
+    // and on the connected outputs are compiled once per combination and picked at the start of every block
+
+    enum OutputMask {
+        kOutputGate = 1 << 0,
+        kOutputPitch = 1 << 1,
+        kOutputCutoff = 1 << 2,
+    };
+
+    void renderBlock(float* const* outputs, uint32_t frames, const float* const* inputs);
+    template <typename Stage> void runStage(EngineStage stage, uint32_t frames, Stage&& render);
+    template <bool Accent, bool Slide, bool Gate> void renderEnvelopes(uint32_t frames);
+    template <bool Accent> void renderWow(uint32_t frames);
+    void renderCoeffs(uint32_t frames);
+    void renderOsc(uint32_t frames);
+    void renderLadder(uint32_t frames);
+    void renderDecimator(uint32_t frames);
+    void renderStereoInput(uint32_t frames);
+    void renderStereoLadder(uint32_t frames);
+    void renderStereoDecimator(uint32_t frames);
+    template <int Outputs> void renderOutputs(float* const* outputs, uint32_t frames);
+    template <int Outputs> void renderStereoOutputs(float* const* outputs, uint32_t frames);
+    template <int Outputs> void renderCvOutputs(float* const* outputs, uint32_t frames);
+    void renderScope(const float* audio, uint32_t frames);
+};
+
+#endif // SYNTH303_ENGINE_H
@@ -0,0 +1,57 @@
+// Parameter indices shared by the DSP, the UI and the engine. Append only, hosts store them by index.
+
+#ifndef SYNTH303_PARAMETERS_H
+#define SYNTH303_PARAMETERS_H
+
+enum Synth303Parameter {
+    kParamGain = 0,
+    kParamA,
+    kParamB,
+    kParamC,
+    kParamD,
+    kParamCutoff,
+    kParamResonance,
+    kParamVmod,
+    kParamAccent,
+    kParamDecay,
+    kParamVcfAttack,
+    kParamFormulaA,
+    kParamFormulaB,
+    kParamFormulaC,
+    kParamFormulaD,
+    kParamFormulaE,
+    kParamFormulaBase,
+    kParamFormulaVaccMul,
+    kParamFormulaLimiter,
+    kParamPrintParameters,
+    kParamCvOutputs,
+    kParamScopeId,
+    kParamStereoInput,
+    kParamMorph,
+    kParamSequencer,
+    kParamCount
+};
+
+// The default of each sound parameter: what PluginDSP declares to the host, what the engine and the editor
+// start from and what the "Init" preset holds. Zero for everything else.
+static constexpr float parameterDefault(int index) {
+    switch (index) {
+    case kParamGain: return 0.0f;
+    case kParamCutoff: return 12.0f;
+    case kParamResonance: return 1.0f;
+    case kParamVmod: return 1.0f;
+    case kParamAccent: return 0.0f;
+    case kParamDecay: return -2.223f;
+    case kParamVcfAttack: return -9.482f;
+    case kParamFormulaA: return 2.243f;
+    case kParamFormulaB: return 0.626f;
+    case kParamFormulaC: return 0.364f;
+    case kParamFormulaD: return 1.121f;
+    case kParamFormulaE: return 4.462f;
+    case kParamFormulaBase: return -119.205f;
+    case kParamFormulaVaccMul: return 2.0f;
+    default: return 0.0f;
+    }
+}
+
+#endif // SYNTH303_PARAMETERS_H
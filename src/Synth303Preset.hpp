@@ -0,0 +1,181 @@
+// Presets: the sound parameters of one patch, the factory bank and a compact text-safe state format.
+//
+// A preset is stored as base64 of "S3", a version byte, a value count and that many little-endian float32
+// values, in kParams order. kParams is append only like the parameters themselves: an older blob simply
+// has fewer values and the missing ones keep their defaults.
+
+#ifndef SYNTH303_PRESET_H
+#define SYNTH303_PRESET_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "Synth303Parameters.hpp"
+
+struct Synth303Preset {
+    static constexpr int kValueCount = 14;
+    static constexpr uint8_t kVersion = 1;
+
+    // what the values are, in the order they are stored
+    static constexpr uint32_t kParams[kValueCount] = {
+        kParamGain, kParamCutoff, kParamResonance, kParamVmod, kParamAccent, kParamDecay, kParamVcfAttack,
+        kParamFormulaA, kParamFormulaB, kParamFormulaC, kParamFormulaD, kParamFormulaE,
+        kParamFormulaBase, kParamFormulaVaccMul,
+    };
+
+    // base64 of the header and the values, plus the terminator
+    static constexpr std::size_t kEncodedSize = (4 + 4 * kValueCount + 2) / 3 * 4 + 1;
+
+    float values[kValueCount] = {};
+
+    // the parameter defaults, see parameterDefault()
+    constexpr Synth303Preset() {
+        for (int i = 0; i < kValueCount; ++i)
+            values[i] = parameterDefault(kParams[i]);
+    }
+
+    static Synth303Preset withSettings(float fVco, float fRes, float fVmod, float fVacc_amt, float decTime) {
+        Synth303Preset preset;
+        preset.values[1] = fVco;
+        preset.values[2] = fRes;
+        preset.values[3] = fVmod;
+        preset.values[4] = fVacc_amt;
+        preset.values[5] = decTime;
+        return preset;
+    }
+
+    void encode(char out[kEncodedSize]) const {
+        uint8_t bytes[4 + 4 * kValueCount] = { 'S', '3', kVersion, kValueCount };
+        for (int i = 0; i < kValueCount; ++i)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &values[i], 4);
+            for (int b = 0; b < 4; ++b)
+                bytes[4 + 4 * i + b] = (uint8_t)(bits >> (8 * b));
+        }
+
+        static const char kDigits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        char* o = out;
+        for (std::size_t i = 0; i < sizeof(bytes); i += 3)
+        {
+            const std::size_t left = sizeof(bytes) - i;
+            const uint32_t group = (uint32_t)bytes[i] << 16
+                                 | (left > 1 ? (uint32_t)bytes[i + 1] << 8 : 0)
+                                 | (left > 2 ? (uint32_t)bytes[i + 2] : 0);
+            *o++ = kDigits[(group >> 18) & 63];
+            *o++ = kDigits[(group >> 12) & 63];
+            *o++ = left > 1 ? kDigits[(group >> 6) & 63] : '=';
+            *o++ = left > 2 ? kDigits[group & 63] : '=';
+        }
+        *o = '\0';
+    }
+
+    // false, leaving the values alone, when text is not a preset; stops at the first character outside
+    // the base64 alphabet, so several presets can share one string separated by spaces
+    bool decode(const char* text) {
+        uint8_t bytes[4 + 4 * 255];
+        std::size_t size = 0;
+        uint32_t group = 0;
+        int digits = 0;
+
+        for (; *text != '\0' && *text != '='; ++text)
+        {
+            const char c = *text;
+            int digit;
+            if (c >= 'A' && c <= 'Z') digit = c - 'A';
+            else if (c >= 'a' && c <= 'z') digit = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') digit = c - '0' + 52;
+            else if (c == '+') digit = 62;
+            else if (c == '/') digit = 63;
+            else break;
+
+            group = group << 6 | (uint32_t)digit;
+            if (++digits == 4)
+            {
+                if (size + 3 > sizeof(bytes))
+                    return false;
+                bytes[size++] = (uint8_t)(group >> 16);
+                bytes[size++] = (uint8_t)(group >> 8);
+                bytes[size++] = (uint8_t)group;
+                group = 0;
+                digits = 0;
+            }
+        }
+        if (digits >= 2 && size + 2 <= sizeof(bytes))
+        {
+            group <<= 6 * (4 - digits);
+            bytes[size++] = (uint8_t)(group >> 16);
+            if (digits == 3)
+                bytes[size++] = (uint8_t)(group >> 8);
+        }
+
+        if (size < 4 || bytes[0] != 'S' || bytes[1] != '3' || bytes[2] < 1 || size < 4 + 4 * (std::size_t)bytes[3])
+            return false;
+
+        const int count = bytes[3] < kValueCount ? bytes[3] : kValueCount;
+        for (int i = 0; i < count; ++i)
+        {
+            const uint32_t bits = (uint32_t)bytes[4 + 4 * i]
+                                | (uint32_t)bytes[5 + 4 * i] << 8
+                                | (uint32_t)bytes[6 + 4 * i] << 16
+                                | (uint32_t)bytes[7 + 4 * i] << 24;
+            float value;
+            std::memcpy(&value, &bits, 4);
+            if (std::isfinite(value))
+                values[i] = value;
+        }
+        return true;
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+// Two presets prepared for kParamMorph. Blending happens on the knob values, which the engine already
+// maps to filter and envelope coefficients per control block; decay and attack are log2 times, so they
+// blend geometrically, and gain is blended as amplitude rather than in dB so the middle is not a dip.
+struct Synth303Morph {
+    Synth303Preset a;
+    Synth303Preset b;
+    float gainA = 1.0f;
+    float gainB = 1.0f;
+    bool ready = false;
+
+    void prepare(const Synth303Preset& first, const Synth303Preset& second) {
+        a = first;
+        b = second;
+        gainA = std::pow(10.0f, a.values[0] * 0.05f);
+        gainB = std::pow(10.0f, b.values[0] * 0.05f);
+        ready = true;
+    }
+
+    Synth303Preset at(float position) const {
+        Synth303Preset preset;
+        for (int i = 1; i < Synth303Preset::kValueCount; ++i)
+            preset.values[i] = a.values[i] + (b.values[i] - a.values[i]) * position;
+
+        const float gain = gainA + (gainB - gainA) * position;
+        preset.values[0] = gain > 0.0f ? 20.0f * std::log10(gain) : -90.0f;
+        return preset;
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+struct FactoryPreset {
+    const char* name;
+    Synth303Preset preset;
+};
+
+// the canonical pattern settings of tools/Workload.hpp, so every factory sound has a golden render
+static const FactoryPreset kFactoryPresets[] = {
+    { "Init", Synth303Preset() },
+    { "Squelch", Synth303Preset::withSettings(4.9f, 1.0f, 1.0f, 1.0f, -1.0f) },
+    { "Closed", Synth303Preset::withSettings(2.36f, 0.5f, 0.099f, 0.0f, -2.223f) },
+    { "Long decay", Synth303Preset::withSettings(7.0f, 0.8f, 0.5f, 0.5f, 1.32f) },
+    { "Accents", Synth303Preset::withSettings(8.0f, 0.9f, 0.283f, 1.0f, -2.223f) },
+};
+
+static constexpr uint32_t kFactoryPresetCount = sizeof(kFactoryPresets) / sizeof(kFactoryPresets[0]);
+
+#endif // SYNTH303_PRESET_H
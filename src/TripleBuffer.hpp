@@ -0,0 +1,47 @@
+// Latest-value handoff from one writer thread to the audio thread, the scheme CurveWorker uses for its sets.
+//
+// Three slots swapped with atomic exchanges: the writer fills one, the reader uses another and the third is
+// the handoff slot. Neither side waits, and a slot the reader holds is never written, however often the
+// writer publishes.
+
+#ifndef SYNTH303_TRIPLE_BUFFER_H
+#define SYNTH303_TRIPLE_BUFFER_H
+
+#include <atomic>
+
+template <typename T>
+class TripleBuffer {
+public:
+    // not thread safe, before the reader starts: every slot starts out as `value`
+    void reset(const T& value) {
+        for (T& slot : slots)
+            slot = value;
+    }
+
+    // writer thread: fill the slot write() returns, then publish() it
+    T& write() {
+        return slots[back];
+    }
+
+    void publish() {
+        back = handoff.exchange(back | kFresh, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    // reader thread: the newest published value, or the one read last when there is none since
+    const T& read() {
+        if ((handoff.load(std::memory_order_acquire) & kFresh) != 0)
+            front = handoff.exchange(front, std::memory_order_acq_rel) & kIndexMask;
+        return slots[front];
+    }
+
+private:
+    static constexpr int kIndexMask = 3;
+    static constexpr int kFresh = 4;
+
+    T slots[3];
+    int back = 0;                   // writer thread
+    int front = 2;                  // reader thread
+    std::atomic<int> handoff { 1 }; // index, plus kFresh when the writer put a slot there
+};
+
+#endif // SYNTH303_TRIPLE_BUFFER_H
@@ -0,0 +1,136 @@
+// C interface of synth303.h over Synth303Engine.
+
+#include "synth303.h"
+#include "Synth303Engine.hpp"
+
+#include <cstring>
+#include <new>
+#include <string>
+
+// --------------------------------------------------------------------------------------------------------------------
+
+struct synth303 {
+    struct Event {
+        uint32_t frame;
+        uint8_t data[3];
+    };
+
+    Synth303Engine engine;
+
+    // kept in frame order for Synth303Engine::run(), cleared by every process
+    Event events[SYNTH303_MAX_EVENTS];
+    uint32_t eventCount = 0;
+
+    // the states as last set, the engine only keeps what it compiled from them
+    std::string formula;
+    std::string morph;
+};
+
+static size_t copyState(const char* value, char* buffer, size_t size)
+{
+    const size_t needed = std::strlen(value) + 1;
+    if (buffer != nullptr && needed <= size)
+        std::memcpy(buffer, value, needed);
+    return needed;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+synth303* synth303_create(void)
+{
+    return new (std::nothrow) synth303();
+}
+
+void synth303_destroy(synth303* synth)
+{
+    delete synth;
+}
+
+int synth303_prepare(synth303* synth, double sample_rate, uint32_t max_block)
+{
+    if (!(sample_rate > 0.0))
+        return -1;
+
+    synth->engine.activate(sample_rate, max_block);
+    synth->eventCount = 0;
+    return 0;
+}
+
+void synth303_set_parameter(synth303* synth, uint32_t index, float value)
+{
+    synth->engine.setParameter(index, value);
+}
+
+float synth303_get_parameter(const synth303* synth, uint32_t index)
+{
+    return synth->engine.getParameter(index);
+}
+
+int synth303_queue_event(synth303* synth, uint32_t frame, const uint8_t data[3])
+{
+    if (synth->eventCount == SYNTH303_MAX_EVENTS)
+        return -1;
+
+    // after the ones at the same frame, so events keep the order they were queued in
+    uint32_t i = synth->eventCount++;
+    for (; i > 0 && synth->events[i - 1].frame > frame; --i)
+        synth->events[i] = synth->events[i - 1];
+
+    synth->events[i].frame = frame;
+    std::memcpy(synth->events[i].data, data, 3);
+    return 0;
+}
+
+void synth303_process(synth303* synth, const float* const* inputs, float* const* outputs, uint32_t frames)
+{
+    float* blockOutputs[SYNTH303_OUTPUT_COUNT];
+    std::memcpy(blockOutputs, outputs, sizeof(blockOutputs));
+
+    synth->engine.run(blockOutputs, frames, synth->events, synth->eventCount, inputs);
+    synth->eventCount = 0;
+}
+
+size_t synth303_get_state(const synth303* synth, const char* key, char* buffer, size_t size)
+{
+    if (std::strcmp(key, "preset") == 0)
+    {
+        char text[Synth303Preset::kEncodedSize];
+        synth->engine.currentPreset().encode(text);
+        return copyState(text, buffer, size);
+    }
+    if (std::strcmp(key, "formula") == 0)
+        return copyState(synth->formula.c_str(), buffer, size);
+    if (std::strcmp(key, "morph") == 0)
+        return copyState(synth->morph.c_str(), buffer, size);
+    return 0;
+}
+
+int synth303_set_state(synth303* synth, const char* key, const char* value)
+{
+    if (std::strcmp(key, "preset") == 0)
+    {
+        Synth303Preset preset = synth->engine.currentPreset();
+        if (!preset.decode(value))
+            return -1;
+        synth->engine.applyPreset(preset);
+        return 0;
+    }
+    if (std::strcmp(key, "formula") == 0)
+    {
+        if (!synth->engine.setFormula(value))
+            return -1;
+        synth->formula = value;
+        return 0;
+    }
+    if (std::strcmp(key, "morph") == 0)
+    {
+        Synth303Preset a, b;
+        const char* const second = std::strchr(value, ' ');
+        if (second == nullptr || !a.decode(value) || !b.decode(second + 1))
+            return -1;
+        synth->engine.setMorph(a, b);
+        synth->morph = value;
+        return 0;
+    }
+    return -1;
+}
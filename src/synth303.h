@@ -0,0 +1,94 @@
+/*
+ * C interface to the synth303 engine, for hosts and test tools that do not use DPF.
+ *
+ * The library wraps the same Synth303Engine the plugin runs. Only synth303_create(), synth303_prepare() and
+ * synth303_set_state() allocate. Everything else is realtime safe. synth303_process() renders straight into
+ * the caller's buffers, without copying. One instance must not be used from two threads at once.
+ *
+ * Typical use:
+ *
+ *     synth303* synth = synth303_create();
+ *     synth303_prepare(synth, 48000.0, 256);
+ *     synth303_set_parameter(synth, kParamCutoff, 6.0f);
+ *     const uint8_t on[3] = { 0x90, 36, 127 };
+ *     synth303_queue_event(synth, 17, on);
+ *     synth303_process(synth, NULL, outputs, 256);
+ *     synth303_destroy(synth);
+ */
+
+#ifndef SYNTH303_H
+#define SYNTH303_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Synth303Parameters.hpp"
+
+#if defined(_WIN32) && defined(SYNTH303_BUILDING_LIBRARY)
+# define SYNTH303_API __declspec(dllexport)
+#elif defined(__GNUC__) && defined(SYNTH303_BUILDING_LIBRARY)
+# define SYNTH303_API __attribute__((visibility("default")))
+#else
+# define SYNTH303_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct synth303 synth303;
+
+/* how many events synth303_queue_event() holds until the next synth303_process() */
+#define SYNTH303_MAX_EVENTS 1024
+
+/* outputs of synth303_process(), see there */
+#define SYNTH303_OUTPUT_COUNT 4
+
+/* a new instance with the engine defaults, NULL when out of memory */
+SYNTH303_API synth303* synth303_create(void);
+
+SYNTH303_API void synth303_destroy(synth303* synth);
+
+/* Not realtime safe. Sizes every buffer for blocks of up to max_block frames and resets the voice: a held
+ * note is dropped, both envelopes end and the filter and resampler histories are cleared. Parameters, the
+ * formula and the morph presets are kept. Call it before the first synth303_process() and again whenever
+ * the rate changes. Returns 0 on success. */
+SYNTH303_API int synth303_prepare(synth303* synth, double sample_rate, uint32_t max_block);
+
+/* index is a Synth303Parameter; sound parameters glide to the new value over about 10 ms */
+SYNTH303_API void synth303_set_parameter(synth303* synth, uint32_t index, float value);
+
+SYNTH303_API float synth303_get_parameter(const synth303* synth, uint32_t index);
+
+/* Queues a 3-byte MIDI message (note on/off) at `frame` frames into the next synth303_process() block.
+ * Frames past the end of that block apply at its end. Returns 0, or -1 when the queue is full. */
+SYNTH303_API int synth303_queue_event(synth303* synth, uint32_t frame, const uint8_t data[3]);
+
+/* Renders `frames` frames and applies the queued events at their frames.
+ *
+ * outputs holds SYNTH303_OUTPUT_COUNT planar buffers: audio, gate, pitch CV and normalized cutoff. Only
+ * outputs[0] is required. With kParamCvOutputs off, outputs 1-3 are zero filled.
+ *
+ * inputs holds two planar buffers, or is NULL. It is only read when kParamStereoInput is on. In that
+ * mode outputs[0] and outputs[1] are the filtered left and right channels.
+ *
+ * Blocks longer than max_block are rendered in several passes. */
+SYNTH303_API void synth303_process(synth303* synth, const float* const* inputs, float* const* outputs,
+                                   uint32_t frames);
+
+/* Copies the state `key` into buffer, including the terminator, when it fits. Returns the size needed, or
+ * 0 for an unknown key. Keys:
+ *   "preset"   the sound parameters in the compact preset format (see Synth303Preset.hpp)
+ *   "formula"  cutoff formula text, empty for the built-in one
+ *   "morph"    the two presets kParamMorph blends, separated by a space */
+SYNTH303_API size_t synth303_get_state(const synth303* synth, const char* key, char* buffer, size_t size);
+
+/* Not realtime safe. Sets a state from synth303_get_state(); "preset" glides to the stored sound.
+ * Returns 0, or -1 when the key is unknown or the value does not parse (nothing changes then). */
+SYNTH303_API int synth303_set_state(synth303* synth, const char* key, const char* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYNTH303_H */
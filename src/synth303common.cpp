@@ -1,5 +1,8 @@
 #include "synth303common.hpp"
+#include "CutoffFormula.hpp"
+#include "DistrhoUtils.hpp"
 #include <cmath>
+#include <cstring>
 
 float vcf_env_freq(float vcf_env, float Vco, float Vmod_amt, float Vacc, float A, float B, float C, float D, float E, float base, float VaccMul) {
     float Vmod_scale = 6.9*Vmod_amt+1.3;
@@ -9,3 +12,84 @@ float vcf_env_freq(float vcf_env, float Vco, float Vmod_amt, float Vacc, float A
     // Ic,11 = (A*Vco + B)*e^(C*Vmod + D*Vacc +E)
     return (A * Vco + B) * std::exp(C * Vmod + D * (Vacc * VaccMul) + E) + base; // + D * Vacc
 }
+
+void print_parameters(float atkTime, float decTime, float fVco, float fRes, float fVmod, float fVacc_amt,
+                      float A, float B, float C, float D, float E, float base, float VaccMul,
+                      const CutoffFormula* formula) {
+    d_stdout("---------");
+
+    d_stdout("float atkTime = %f;", atkTime);
+    d_stdout("float decTime = %f;", decTime);
+
+    d_stdout("float fVco = %f;", fVco);
+    d_stdout("float fRes = %f;", fRes);
+    d_stdout("float fVmod = %f;", fVmod);
+    d_stdout("float fVacc_amt = %f;", fVacc_amt);
+
+    d_stdout("float A = %f;", A);
+    d_stdout("float B = %f;", B);
+    d_stdout("float C = %f;", C);
+    d_stdout("float D = %f;", D);
+    d_stdout("float E = %f;", E);
+    d_stdout("float base = %f;", base);
+    d_stdout("float VaccMul = %f;", VaccMul);
+
+    float freq_min = vcf_env_freq(0.0, fVco, fVmod, 0.0, A, B, C, D, E, base, VaccMul);
+    float freq_max = vcf_env_freq(1.01, fVco, fVmod, 0.0, A, B, C, D, E, base, VaccMul);
+    if (formula != nullptr && !formula->empty()) {
+        const float uniforms[CutoffFormula::kUniformCount] = { fVco, fVmod, A, B, C, D, E, base, VaccMul };
+        freq_min = formula->evaluate(uniforms, 0.0f, 0.0f);
+        freq_max = formula->evaluate(uniforms, 1.01f, 0.0f);
+    }
+    d_stdout("Freq min %f Freq max %f", freq_min, freq_max);
+
+    d_stdout("---------");
+}
+
+// exp for the batch loop, range reduction to 2^n * e^r with |r| <= ln2/2 and a degree 6 polynomial.
+// Written without branches or float compares so it if-converts and vectorizes with plain SSE2.
+static inline float exp_poly(float x)
+{
+    // round to nearest by pushing the fraction out of the mantissa, n is then also in the low bits
+    const float shifted = x * 1.44269504f + 12582912.0f;
+    const float n = shifted - 12582912.0f;
+    const float r = (x - n * 0.693359375f) + n * 2.12194440e-4f;
+
+    float p = 1.9875691500e-4f;
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    p = p * r * r + r + 1.0f;
+
+    // 2^n from the integer bits, clamped so out of range inputs come out far off but finite
+    int32_t e;
+    std::memcpy(&e, &shifted, sizeof(e));
+    e -= 0x4B400000;
+    e = e < 127 ? e : 127;
+    e = e > -126 ? e : -126;
+
+    const int32_t bits = (e + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+void vcf_env_freq_batch(const float* vcf_env, const float* Vco, const float* Vmod_amt, const float* Vacc, float* __restrict out,
+                        uint32_t count, float A, float B, float C, float D, float E, float base, float VaccMul)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const float Vmod_scale = 6.9f * Vmod_amt[i] + 1.3f;
+        const float Vmod_bias = -1.2f * Vmod_amt[i] + 3.0f;
+        const float Vmod = (Vmod_scale * vcf_env[i] + Vmod_bias) - 3.2f;
+        out[i] = (A * Vco[i] + B) * exp_poly(C * Vmod + D * (Vacc[i] * VaccMul) + E) + base;
+    }
+}
+
+void exp_batch(const float* in, float* out, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+        out[i] = exp_poly(in[i]);
+}
@@ -1 +1,20 @@
+#include <cstdint>
+
 float vcf_env_freq(float vcf_env, float Vco, float Vmod_amt, float Vacc, float A, float B, float C, float D, float E, float base, float VaccMul);
+
+struct CutoffFormula;
+
+// Prints the knobs with d_stdout, as declarations ready to paste back into the defaults, followed by the
+// cutoff range they give: through `formula` when it is not null or empty, vcf_env_freq otherwise.
+void print_parameters(float atkTime, float decTime, float fVco, float fRes, float fVmod, float fVacc_amt,
+                      float A, float B, float C, float D, float E, float base, float VaccMul,
+                      const CutoffFormula* formula);
+
+// vcf_env_freq over arrays, for calibration and analysis tools that evaluate many points per constant set.
+// The loop vectorizes (exp is a polynomial instead of std::exp), results agree with the scalar version to
+// about 1e-6 relative.
+void vcf_env_freq_batch(const float* vcf_env, const float* Vco, const float* Vmod_amt, const float* Vacc, float* out,
+                        uint32_t count, float A, float B, float C, float D, float E, float base, float VaccMul);
+
+// the polynomial exp of vcf_env_freq_batch over an array, in place if in == out
+void exp_batch(const float* in, float* out, uint32_t count);
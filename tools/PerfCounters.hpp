@@ -0,0 +1,191 @@
+// Hardware performance counters through perf_event_open, read as one group so every counter covers the
+// same instructions. User space only, scaled when the kernel multiplexes them.
+//
+// Counters the CPU, kernel or container does not provide are left out and reported as unavailable;
+// when not even cycles can be opened (other OS, perf_event_paranoid, seccomp) the whole set is off and
+// the tools fall back to wall-clock numbers.
+
+#ifndef SYNTH303_TOOLS_PERF_COUNTERS_H
+#define SYNTH303_TOOLS_PERF_COUNTERS_H
+
+#include "EngineProbe.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+struct PerfCounters {
+
+    enum Counter { kCycles, kInstructions, kBranchMisses, kL1dMisses, kLlcMisses, kCount };
+
+    static const char* name(int counter) {
+        static const char* const names[kCount] = { "cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses" };
+        return names[counter];
+    }
+
+    int fds[kCount];
+    int slots[kCount]; // position in the group read, -1 if not available
+    int opened = 0;
+    char error[128] = {};
+
+    PerfCounters() {
+        for (int c = 0; c < kCount; ++c)
+            fds[c] = slots[c] = -1;
+    }
+
+    ~PerfCounters() {
+        close();
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const {
+        return opened != 0;
+    }
+
+    bool has(int counter) const {
+        return slots[counter] >= 0;
+    }
+
+#ifdef __linux__
+    bool open() {
+        static const struct { uint32_t type; uint64_t config; } kEvents[kCount] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+        };
+
+        for (int c = 0; c < kCount; ++c)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = kEvents[c].type;
+            attr.config = kEvents[c].config;
+            attr.disabled = c == kCycles;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            const int leader = c == kCycles ? -1 : fds[kCycles];
+            const int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+            if (fd < 0)
+            {
+                if (c == kCycles)
+                {
+                    std::snprintf(error, sizeof(error), "perf_event_open: %s (see /proc/sys/kernel/perf_event_paranoid)",
+                                  std::strerror(errno));
+                    return false;
+                }
+                continue;
+            }
+
+            fds[c] = fd;
+            slots[c] = opened++;
+        }
+
+        ioctl(fds[kCycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[kCycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+    }
+
+    void close() {
+        for (int c = 0; c < kCount; ++c)
+        {
+            if (fds[c] >= 0)
+                ::close(fds[c]);
+            fds[c] = slots[c] = -1;
+        }
+        opened = 0;
+    }
+
+    // current counts, scaled for multiplexing, missing counters read 0
+    bool read(double values[kCount]) const {
+        uint64_t data[3 + kCount];
+        if (opened == 0 || ::read(fds[kCycles], data, sizeof(uint64_t) * (3 + opened)) <= 0)
+            return false;
+
+        const double scale = data[2] != 0 ? (double)data[1] / (double)data[2] : 1.0;
+        for (int c = 0; c < kCount; ++c)
+            values[c] = slots[c] >= 0 ? (double)data[3 + slots[c]] * scale : 0.0;
+        return true;
+    }
+#else
+    bool open() {
+        std::snprintf(error, sizeof(error), "hardware counters are only implemented on Linux");
+        return false;
+    }
+
+    void close() {}
+
+    bool read(double*) const {
+        return false;
+    }
+#endif
+};
+
+// Accumulates counter deltas per engine stage.
+struct PerfStageProbe : EngineProbe {
+
+    PerfCounters& counters;
+    double begin[PerfCounters::kCount] = {};
+    double totals[(int)EngineStage::Count][PerfCounters::kCount] = {};
+    uint64_t frames[(int)EngineStage::Count] = {};
+
+    explicit PerfStageProbe(PerfCounters& c) : counters(c) {}
+
+    void stageBegin(EngineStage, uint32_t) override {
+        counters.read(begin);
+    }
+
+    void stageEnd(EngineStage stage, uint32_t n) override {
+        double end[PerfCounters::kCount];
+        if (!counters.read(end))
+            return;
+        for (int c = 0; c < PerfCounters::kCount; ++c)
+            totals[(int)stage][c] += end[c] - begin[c];
+        frames[(int)stage] += n;
+    }
+
+    void print(std::FILE* out) const {
+        std::fprintf(out, "%-10s | %10s %10s %6s | %10s %10s %10s   (per sample)\n", "stage", "cycles", "instr",
+                     "IPC", "br-miss", "L1d-miss", "LLC-miss");
+
+        for (int s = 0; s < (int)EngineStage::Count; ++s)
+        {
+            if (frames[s] == 0)
+                continue;
+
+            const double* t = totals[s];
+            const double n = (double)frames[s];
+            std::fprintf(out, "%-10s | %10.2f", engineStageName((EngineStage)s), t[PerfCounters::kCycles] / n);
+            if (counters.has(PerfCounters::kInstructions))
+                std::fprintf(out, " %10.2f %6.2f", t[PerfCounters::kInstructions] / n,
+                             t[PerfCounters::kCycles] > 0.0 ? t[PerfCounters::kInstructions] / t[PerfCounters::kCycles] : 0.0);
+            else
+                std::fprintf(out, " %10s %6s", "n/a", "n/a");
+            std::fprintf(out, " |");
+            for (int c : { PerfCounters::kBranchMisses, PerfCounters::kL1dMisses, PerfCounters::kLlcMisses })
+            {
+                if (counters.has(c))
+                    std::fprintf(out, " %10.4f", t[c] / n);
+                else
+                    std::fprintf(out, " %10s", "n/a");
+            }
+            std::fprintf(out, "\n");
+        }
+    }
+};
+
+#endif // SYNTH303_TOOLS_PERF_COUNTERS_H
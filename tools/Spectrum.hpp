@@ -0,0 +1,83 @@
+// Windowed power spectra for the analysis tools: an in-place radix-2 FFT in double precision and a Hann
+// window, nothing clever, the analysis is offline.
+
+#ifndef SYNTH303_TOOLS_SPECTRUM_H
+#define SYNTH303_TOOLS_SPECTRUM_H
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+struct Spectrum {
+
+    std::size_t size;
+    std::vector<double> window;
+    std::vector<std::complex<double>> twiddles;
+    std::vector<std::complex<double>> buffer;
+    double windowPower = 0.0; // sum of window^2, for scaling to the input's mean square
+
+    // size must be a power of two
+    explicit Spectrum(std::size_t n)
+        : size(n), window(n), twiddles(n / 2), buffer(n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            window[i] = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / n);
+            windowPower += window[i] * window[i];
+        }
+        for (std::size_t k = 0; k < n / 2; ++k)
+            twiddles[k] = std::polar(1.0, -2.0 * M_PI * k / n);
+    }
+
+    std::size_t bins() const {
+        return size / 2 + 1;
+    }
+
+    double binHz(double sampleRate) const {
+        return sampleRate / size;
+    }
+
+    // power of the Hann windowed `in` (size samples) per bin, out holds bins() values. Scaled so the bins
+    // sum to the mean square of `in`; a sine's power spreads over about three bins.
+    void power(const float* in, double* out) {
+        for (std::size_t i = 0; i < size; ++i)
+            buffer[i] = in[i] * window[i];
+        transform();
+
+        for (std::size_t k = 0; k < bins(); ++k)
+        {
+            const double scale = (k == 0 || k == size / 2) ? 1.0 : 2.0;
+            out[k] = scale * std::norm(buffer[k]) / (windowPower * size);
+        }
+    }
+
+    // in-place decimation in time over `buffer`
+    void transform() {
+        for (std::size_t i = 1, j = 0; i < size; ++i)
+        {
+            std::size_t bit = size >> 1;
+            for (; j & bit; bit >>= 1)
+                j ^= bit;
+            j ^= bit;
+            if (i < j)
+                std::swap(buffer[i], buffer[j]);
+        }
+
+        for (std::size_t length = 2; length <= size; length <<= 1)
+        {
+            const std::size_t stride = size / length;
+            for (std::size_t start = 0; start < size; start += length)
+            {
+                for (std::size_t k = 0; k < length / 2; ++k)
+                {
+                    const std::complex<double> t = twiddles[k * stride] * buffer[start + k + length / 2];
+                    buffer[start + k + length / 2] = buffer[start + k] - t;
+                    buffer[start + k] += t;
+                }
+            }
+        }
+    }
+};
+
+#endif // SYNTH303_TOOLS_SPECTRUM_H
@@ -0,0 +1,57 @@
+// Layout of the datasets written by synth303-sweep. Everything is little endian and fixed size, so the
+// file can be memory-mapped and indexed directly, e.g. with numpy:
+//
+//   header = np.fromfile(path, dtype=HEADER_DTYPE, count=1)
+//   index  = np.memmap(path, dtype=ENTRY_DTYPE, mode="r", offset=header["indexOffset"], shape=(count,))
+//   wave   = np.memmap(path, dtype="<f4", mode="r", offset=entry["waveformOffset"], shape=(frames,))
+//
+// [header][index: recordCount entries][padding to 64][record 0: waveform, cutoff][record 1]...
+
+#ifndef SYNTH303_TOOLS_SWEEP_DATASET_H
+#define SYNTH303_TOOLS_SWEEP_DATASET_H
+
+#include <cstdint>
+
+enum SweepAxis {
+    kAxisVco,
+    kAxisRes,
+    kAxisVmod,
+    kAxisVaccAmt,
+    kAxisDecTime,
+    kAxisNote,
+    kAxisAccent,
+    kAxisCount
+};
+
+static const char* const kSweepAxisNames[kAxisCount] = { "fVco", "fRes", "fVmod", "fVacc_amt", "decTime", "note", "accent" };
+
+struct SweepHeader {
+    char magic[8];            // "S303SWP1"
+    uint32_t version;         // 1
+    uint32_t headerSize;      // sizeof(SweepHeader)
+    uint64_t recordCount;
+    uint32_t sampleRate;
+    uint32_t frames;          // per record, waveform and cutoff alike
+    uint32_t gateFrames;      // note off after this many frames
+    uint32_t axisCount;       // kAxisCount
+    uint64_t indexOffset;
+    uint64_t dataOffset;
+    uint64_t recordStride;    // bytes from one record's waveform to the next
+    float formula[7];         // A, B, C, D, E, base, VaccMul used for every record
+    uint32_t reserved;
+};
+
+struct SweepIndexEntry {
+    float params[8];          // SweepAxis order, last one unused
+    uint64_t waveformOffset;  // frames float32 samples of audio output
+    uint64_t cutoffOffset;    // frames float32 cutoff values in Hz, after the fs/2 clamp
+    float peak;               // absolute audio peak
+    float cutoffMin;
+    float cutoffMax;
+    uint32_t nyquistClamps;   // samples where vcf_env_freq hit fs/2
+};
+
+static_assert(sizeof(SweepHeader) == 96, "SweepHeader layout");
+static_assert(sizeof(SweepIndexEntry) == 64, "SweepIndexEntry layout");
+
+#endif // SYNTH303_TOOLS_SWEEP_DATASET_H
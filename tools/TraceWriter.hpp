@@ -0,0 +1,174 @@
+// Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev) for engine renders.
+//
+// TraceWriter is the engine probe: it records a span per stage and block, MIDI instants and cutoff and
+// envelope stage counters into a preallocated buffer, and writes them out between blocks so the file I/O
+// never lands inside a span.
+
+#ifndef SYNTH303_TOOLS_TRACE_WRITER_H
+#define SYNTH303_TOOLS_TRACE_WRITER_H
+
+#include "Synth303Engine.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+struct TraceWriter : EngineProbe {
+
+    enum Kind { kSpan, kNoteOn, kSlide, kNoteOff, kIgnoredOff, kCounters };
+
+    struct Event {
+        Kind kind;
+        EngineStage stage;
+        double ts;  // microseconds since open()
+        double dur; // spans only
+        uint32_t frames;
+        uint64_t position; // first sample of the block
+        float value[3];    // notes: note/velocity, counters: cutoff, vcf stage, vca stage
+    };
+
+    std::FILE* file = nullptr;
+    bool firstEvent = true;
+    int pid = 1;
+
+    std::chrono::steady_clock::time_point origin;
+    double stageStart = 0.0;
+    uint64_t position = 0;
+    std::vector<Event> events;
+
+    ~TraceWriter() override {
+        close();
+    }
+
+    bool open(const char* path) {
+        file = std::fopen(path, "w");
+        if (file == nullptr)
+            return false;
+
+        events.reserve(4096);
+        origin = std::chrono::steady_clock::now();
+        firstEvent = true;
+        std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        return true;
+    }
+
+    bool close() {
+        if (file == nullptr)
+            return true;
+        flush();
+        std::fprintf(file, "\n]}\n");
+        const bool ok = std::fclose(file) == 0;
+        file = nullptr;
+        return ok;
+    }
+
+    double now() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    // starts a new track, one per rendered pattern
+    void beginProcess(int id, const char* name) {
+        flush();
+        pid = id;
+        position = 0;
+        separator();
+        std::fprintf(file, "{\"ph\":\"M\",\"pid\":%d,\"tid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"%s\"}},\n", pid, name);
+        std::fprintf(file, "{\"ph\":\"M\",\"pid\":%d,\"tid\":1,\"name\":\"thread_name\",\"args\":{\"name\":\"engine\"}}", pid);
+    }
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // EngineProbe
+
+    void stageBegin(EngineStage, uint32_t) override {
+        stageStart = now();
+    }
+
+    void stageEnd(EngineStage stage, uint32_t frames) override {
+        const double end = now();
+        events.push_back({ kSpan, stage, stageStart, end - stageStart, frames, position, {} });
+    }
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // called by TracedEngine
+
+    void midi(Kind kind, uint8_t note, uint8_t velocity) {
+        events.push_back({ kind, EngineStage::Count, now(), 0.0, 0, position, { (float)note, (float)velocity, 0.0f } });
+    }
+
+    void blockDone(const Synth303Engine& engine, uint32_t frames) {
+        events.push_back({ kCounters, EngineStage::Count, now(), 0.0, frames, position,
+                           { frames != 0 ? engine.freqBuffer[(frames - 1) % engine.blockCapacity] : 0.0f,
+                             (float)engine.vcf_env.stage, (float)engine.vca_env.stage } });
+        position += frames;
+        flush();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------------
+
+    void separator() {
+        if (!firstEvent)
+            std::fprintf(file, ",\n");
+        firstEvent = false;
+    }
+
+    void flush() {
+        if (file == nullptr)
+        {
+            events.clear();
+            return;
+        }
+
+        static const char* const midiNames[] = { "", "note on", "slide", "note off", "ignored off" };
+
+        for (const Event& e : events)
+        {
+            separator();
+            switch (e.kind)
+            {
+            case kSpan:
+                std::fprintf(file, "{\"ph\":\"X\",\"pid\":%d,\"tid\":1,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f,"
+                             "\"args\":{\"frames\":%u,\"sample\":%llu}}",
+                             pid, engineStageName(e.stage), e.ts, e.dur, e.frames, (unsigned long long)e.position);
+                break;
+            case kNoteOn:
+            case kSlide:
+            case kNoteOff:
+            case kIgnoredOff:
+                std::fprintf(file, "{\"ph\":\"i\",\"s\":\"p\",\"pid\":%d,\"tid\":1,\"name\":\"%s\",\"ts\":%.3f,"
+                             "\"args\":{\"note\":%d,\"velocity\":%d,\"sample\":%llu}}",
+                             pid, midiNames[e.kind], e.ts, (int)e.value[0], (int)e.value[1], (unsigned long long)e.position);
+                break;
+            case kCounters:
+                std::fprintf(file, "{\"ph\":\"C\",\"pid\":%d,\"name\":\"cutoff\",\"ts\":%.3f,\"args\":{\"Hz\":%.2f}},\n",
+                             pid, e.ts, e.value[0]);
+                std::fprintf(file, "{\"ph\":\"C\",\"pid\":%d,\"name\":\"envelope stage\",\"ts\":%.3f,"
+                             "\"args\":{\"vcf\":%d,\"vca\":%d}}",
+                             pid, e.ts, (int)e.value[1], (int)e.value[2]);
+                break;
+            }
+        }
+        events.clear();
+    }
+};
+
+// Stands in for the engine in PatternPlayer: classifies MIDI the way Synth303Engine::midiEvent will,
+// and marks block ends for the counters.
+struct TracedEngine {
+    Synth303Engine& engine;
+    TraceWriter& trace;
+
+    void midiEvent(uint8_t b0, uint8_t b1, uint8_t b2) {
+        if (b0 == 0x90)
+            trace.midi(engine.nextGateOff == -1 ? TraceWriter::kNoteOn : TraceWriter::kSlide, b1, b2);
+        else if (b0 == 0x80)
+            trace.midi(b1 == engine.nextGateOff ? TraceWriter::kNoteOff : TraceWriter::kIgnoredOff, b1, b2);
+        engine.midiEvent(b0, b1, b2);
+    }
+
+    void process(float** outputs, uint32_t frames) {
+        engine.process(outputs, frames);
+        trace.blockDone(engine, frames);
+    }
+};
+
+#endif // SYNTH303_TOOLS_TRACE_WRITER_H
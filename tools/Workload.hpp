@@ -0,0 +1,169 @@
+// 303 patterns played into an engine the way a host would deliver them.
+
+#ifndef SYNTH303_TOOLS_WORKLOAD_H
+#define SYNTH303_TOOLS_WORKLOAD_H
+
+#include "Synth303Engine.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+struct PatternStep {
+    uint8_t note;
+    bool accent;
+    bool slide; // tie into the next step
+    bool gate;  // false is a rest
+};
+
+// knob positions, in the units of the matching Synth303Engine members
+struct PatternSettings {
+    float fVco;
+    float fRes;
+    float fVmod;
+    float fVacc_amt;
+    float decTime;
+
+    template <typename Engine>
+    void apply(Engine& engine) const {
+        engine.fVco = fVco;
+        engine.fRes = fRes;
+        engine.fVmod = fVmod;
+        engine.fVacc_amt = fVacc_amt;
+        engine.decTime = decTime;
+    }
+};
+
+struct Pattern {
+    const char* name;
+    double bpm;
+    PatternSettings settings;
+    PatternStep steps[16];
+};
+
+// The canonical pattern set: what benchmarks, PGO training and golden renders play.
+// Between them they cover slides, accents, rests, the cutoff/envmod extremes and both decay ends.
+static const Pattern kPatterns[] = {
+    { "default", 130.0, { 12.0f, 1.0f, 1.0f, 1.0f, -2.223f }, {
+        { 36, true,  false, true  }, { 36, false, false, true  }, { 48, false, true,  true  }, { 39, false, false, true  },
+        { 36, false, false, false }, { 43, true,  false, true  }, { 36, false, true,  true  }, { 51, true,  false, true  },
+        { 36, false, false, true  }, { 24, false, false, true  }, { 36, true,  true,  true  }, { 38, false, false, true  },
+        { 41, false, false, false }, { 36, false, false, true  }, { 48, true,  true,  true  }, { 46, false, false, true  },
+    } },
+    { "squelch", 138.0, { 4.9f, 1.0f, 1.0f, 1.0f, -1.0f }, {
+        { 33, true,  true,  true  }, { 45, false, true,  true  }, { 33, false, false, true  }, { 45, true,  false, true  },
+        { 33, false, true,  true  }, { 36, true,  true,  true  }, { 40, false, false, true  }, { 33, false, false, true  },
+        { 45, true,  true,  true  }, { 57, false, false, true  }, { 33, false, false, false }, { 43, true,  true,  true  },
+        { 45, false, false, true  }, { 33, true,  false, true  }, { 31, false, true,  true  }, { 33, false, false, true  },
+    } },
+    { "closed", 124.0, { 2.36f, 0.5f, 0.099f, 0.0f, -2.223f }, {
+        { 24, false, false, true  }, { 24, false, false, true  }, { 36, false, false, true  }, { 24, false, false, false },
+        { 27, false, false, true  }, { 24, false, false, true  }, { 36, false, false, true  }, { 24, false, false, true  },
+        { 24, false, false, true  }, { 31, false, false, false }, { 24, false, false, true  }, { 34, false, false, true  },
+        { 24, false, false, true  }, { 24, false, false, true  }, { 36, false, false, false }, { 22, false, false, true  },
+    } },
+    { "long-decay", 110.0, { 7.0f, 0.8f, 0.5f, 0.5f, 1.32f }, {
+        { 40, true,  false, true  }, { 40, false, false, false }, { 40, false, false, false }, { 52, false, true,  true  },
+        { 40, false, false, true  }, { 40, false, false, false }, { 43, true,  false, true  }, { 40, false, false, false },
+        { 40, false, false, true  }, { 40, false, false, false }, { 47, false, true,  true  }, { 45, false, true,  true  },
+        { 40, true,  false, true  }, { 40, false, false, false }, { 52, false, false, true  }, { 40, false, false, false },
+    } },
+    { "accents", 145.0, { 8.0f, 0.9f, 0.283f, 1.0f, -2.223f }, {
+        { 36, true,  false, true  }, { 48, true,  false, true  }, { 36, true,  false, true  }, { 60, true,  false, true  },
+        { 36, true,  true,  true  }, { 48, true,  true,  true  }, { 72, true,  false, true  }, { 36, true,  false, true  },
+        { 12, true,  false, true  }, { 36, true,  false, true  }, { 48, true,  true,  true  }, { 51, true,  false, true  },
+        { 36, true,  false, true  }, { 39, true,  false, true  }, { 48, true,  false, true  }, { 36, true,  false, true  },
+    } },
+};
+
+static constexpr int kPatternCount = sizeof(kPatterns) / sizeof(kPatterns[0]);
+
+static const Pattern& kDefaultPattern = kPatterns[0];
+
+static inline const Pattern* findPattern(const char* name) {
+    for (const Pattern& pattern : kPatterns)
+        if (std::strcmp(pattern.name, name) == 0)
+            return &pattern;
+    return nullptr;
+}
+
+// Cuts the host blocks at step and gate boundaries so every event lands on its exact sample.
+// A 303 gate lasts half a step; a slide step keeps the gate open and the next note slides in.
+struct PatternPlayer {
+    const Pattern* pattern = &kDefaultPattern;
+    double sampleRate = 48000.0;
+
+    uint64_t frame = 0;
+    uint64_t nextEventFrame = 0;
+    uint64_t eventCount = 0;
+    int step = 0;
+    bool halfStep = false;
+    int heldNote = -1;
+
+    void reset(const Pattern* p, double sr) {
+        pattern = p;
+        sampleRate = sr;
+        frame = nextEventFrame = eventCount = 0;
+        step = 0;
+        halfStep = false;
+        heldNote = -1;
+    }
+
+    double framesPerStep() const {
+        return sampleRate * 60.0 / pattern->bpm / 4.0;
+    }
+
+    template <typename Engine>
+    void event(Engine& engine) {
+        const PatternStep& s = pattern->steps[step];
+
+        if (!halfStep)
+        {
+            if (s.gate)
+            {
+                // with a note still held the engine treats this as a slide
+                engine.midiEvent(0x90, s.note, s.accent ? 127 : 80);
+                if (heldNote >= 0 && heldNote != s.note)
+                    engine.midiEvent(0x80, heldNote, 0);
+                heldNote = s.note;
+            }
+            else if (heldNote >= 0)
+            {
+                engine.midiEvent(0x80, heldNote, 0);
+                heldNote = -1;
+            }
+        }
+        else
+        {
+            if (heldNote >= 0 && !s.slide)
+            {
+                engine.midiEvent(0x80, heldNote, 0);
+                heldNote = -1;
+            }
+            step = (step + 1) % 16;
+        }
+
+        halfStep = !halfStep;
+        ++eventCount;
+        nextEventFrame = (uint64_t)(eventCount * framesPerStep() / 2.0 + 0.5);
+    }
+
+    // renders `frames` samples of 4 outputs, sending the pattern's MIDI at sample accurate positions
+    template <typename Engine>
+    void render(Engine& engine, float* const* outputs, uint32_t frames) {
+        uint32_t done = 0;
+        while (done < frames)
+        {
+            if (frame == nextEventFrame)
+                event(engine);
+
+            const uint32_t n = (uint32_t)std::min<uint64_t>(frames - done, nextEventFrame - frame);
+            float* blockOutputs[4] = { outputs[0] + done, outputs[1] + done, outputs[2] + done, outputs[3] + done };
+            engine.process(blockOutputs, n);
+            done += n;
+            frame += n;
+        }
+    }
+};
+
+#endif // SYNTH303_TOOLS_WORKLOAD_H
@@ -0,0 +1,474 @@
+// Aliasing and spectral quality of Osc303 and AcidFilter per oversampling factor, to decide how far the
+// 4x of the engine can be cut.
+//
+// usage: synth303-alias [--rates 44100,48000,...] [--factors 1,2,4,8] [--steps n] [--budget dB]
+//
+// The engine's factor is a compile-time constant, so the analyzer runs the components themselves: Osc303
+// and AcidFilter prepared at factor * rate (both are written for 4x, preparing them for rate * factor / 4
+// moves their internal rate) and a cascade of the engine's half-band stages back down to the rate.
+// Per sample rate and factor:
+//
+//   oscillator  sustained notes over the 303 range (note_cv 0-5 V), saw (what the ladder gets) and square
+//   filter      a stepped cutoff sweep at full resonance, driven by a band-limited saw so everything
+//               inharmonic at the output comes from the ladder's tanh and the decimator, worst step
+//   decimator   passband ripple up to 20 kHz (or 0.45 rate) and the worst rejection of what folds back
+//
+// alias is the inharmonic share of the energy (everything more than a few bins away from a harmonic of the
+// note, above 20 Hz), floor the median inharmonic bin relative to the total, both in dB. The cheapest
+// factor whose worst alias stays below --budget is listed after every table.
+
+#include "Workload.hpp"
+#include "Spectrum.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+static constexpr float kNoteCVs[] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f };
+static constexpr int kNoteCount = sizeof(kNoteCVs) / sizeof(kNoteCVs[0]);
+static constexpr int kMaxFactors = 8;
+
+// --------------------------------------------------------------------------------------------------------------------
+// decimation
+
+// factor -> 1 with the engine's half-band stages (AcidFilter::decimate for a factor of 4), in place
+struct Decimator {
+    static constexpr int kChunk = 256; // input samples per half-band call
+    static constexpr int kMaxStages = 4;
+
+    std::unique_ptr<sst::filters::HalfRate::HalfRateFilter> stages[kMaxStages];
+    int stageCount = 0;
+    std::vector<float> unused; // the R lane
+
+    explicit Decimator(int factor) {
+        for (int f = factor; f > 1 && stageCount < kMaxStages; f /= 2)
+            stages[stageCount++].reset(new sst::filters::HalfRate::HalfRateFilter(1, true));
+    }
+
+    // n input samples in x, returns the number of output samples at the start of x
+    int process(float* x, int n) {
+        unused.assign(n, 0.0f);
+        for (int s = 0; s < stageCount; ++s, n /= 2)
+        {
+            for (int start = 0; start < n; start += kChunk)
+            {
+                const int m = std::min(kChunk, n - start);
+                stages[s]->process_block_D2(x + start, unused.data() + start, m);
+                std::memmove(x + start / 2, x + start, sizeof(float) * (m / 2));
+            }
+        }
+        return n;
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// analysis
+
+struct SpectralQuality {
+    double aliasDb = -INFINITY;
+    double floorDb = -INFINITY;
+};
+
+// x from `begin` on, with the harmonics of f0 as the wanted signal
+static SpectralQuality analyze(const std::vector<float>& x, std::size_t begin, double sampleRate, double f0,
+                               std::size_t fftSize)
+{
+    constexpr double kHarmonicBins = 3.5; // Hann main lobe plus a margin
+    constexpr double kLowestHz = 20.0;    // DC blockers and their settling
+
+    Spectrum spectrum(fftSize);
+    std::vector<double> power(spectrum.bins());
+    std::vector<double> inharmonicBins;
+    const double binHz = spectrum.binHz(sampleRate);
+
+    double harmonic = 0.0, inharmonic = 0.0;
+    std::size_t frames = 0;
+    for (std::size_t start = begin; start + fftSize <= x.size(); start += fftSize / 2, ++frames)
+    {
+        spectrum.power(&x[start], power.data());
+        for (std::size_t k = 0; k < power.size(); ++k)
+        {
+            const double hz = k * binHz;
+            if (hz < kLowestHz)
+                continue;
+            if (std::fabs(hz - std::round(hz / f0) * f0) <= kHarmonicBins * binHz)
+            {
+                harmonic += power[k];
+            }
+            else
+            {
+                inharmonic += power[k];
+                inharmonicBins.push_back(power[k]);
+            }
+        }
+    }
+
+    SpectralQuality quality;
+    const double total = harmonic + inharmonic;
+    if (frames == 0 || !(total > 0.0))
+        return quality;
+
+    quality.aliasDb = 10.0 * std::log10(std::max(inharmonic / total, 1e-30));
+    if (!inharmonicBins.empty())
+    {
+        auto median = inharmonicBins.begin() + inharmonicBins.size() / 2;
+        std::nth_element(inharmonicBins.begin(), median, inharmonicBins.end());
+        quality.floorDb = 10.0 * std::log10(std::max(*median * frames / total, 1e-30));
+    }
+    return quality;
+}
+
+static double nsPerSample(std::chrono::steady_clock::duration elapsed, double samples)
+{
+    return std::chrono::duration<double, std::nano>(elapsed).count() / samples;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// oscillator
+
+struct OscResult {
+    SpectralQuality saw[kNoteCount];
+    SpectralQuality square[kNoteCount];
+    double ns = 0.0;
+};
+
+static OscResult measureOsc(double sampleRate, int factor)
+{
+    constexpr std::size_t kFft = 65536; // sub-Hz bins, the lowest note has harmonics 16 Hz apart
+    const std::size_t settle = (std::size_t)(0.1 * sampleRate);
+    const std::size_t frames = settle + 3 * kFft / 2;
+    constexpr std::size_t kBlock = 2048;
+
+    OscResult result;
+    std::chrono::steady_clock::duration elapsed {};
+
+    for (int n = 0; n < kNoteCount; ++n)
+    {
+        Osc303 osc;
+        osc.prepare((float)(sampleRate * factor / Osc303::oversampling), kBlock);
+        osc.setPitchCV(kNoteCVs[n]);
+
+        std::vector<float> saw(frames * factor), square(frames * factor);
+        Decimator sawDecimator(factor), squareDecimator(factor);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t done = 0; done < saw.size(); done += kBlock)
+        {
+            const std::size_t count = std::min(kBlock, saw.size() - done);
+            osc.process(&square[done], &saw[done], (uint32_t)count);
+        }
+        saw.resize(sawDecimator.process(saw.data(), (int)saw.size()));
+        elapsed += std::chrono::steady_clock::now() - start;
+        square.resize(squareDecimator.process(square.data(), (int)square.size()));
+
+        const double f0 = osc303PitchTable.lookup(kNoteCVs[n]);
+        result.saw[n] = analyze(saw, settle, sampleRate, f0, kFft);
+        result.square[n] = analyze(square, settle, sampleRate, f0, kFft);
+    }
+
+    result.ns = nsPerSample(elapsed, (double)frames * kNoteCount);
+    return result;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// filter
+
+// one period of a saw with the harmonics below `harmonics` + 1, read with linear interpolation. Big enough
+// that the interpolation error stays below -100 dB.
+struct BandLimitedSaw {
+    static constexpr uint32_t kSize = 1u << 18;
+    std::vector<float> table;
+
+    explicit BandLimitedSaw(int harmonics) : table(kSize + 1) {
+        std::vector<double> sine(kSize), sum(kSize, 0.0);
+        for (uint32_t i = 0; i < kSize; ++i)
+            sine[i] = std::sin(2.0 * M_PI * i / kSize);
+        for (int k = 1; k <= harmonics; ++k)
+            for (uint32_t i = 0; i < kSize; ++i)
+                sum[i] += sine[(uint32_t)((uint64_t)k * i & (kSize - 1))] / k;
+        for (uint32_t i = 0; i < kSize; ++i)
+            table[i] = (float)(sum[i] * 2.0 / M_PI);
+        table[kSize] = table[0];
+    }
+
+    // phase in [0, 1)
+    float read(double phase) const {
+        const double x = phase * kSize;
+        const uint32_t i = (uint32_t)x;
+        const float a = (float)(x - i);
+        return table[i] + a * (table[i + 1] - table[i]);
+    }
+};
+
+struct FilterResult {
+    SpectralQuality sweep; // worst step
+    double ns = 0.0;
+};
+
+// a note near 110 Hz whose aliases land a quarter of the spacing away from its harmonics
+static double sweepNoteHz(double sampleRate)
+{
+    return sampleRate / (std::floor(sampleRate / 110.0) + 0.25);
+}
+
+static double sweepHighHz(double sampleRate)
+{
+    return std::min(12000.0, 0.4 * sampleRate);
+}
+
+// the cutoff steps up through the range and is held long enough per step for the resonance to settle,
+// only the settled part is analyzed: a moving resonance smears the harmonics over more bins than it aliases
+static FilterResult measureFilter(double sampleRate, int factor, int steps, const BandLimitedSaw& saw)
+{
+    constexpr double kLowHz = 200.0;
+    constexpr int kCoeffStride = AcidFilter::oversampling; // processOversampled() takes 4 samples a call
+    const double f0 = sweepNoteHz(sampleRate), highHz = sweepHighHz(sampleRate);
+    const std::size_t fftSize = sampleRate > 60000.0 ? 16384 : 8192;
+    const std::size_t settle = (std::size_t)(0.25 * sampleRate) & ~(std::size_t)3;
+    const std::size_t stepFrames = settle + 2 * fftSize;
+    const std::size_t internal = stepFrames * factor;
+
+    AcidFilter filter;
+    filter.prepare((float)(sampleRate * factor / AcidFilter::oversampling));
+    Decimator decimator(factor);
+
+    std::vector<float> in(internal), out(internal);
+    double phase = 0.0;
+    const double increment = f0 / (sampleRate * factor);
+
+    FilterResult result;
+    std::chrono::steady_clock::duration elapsed {};
+
+    for (int step = 0; step < steps; ++step)
+    {
+        for (float& x : in)
+        {
+            x = saw.read(phase);
+            phase += increment;
+            phase -= std::floor(phase);
+        }
+
+        const float cutoff = (float)(kLowHz * std::pow(highHz / kLowHz, steps > 1 ? (double)step / (steps - 1) : 0.0));
+        out.resize(internal);
+
+        const auto start = std::chrono::steady_clock::now();
+        filter.calcCoeffs(cutoff, 1.0f);
+        for (std::size_t i = 0; i < internal; i += kCoeffStride)
+            filter.processOversampled(&in[i], &out[i]);
+        out.resize(decimator.process(out.data(), (int)out.size()));
+        elapsed += std::chrono::steady_clock::now() - start;
+
+        const SpectralQuality quality = analyze(out, settle, sampleRate, f0, fftSize);
+        result.sweep.aliasDb = std::max(result.sweep.aliasDb, quality.aliasDb);
+        result.sweep.floorDb = std::max(result.sweep.floorDb, quality.floorDb);
+    }
+
+    result.ns = nsPerSample(elapsed, (double)stepFrames * steps);
+    return result;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// decimator
+
+struct DecimatorResult {
+    double rippleDb = 0.0;
+    double rejectionDb = -INFINITY; // worst, output power relative to a full-scale sine above the passband
+};
+
+// gain of `decimator` for a sine at `hz`, least squares fit after the filters settled
+static double sineGain(int factor, double sampleRate, double hz)
+{
+    constexpr int kFrames = 8192, kSettle = 2048;
+    std::vector<float> x(kFrames * factor);
+    for (std::size_t i = 0; i < x.size(); ++i)
+        x[i] = (float)std::sin(2.0 * M_PI * hz * i / (sampleRate * factor));
+
+    Decimator decimator(factor);
+    x.resize(decimator.process(x.data(), (int)x.size()));
+
+    double power = 0.0;
+    for (int i = kSettle; i < kFrames; ++i)
+        power += (double)x[i] * x[i];
+    return std::sqrt(2.0 * power / (kFrames - kSettle));
+}
+
+static DecimatorResult measureDecimator(double sampleRate, int factor)
+{
+    DecimatorResult result;
+    if (factor == 1)
+        return result;
+
+    constexpr int kPoints = 48;
+    const double passband = std::min(20000.0, 0.45 * sampleRate);
+    double minDb = INFINITY, maxDb = -INFINITY;
+    for (int p = 0; p < kPoints; ++p)
+    {
+        const double hz = 20.0 * std::pow(passband / 20.0, (double)p / (kPoints - 1));
+        const double db = 20.0 * std::log10(std::max(sineGain(factor, sampleRate, hz), 1e-10));
+        minDb = std::min(minDb, db);
+        maxDb = std::max(maxDb, db);
+    }
+    result.rippleDb = maxDb - minDb;
+
+    // everything from where the image of the passband starts up to the internal Nyquist folds down
+    const double stopLow = sampleRate - passband, stopHigh = 0.5 * sampleRate * factor * 0.999;
+    for (int p = 0; p < kPoints; ++p)
+    {
+        const double hz = stopLow + (stopHigh - stopLow) * p / (kPoints - 1);
+        const double db = 20.0 * std::log10(std::max(sineGain(factor, sampleRate, hz), 1e-10));
+        result.rejectionDb = std::max(result.rejectionDb, db);
+    }
+    return result;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static std::vector<double> parseList(const char* text)
+{
+    std::vector<double> values;
+    for (const char* p = text; *p != '\0';)
+    {
+        char* end;
+        const double value = std::strtod(p, &end);
+        if (end == p)
+            return {};
+        values.push_back(value);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: synth303-alias [--rates 44100,48000,...] [--factors 1,2,4,8] [--steps n] [--budget dB]\n");
+}
+
+static void printDb(double db)
+{
+    if (std::isinf(db))
+        std::printf(" %7s", "-inf");
+    else
+        std::printf(" %7.1f", db);
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<double> rates = { 44100.0, 48000.0, 96000.0 };
+    std::vector<double> factorList = { 1.0, 2.0, 4.0, 8.0 };
+    int steps = 12;
+    double budgetDb = -60.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--rates") == 0 && hasValue)
+            rates = parseList(argv[++i]);
+        else if (std::strcmp(argv[i], "--factors") == 0 && hasValue)
+            factorList = parseList(argv[++i]);
+        else if (std::strcmp(argv[i], "--steps") == 0 && hasValue)
+            steps = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--budget") == 0 && hasValue)
+            budgetDb = std::atof(argv[++i]);
+        else
+            return usage(), 1;
+    }
+
+    std::vector<int> factors;
+    for (double f : factorList)
+    {
+        const int factor = (int)f;
+        if (factor < 1 || factor > kMaxFactors || (factor & (factor - 1)) != 0)
+            return std::fprintf(stderr, "factors are powers of two up to %d\n", kMaxFactors), 1;
+        factors.push_back(factor);
+    }
+    // smallest first, the cheapest factor is the first one within budget
+    std::sort(factors.begin(), factors.end());
+    factors.erase(std::unique(factors.begin(), factors.end()), factors.end());
+    if (rates.empty() || factors.empty() || steps < 1)
+        return usage(), 1;
+
+    std::printf("synth303maker aliasing per oversampling factor, budget %.0f dB, the engine runs %dx\n",
+                budgetDb, Synth303Engine::kOversampling);
+
+    for (double sampleRate : rates)
+    {
+        const BandLimitedSaw saw((int)(0.5 * sampleRate / sweepNoteHz(sampleRate)));
+
+        std::printf("\n== %.0f Hz ==\n\n", sampleRate);
+        std::printf("oscillator, alias dB per note_cv\n");
+        std::printf("%-6s %-6s |", "factor", "wave");
+        for (float cv : kNoteCVs)
+            std::printf(" %6.0fV", cv);
+        std::printf(" | %7s %7s | %9s\n", "worst", "floor", "ns/sample");
+
+        int cheapestOsc = 0, cheapestFilter = 0;
+        std::vector<FilterResult> filterResults;
+        std::vector<DecimatorResult> decimatorResults;
+
+        for (int factor : factors)
+        {
+            std::fprintf(stderr, "\r%.0f Hz %dx", sampleRate, factor);
+            const OscResult osc = measureOsc(sampleRate, factor);
+            filterResults.push_back(measureFilter(sampleRate, factor, steps, saw));
+            decimatorResults.push_back(measureDecimator(sampleRate, factor));
+            std::fprintf(stderr, "\r%-20s\r", "");
+
+            double worstOsc = -INFINITY;
+            for (int wave = 0; wave < 2; ++wave)
+            {
+                const SpectralQuality* const quality = wave == 0 ? osc.saw : osc.square;
+                double worst = -INFINITY, floor = -INFINITY;
+                std::printf("%-6d %-6s |", factor, wave == 0 ? "saw" : "square");
+                for (int n = 0; n < kNoteCount; ++n)
+                {
+                    printDb(quality[n].aliasDb);
+                    worst = std::max(worst, quality[n].aliasDb);
+                    floor = std::max(floor, quality[n].floorDb);
+                }
+                std::printf(" |");
+                printDb(worst);
+                printDb(floor);
+                if (wave == 0)
+                    std::printf(" | %9.2f\n", osc.ns);
+                else
+                    std::printf(" |\n");
+                worstOsc = std::max(worstOsc, worst);
+            }
+            if (cheapestOsc == 0 && worstOsc <= budgetDb)
+                cheapestOsc = factor;
+        }
+
+        std::printf("\nfilter, %d steps %.0f-%.0f Hz at full resonance, note %.2f Hz, and decimator\n", steps, 200.0,
+                    sweepHighHz(sampleRate), sweepNoteHz(sampleRate));
+        std::printf("%-6s | %7s %7s | %9s | %9s %9s\n", "factor", "alias", "floor", "ns/sample", "ripple dB",
+                    "reject dB");
+        for (std::size_t f = 0; f < factors.size(); ++f)
+        {
+            std::printf("%-6d |", factors[f]);
+            printDb(filterResults[f].sweep.aliasDb);
+            printDb(filterResults[f].sweep.floorDb);
+            std::printf(" | %9.2f | %9.3f", filterResults[f].ns, decimatorResults[f].rippleDb);
+            printDb(decimatorResults[f].rejectionDb);
+            std::printf("\n");
+            if (cheapestFilter == 0 && filterResults[f].sweep.aliasDb <= budgetDb)
+                cheapestFilter = factors[f];
+        }
+
+        std::printf("\ncheapest within %.0f dB:", budgetDb);
+        if (cheapestOsc != 0)
+            std::printf(" oscillator %dx,", cheapestOsc);
+        else
+            std::printf(" oscillator none,");
+        if (cheapestFilter != 0)
+            std::printf(" filter %dx\n", cheapestFilter);
+        else
+            std::printf(" filter none\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+// Per instruction set cost of the hot DSP kernels and of the whole engine, playing the oscillator and
+// filtering a stereo input.
+//
+// usage: synth303-bench-isa [seconds] [block size] [sample rate]
+
+#include "Workload.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// what PatternPlayer plays into for the stereo input mode, handing the engine the inputs of each sub-block
+struct StereoInputEngine {
+    Synth303Engine& engine;
+    const float* const* inputs;
+    uint32_t offset = 0;
+
+    void midiEvent(uint8_t b0, uint8_t b1, uint8_t b2) {
+        engine.midiEvent(b0, b1, b2);
+    }
+
+    void process(float** outputs, uint32_t frames) {
+        const float* blockInputs[2] = { inputs[0] + offset, inputs[1] + offset };
+        engine.process(outputs, frames, blockInputs);
+        offset += frames;
+    }
+};
+
+static double nsPerSample(std::chrono::steady_clock::duration elapsed, double samples)
+{
+    return std::chrono::duration<double, std::nano>(elapsed).count() / samples;
+}
+
+int main(int argc, char* argv[])
+{
+    const double seconds = argc > 1 ? std::atof(argv[1]) : 10.0;
+    const uint32_t blockSize = argc > 2 ? std::atoi(argv[2]) : 256;
+    const double sampleRate = argc > 3 ? std::atof(argv[3]) : 48000.0;
+    const uint32_t totalFrames = (uint32_t)(seconds * sampleRate);
+
+    std::vector<float> out[4];
+    for (std::vector<float>& o : out)
+        o.resize(blockSize);
+    float* outputs[4] = { out[0].data(), out[1].data(), out[2].data(), out[3].data() };
+
+    // kernel inputs: a pitch ramp over the 303 range and a cutoff sweep
+    std::vector<float> pitch(blockSize), freq(blockSize), square(blockSize * 4), saw(blockSize * 4);
+    std::vector<float> osL(blockSize * 4), osR(blockSize * 4), decimated(blockSize), decimatedR(blockSize);
+
+    // stereo input: two detuned saws
+    std::vector<float> in[2];
+    for (int c = 0; c < 2; ++c)
+    {
+        in[c].resize(blockSize);
+        for (uint32_t i = 0; i < blockSize; ++i)
+            in[c][i] = 2.0f * std::fmod(i * (110.0f + c) / (float)sampleRate, 1.0f) - 1.0f;
+    }
+    const float* inputs[2] = { in[0].data(), in[1].data() };
+    for (uint32_t i = 0; i < blockSize; ++i)
+    {
+        pitch[i] = 5.0f * i / blockSize;
+        freq[i] = 100.0f + 8000.0f * i / blockSize;
+    }
+
+    std::printf("synth303maker kernels, %.1fs @ %.0fHz, %u sample blocks, ns per sample\n\n", seconds, sampleRate, blockSize);
+    std::printf("%-8s | %10s %8s | %10s | %10s | %10s | %10s | %10s\n",
+                "isa", "engine", "speedup", "stereo in", "osc", "ladder", "ladder L+R", "decimate");
+
+    double baseline = 0.0;
+
+    for (int i = 0; i < (int)CpuIsa::Count; ++i)
+    {
+        const CpuIsa isa = (CpuIsa)i;
+        if (!isCpuIsaSupported(isa))
+        {
+            std::printf("%-8s | not supported by this CPU\n", cpuIsaName(isa));
+            continue;
+        }
+
+        const DspKernels& kernels = getDspKernels(isa);
+        if (kernels.isa != isa)
+        {
+            std::printf("%-8s | not built for this target\n", cpuIsaName(isa));
+            continue;
+        }
+
+        // whole engine playing the default pattern
+        Synth303Engine engine;
+        engine.logEvents = false;
+        engine.isaOverride = isa;
+        engine.sampleRateChanged(sampleRate);
+        engine.activate(sampleRate, blockSize);
+
+        PatternPlayer player;
+        player.reset(&kDefaultPattern, sampleRate);
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t done = 0; done < totalFrames; done += blockSize)
+            player.render(engine, outputs, blockSize);
+        const double engineNs = nsPerSample(std::chrono::steady_clock::now() - start, totalFrames);
+
+        // the same pattern gating the stereo input filter
+        engine.stereoInput = true;
+        StereoInputEngine stereoEngine { engine, inputs };
+        player.reset(&kDefaultPattern, sampleRate);
+        start = std::chrono::steady_clock::now();
+        for (uint32_t done = 0; done < totalFrames; done += blockSize)
+        {
+            stereoEngine.offset = 0;
+            player.render(stereoEngine, outputs, blockSize);
+        }
+        const double stereoNs = nsPerSample(std::chrono::steady_clock::now() - start, totalFrames);
+
+        // kernels on their own
+        Osc303 osc;
+        osc.prepare(sampleRate, blockSize);
+        AcidFilter filter;
+        filter.prepare(sampleRate, 300.0, 0.66);
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t done = 0; done < totalFrames; done += blockSize)
+            kernels.osc(osc, pitch.data(), square.data(), saw.data(), blockSize);
+        const double oscNs = nsPerSample(std::chrono::steady_clock::now() - start, totalFrames);
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t done = 0; done < totalFrames; done += blockSize)
+            kernels.ladder(filter, freq.data(), 1.0f, saw.data(), osL.data(), blockSize);
+        const double ladderNs = nsPerSample(std::chrono::steady_clock::now() - start, totalFrames);
+
+        AcidFilterStereo stereoFilter;
+        stereoFilter.prepare(sampleRate);
+        start = std::chrono::steady_clock::now();
+        for (uint32_t done = 0; done < totalFrames; done += blockSize)
+            kernels.ladderStereo(stereoFilter, freq.data(), 1.0f, saw.data(), square.data(), osL.data(), osR.data(),
+                                 blockSize);
+        const double ladderStereoNs = nsPerSample(std::chrono::steady_clock::now() - start, totalFrames);
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t done = 0; done < totalFrames; done += blockSize)
+        {
+            std::copy(saw.begin(), saw.end(), osL.begin());
+            kernels.decimate(filter, osL.data(), osR.data(), decimated.data(), blockSize);
+        }
+        const double decimateNs = nsPerSample(std::chrono::steady_clock::now() - start, totalFrames);
+
+        if (baseline == 0.0)
+            baseline = engineNs;
+
+        std::printf("%-8s | %10.2f %7.2fx | %10.2f | %10.2f | %10.2f | %10.2f | %10.2f\n", kernels.name,
+                    engineNs, baseline / engineNs, stereoNs, oscNs, ladderNs, ladderStereoNs, decimateNs);
+    }
+
+    std::printf("\nselected at activate(): %s (override with SYNTH303_ISA=sse2|avx2|avx512)\n",
+                getDspKernels().name);
+    return 0;
+}
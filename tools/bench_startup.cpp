@@ -0,0 +1,188 @@
+// Instantiation and activation cost of many engine instances, as seen by a host loading a session.
+//
+// usage: synth303-bench-startup [sample rate] [max instances] [buffer size]
+//
+// PluginDSP is a thin wrapper around Synth303Engine, so creating an engine stands in for createPlugin().
+// PluginUI needs a GL context from DPF and cannot be built headless; the DSP state it sets up in its
+// constructor (cutoff envelope and WowFilter) is reported as its own component instead.
+
+#include "Synth303Engine.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// --------------------------------------------------------------------------------------------------------------------
+// allocation counting
+
+static std::atomic<uint64_t> gAllocCount { 0 };
+static std::atomic<uint64_t> gAllocBytes { 0 };
+
+static void* countedAlloc(std::size_t size, std::size_t align)
+{
+    gAllocCount++;
+    gAllocBytes += size;
+    void* ptr = align > alignof(std::max_align_t)
+              ? std::aligned_alloc(align, (size + align - 1) / align * align)
+              : std::malloc(size != 0 ? size : 1);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(std::size_t size) { return countedAlloc(size, 0); }
+void* operator new[](std::size_t size) { return countedAlloc(size, 0); }
+void* operator new(std::size_t size, std::align_val_t align) { return countedAlloc(size, (std::size_t)align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return countedAlloc(size, (std::size_t)align); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+// --------------------------------------------------------------------------------------------------------------------
+
+struct Measure {
+    double us = 0.0;
+    uint64_t allocs = 0;
+    uint64_t bytes = 0;
+};
+
+template <typename F>
+static Measure measure(F&& f)
+{
+    const uint64_t allocs = gAllocCount;
+    const uint64_t bytes = gAllocBytes;
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+
+    Measure m;
+    m.us = std::chrono::duration<double, std::micro>(end - start).count();
+    m.allocs = gAllocCount - allocs;
+    m.bytes = gAllocBytes - bytes;
+    return m;
+}
+
+// Constructs `count` objects in preallocated storage so only the objects' own work is measured,
+// then runs `init` on each of them.
+template <typename T, typename Init>
+static void component(const char* name, int count, Init&& init)
+{
+    constexpr std::size_t align = alignof(T) > 64 ? alignof(T) : 64;
+    void* const storage = std::aligned_alloc(align, (sizeof(T) * count + align - 1) / align * align);
+    T* const items = static_cast<T*>(storage);
+
+    const Measure ctor = measure([&] {
+        for (int i = 0; i < count; ++i)
+            new (items + i) T();
+    });
+    const Measure prep = measure([&] {
+        for (int i = 0; i < count; ++i)
+            init(items[i]);
+    });
+
+    std::printf("  %-34s %10.3f us %6.1f allocs | %10.3f us %6.1f allocs %9.0f bytes\n", name,
+                ctor.us / count, (double)ctor.allocs / count,
+                prep.us / count, (double)prep.allocs / count, (double)prep.bytes / count);
+
+    for (int i = 0; i < count; ++i)
+        items[i].~T();
+    std::free(storage);
+}
+
+struct Nothing {};
+
+static volatile float gSink;
+
+int main(int argc, char* argv[])
+{
+    const double sampleRate = argc > 1 ? std::atof(argv[1]) : 48000.0;
+    const int maxInstances = argc > 2 ? std::atoi(argv[2]) : 256;
+    const uint32_t bufferSize = argc > 3 ? std::atoi(argv[3]) : 512;
+
+    std::printf("synth303maker startup @ %.0fHz\n\n", sampleRate);
+    std::printf("%9s | %-28s | %-28s | %-28s | %s\n", "instances",
+                "createPlugin() us/inst alloc", "sampleRateChanged() us/inst", "activate() us/inst alloc", "total ms");
+
+    for (int n = 1; n <= maxInstances; n *= 2)
+    {
+        std::vector<Synth303Engine*> engines(n, nullptr);
+
+        const Measure create = measure([&] {
+            for (int i = 0; i < n; ++i)
+                engines[i] = new Synth303Engine();
+        });
+        const Measure rate = measure([&] {
+            for (int i = 0; i < n; ++i)
+                engines[i]->sampleRateChanged(sampleRate);
+        });
+        const Measure activate = measure([&] {
+            for (int i = 0; i < n; ++i)
+                engines[i]->activate(sampleRate, bufferSize);
+        });
+
+        std::printf("%9d | %12.3f %6.1f %8s | %12.3f %15s | %12.3f %6.1f %8s | %8.3f\n", n,
+                    create.us / n, (double)create.allocs / n, "",
+                    rate.us / n, "",
+                    activate.us / n, (double)activate.allocs / n, "",
+                    (create.us + rate.us + activate.us) / 1000.0);
+
+        for (Synth303Engine* engine : engines)
+            delete engine;
+    }
+
+    const int count = maxInstances;
+    std::printf("\nper component, mean of %d | construction | prepare/activate\n", count);
+
+    component<Synth303Engine>("Synth303Engine", count, [&](Synth303Engine& e) { e.activate(sampleRate, bufferSize); });
+    component<Osc303>("Osc303::prepare", count, [&](Osc303& o) { o.prepare(sampleRate, bufferSize); });
+    component<AcidFilter>("AcidFilter::prepare", count, [&](AcidFilter& f) { f.prepare(sampleRate, 300.0, 0.66); });
+
+    // the first envelope at a rate builds the shared table, later ones only take a reference
+    component<Nothing>("envelope table build (cold)", count, [&](Nothing&) {
+        EnvRateTable table(sampleRate);
+        gSink = table.data[gAllocCount % EnvRateTable::size];
+    });
+    {
+        const std::shared_ptr<const EnvRateTable> keep = EnvRateTable::acquire(sampleRate);
+        component<sst::surgext_rack::dsp::envelopes::ADAREnvelope>("ADAREnvelope::activate (shared)", count,
+            [&](sst::surgext_rack::dsp::envelopes::ADAREnvelope& e) { e.activate(sampleRate); });
+    }
+
+    component<WowFilter>("WowFilter (WDF) prepare", count, [&](WowFilter& w) { w.prepare(sampleRate); });
+    component<SlideFilter>("SlideFilter (WDF) prepare", count, [&](SlideFilter& s) { s.prepare(sampleRate); });
+
+    component<chowdsp::SawtoothWave<float>>("chowdsp::SawtoothWave prepare", count, [&](chowdsp::SawtoothWave<float>& s) {
+        juce::dsp::ProcessSpec spec;
+        spec.sampleRate = sampleRate * 4.0;
+        spec.maximumBlockSize = bufferSize * 4;
+        spec.numChannels = 1;
+        s.prepare(spec);
+    });
+    component<chowdsp::FirstOrderHPF<float>>("chowdsp::FirstOrderHPF calcCoefs", count,
+        [&](chowdsp::FirstOrderHPF<float>& f) { f.calcCoefs(50.0f, sampleRate * 4.0); });
+
+    struct HalfRate : sst::filters::HalfRate::HalfRateFilter {
+        HalfRate() : HalfRateFilter(1, true) {}
+    };
+    component<HalfRate>("sst HalfRateFilter", count, [](HalfRate&) {});
+
+    struct UISide {
+        sst::surgext_rack::dsp::envelopes::ADAREnvelope vcf_env;
+        WowFilter wowFilter;
+    };
+    component<UISide>("PluginUI DSP state", count, [&](UISide& ui) {
+        ui.vcf_env.activate(sampleRate);
+        ui.wowFilter.prepare(sampleRate);
+    });
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * Thin driver of the C interface in src/synth303.h: plays a one-bar pattern through the library and writes
+ * the audio as raw 32-bit float mono, e.g. for `aplay -f FLOAT_LE -r 48000 out.raw` or an import in Audacity.
+ *
+ * usage: synth303-embed-example [out.raw]
+ */
+
+#include "synth303.h"
+
+#include <math.h>
+#include <stdio.h>
+
+enum { kRate = 48000, kBlock = 256, kBars = 4 };
+
+int main(int argc, char* argv[])
+{
+    /* note, accent and slide into the next step; zero rests */
+    static const uint8_t notes[16] = { 36, 36, 48, 39, 0, 43, 36, 51, 36, 24, 36, 38, 0, 36, 48, 46 };
+    static const uint8_t accents[16] = { 1, 0, 0, 0, 0, 1, 0, 1, 0, 0, 1, 0, 0, 0, 1, 0 };
+    static const uint8_t slides[16] = { 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+
+    const char* const path = argc > 1 ? argv[1] : "synth303-embed-example.raw";
+    FILE* const file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+
+    synth303* const synth = synth303_create();
+    if (synth == NULL || synth303_prepare(synth, kRate, kBlock) != 0)
+    {
+        fprintf(stderr, "cannot create the engine\n");
+        return 1;
+    }
+    synth303_set_parameter(synth, kParamCutoff, 4.9f);
+    synth303_set_parameter(synth, kParamDecay, -1.0f);
+
+    /* only outputs[0] is needed, the CV outputs stay unconnected */
+    float audio[kBlock];
+    float* outputs[SYNTH303_OUTPUT_COUNT] = { audio, NULL, NULL, NULL };
+
+    const uint32_t stepFrames = kRate * 60 / 130 / 4; /* sixteenths at 130 BPM */
+    const uint32_t gateFrames = stepFrames / 2;
+    const uint64_t total = ((uint64_t)kBars * 16 * stepFrames + kBlock - 1) / kBlock * kBlock;
+    float peak = 0.0f;
+
+    int held = -1;
+    for (uint64_t start = 0; start < total; start += kBlock)
+    {
+        /* every note on and off that falls into this block, at its frame */
+        for (uint64_t frame = start; frame < start + kBlock; ++frame)
+        {
+            const uint32_t step = (uint32_t)(frame / stepFrames % 16);
+            const uint32_t offset = (uint32_t)(frame % stepFrames);
+            const uint32_t at = (uint32_t)(frame - start);
+
+            if (offset == 0 && notes[step] != 0)
+            {
+                /* with a note still held the engine slides into this one */
+                const uint8_t on[3] = { 0x90, notes[step], (uint8_t)(accents[step] ? 127 : 80) };
+                synth303_queue_event(synth, at, on);
+                if (held >= 0 && held != notes[step])
+                {
+                    const uint8_t off[3] = { 0x80, (uint8_t)held, 0 };
+                    synth303_queue_event(synth, at, off);
+                }
+                held = notes[step];
+            }
+            else if ((offset == 0 || (offset == gateFrames && !slides[step])) && held >= 0)
+            {
+                const uint8_t off[3] = { 0x80, (uint8_t)held, 0 };
+                synth303_queue_event(synth, at, off);
+                held = -1;
+            }
+        }
+
+        synth303_process(synth, NULL, outputs, kBlock);
+
+        for (int i = 0; i < kBlock; ++i)
+            peak = fmaxf(peak, fabsf(audio[i]));
+        fwrite(audio, sizeof(float), kBlock, file);
+    }
+
+    char preset[128];
+    if (synth303_get_state(synth, "preset", preset, sizeof(preset)) <= sizeof(preset))
+        printf("preset %s\n", preset);
+    printf("%s: %llu frames at %d Hz, peak %.3f\n", path, (unsigned long long)total, kRate, peak);
+
+    synth303_destroy(synth);
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,449 @@
+// Fits the constants of the cutoff formula in vcf_env_freq to measured cutoff frequencies.
+//
+// usage: synth303-fit measurements.csv [--fit A,B,C,...] [--restarts n] [--threads n] [--seed n]
+//                     [--iterations n] [--residuals file.csv] [--A v] [--B v] ... [--VaccMul v]
+//
+// One measurement per line, comma or space separated, '#' starts a comment, a header line is skipped:
+//
+//   vco, vmod, env, vacc, hz [, weight]
+//
+// vco and vmod are the fVco and fVmod knob values, env the VCF envelope (0 at rest, 1.01 at the peak the
+// plugin prints as "Freq max") and vacc the accent sweep voltage. The "Freq min / Freq max" readings in
+// the notes file are rows with env 0 and 1.01 and vacc 0.
+//
+// The cost is the weighted mean squared relative error. Nelder-Mead runs from the starting constants and
+// from `restarts` randomly perturbed copies of them, spread over all cores; each restart is seeded by its
+// index, so the result does not depend on the thread count. Every candidate is evaluated over the whole
+// table with vcf_env_freq_batch.
+//
+// Only some constants can be told apart by the data: (A*Vco + B) * exp(E) leaves A, B and E one degree of
+// freedom too many, and D and VaccMul only appear as their product. The default fit is therefore A, B, C
+// and base, plus D when any row has accent voltage; E and VaccMul keep their starting values.
+
+#include "Synth303Engine.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+enum FormulaConstant { kConstA, kConstB, kConstC, kConstD, kConstE, kConstBase, kConstVaccMul, kConstCount };
+
+static const char* const kConstNames[kConstCount] = { "A", "B", "C", "D", "E", "base", "VaccMul" };
+
+typedef double Constants[kConstCount];
+
+// --------------------------------------------------------------------------------------------------------------------
+// measurements
+
+struct Measurements {
+    // structure of arrays, the layout vcf_env_freq_batch takes
+    std::vector<float> vco, vmod, env, vacc, hz, weight;
+
+    size_t size() const {
+        return hz.size();
+    }
+
+    bool load(const char* path) {
+        std::FILE* const file = std::fopen(path, "r");
+        if (file == nullptr)
+        {
+            std::fprintf(stderr, "could not open %s\n", path);
+            return false;
+        }
+
+        char line[512];
+        unsigned lineNumber = 0;
+        bool ok = true;
+        while (ok && std::fgets(line, sizeof(line), file) != nullptr)
+        {
+            ++lineNumber;
+            if (char* const comment = std::strchr(line, '#'))
+                *comment = '\0';
+            for (char* c = line; *c != '\0'; ++c)
+                if (*c == ',' || *c == ';' || *c == '\t')
+                    *c = ' ';
+
+            float v[6];
+            const int n = std::sscanf(line, "%f %f %f %f %f %f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]);
+            if (n <= 0)
+            {
+                // blank, comment or header
+                char word[2];
+                if (std::sscanf(line, "%1s", word) == 1 && size() != 0)
+                    ok = false;
+                continue;
+            }
+            if (n < 5 || !(v[4] > 0.0f) || (n == 6 && !(v[5] >= 0.0f)))
+            {
+                ok = false;
+                continue;
+            }
+
+            vco.push_back(v[0]);
+            vmod.push_back(v[1]);
+            env.push_back(v[2]);
+            vacc.push_back(v[3]);
+            hz.push_back(v[4]);
+            weight.push_back(n == 6 ? v[5] : 1.0f);
+        }
+        std::fclose(file);
+
+        if (!ok)
+            std::fprintf(stderr, "%s:%u: expected vco, vmod, env, vacc, hz [, weight] with hz > 0\n", path, lineNumber);
+        else if (size() == 0)
+            std::fprintf(stderr, "%s: no measurements\n", path);
+
+        return ok && size() != 0;
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// cost
+
+struct Evaluator {
+    const Measurements& data;
+    std::vector<float> predicted;
+    double weightSum = 0.0;
+    std::atomic<uint64_t>& evaluations;
+
+    Evaluator(const Measurements& d, std::atomic<uint64_t>& counter)
+        : data(d), predicted(d.size()), evaluations(counter)
+    {
+        for (float w : data.weight)
+            weightSum += w;
+    }
+
+    void predict(const Constants& k) {
+        vcf_env_freq_batch(data.env.data(), data.vco.data(), data.vmod.data(), data.vacc.data(), predicted.data(),
+                           (uint32_t)data.size(), (float)k[kConstA], (float)k[kConstB], (float)k[kConstC],
+                           (float)k[kConstD], (float)k[kConstE], (float)k[kConstBase], (float)k[kConstVaccMul]);
+    }
+
+    // weighted mean squared relative error
+    double cost(const Constants& k) {
+        evaluations.fetch_add(1, std::memory_order_relaxed);
+        predict(k);
+
+        double sum = 0.0;
+        const float* const hz = data.hz.data();
+        const float* const weight = data.weight.data();
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            const float e = predicted[i] / hz[i] - 1.0f;
+            sum += weight[i] * e * e;
+        }
+
+        // exp overflow with wild constants, never let those win
+        return std::isfinite(sum) ? sum / weightSum : HUGE_VAL;
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Nelder-Mead over the free constants
+
+struct FitResult {
+    Constants constants;
+    double cost;
+    unsigned iterations;
+};
+
+static FitResult nelderMead(Evaluator& evaluator, const Constants& start, const int* free, int dims,
+                            unsigned maxIterations)
+{
+    struct Vertex {
+        Constants k;
+        double cost;
+    };
+
+    auto evaluate = [&](Vertex& v) { v.cost = evaluator.cost(v.k); };
+
+    std::vector<Vertex> simplex(dims + 1);
+    for (int v = 0; v <= dims; ++v)
+    {
+        std::memcpy(simplex[v].k, start, sizeof(Constants));
+        if (v != 0)
+        {
+            double& x = simplex[v].k[free[v - 1]];
+            x += x != 0.0 ? 0.1 * x : 0.05;
+        }
+        evaluate(simplex[v]);
+    }
+
+    // centroid + t * (from - centroid), `from` may be out's own constants
+    auto along = [&](const Constants& centroid, const Constants& from, double t, Vertex& out) {
+        Constants k;
+        std::memcpy(k, from, sizeof(Constants));
+        for (int d = 0; d < dims; ++d)
+            k[free[d]] = centroid[free[d]] + t * (from[free[d]] - centroid[free[d]]);
+        std::memcpy(out.k, k, sizeof(Constants));
+        evaluate(out);
+    };
+
+    unsigned iteration = 0;
+    for (; iteration < maxIterations; ++iteration)
+    {
+        std::sort(simplex.begin(), simplex.end(), [](const Vertex& a, const Vertex& b) { return a.cost < b.cost; });
+
+        const double best = simplex.front().cost, worst = simplex.back().cost;
+        if (worst - best <= 1e-10 * (best + 1e-20))
+            break;
+
+        Constants centroid;
+        std::memcpy(centroid, simplex[0].k, sizeof(Constants));
+        for (int d = 0; d < dims; ++d)
+        {
+            double sum = 0.0;
+            for (int v = 0; v < dims; ++v)
+                sum += simplex[v].k[free[d]];
+            centroid[free[d]] = sum / dims;
+        }
+
+        Vertex& last = simplex.back();
+        Vertex reflected, candidate;
+        along(centroid, last.k, -1.0, reflected);
+
+        if (reflected.cost < best)
+        {
+            along(centroid, last.k, -2.0, candidate);
+            last = candidate.cost < reflected.cost ? candidate : reflected;
+        }
+        else if (reflected.cost < simplex[dims - 1].cost)
+        {
+            last = reflected;
+        }
+        else
+        {
+            const bool outside = reflected.cost < last.cost;
+            along(centroid, outside ? reflected.k : last.k, 0.5, candidate);
+            if (candidate.cost < std::min(reflected.cost, last.cost))
+            {
+                last = candidate;
+            }
+            else
+            {
+                for (int v = 1; v <= dims; ++v)
+                    along(simplex[0].k, simplex[v].k, 0.5, simplex[v]);
+            }
+        }
+    }
+
+    const Vertex& best = *std::min_element(simplex.begin(), simplex.end(),
+                                           [](const Vertex& a, const Vertex& b) { return a.cost < b.cost; });
+    FitResult result;
+    std::memcpy(result.constants, best.k, sizeof(Constants));
+    result.cost = best.cost;
+    result.iterations = iteration;
+    return result;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static void printConstants(std::FILE* out, const Constants& k)
+{
+    // the format of print_parameters(), ready to paste back into the defaults
+    for (int c = 0; c < kConstCount; ++c)
+        std::fprintf(out, "float %s = %f;\n", kConstNames[c], k[c]);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* dataPath = nullptr;
+    const char* residualsPath = nullptr;
+    const char* fitList = nullptr;
+    unsigned restarts = 64;
+    unsigned iterations = 4000;
+    unsigned seed = 1;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    Synth303Engine defaults;
+    Constants start = { defaults.A, defaults.B, defaults.C, defaults.D, defaults.E, defaults.base, defaults.VaccMul };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        int constant = -1;
+        for (int c = 0; c < kConstCount; ++c)
+            if (argv[i][0] == '-' && argv[i][1] == '-' && std::strcmp(argv[i] + 2, kConstNames[c]) == 0)
+                constant = c;
+
+        if (constant >= 0 && hasValue)
+            start[constant] = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--fit") == 0 && hasValue)
+            fitList = argv[++i];
+        else if (std::strcmp(argv[i], "--restarts") == 0 && hasValue)
+            restarts = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--iterations") == 0 && hasValue)
+            iterations = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+            seed = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+            threads = (unsigned)std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--residuals") == 0 && hasValue)
+            residualsPath = argv[++i];
+        else if (argv[i][0] != '-' && dataPath == nullptr)
+            dataPath = argv[i];
+        else
+            dataPath = nullptr, i = argc;
+    }
+
+    if (dataPath == nullptr)
+    {
+        std::fprintf(stderr, "usage: synth303-fit measurements.csv [--fit A,B,C,...] [--restarts n] [--threads n] "
+                             "[--seed n] [--iterations n] [--residuals file.csv] [--A v ... --VaccMul v]\n");
+        return 1;
+    }
+
+    Measurements data;
+    if (!data.load(dataPath))
+        return 1;
+
+    // free constants
+    int free[kConstCount];
+    int dims = 0;
+    if (fitList != nullptr)
+    {
+        for (const char* s = fitList; *s != '\0';)
+        {
+            const size_t length = std::strcspn(s, ",");
+            int found = -1;
+            for (int c = 0; c < kConstCount; ++c)
+                if (std::strlen(kConstNames[c]) == length && std::strncmp(s, kConstNames[c], length) == 0)
+                    found = c;
+            if (found < 0)
+            {
+                std::fprintf(stderr, "unknown constant in --fit: %.*s\n", (int)length, s);
+                return 1;
+            }
+            if (std::find(free, free + dims, found) == free + dims)
+                free[dims++] = found;
+            s += length + (s[length] == ',');
+        }
+    }
+    else
+    {
+        for (int c : { kConstA, kConstB, kConstC, kConstBase })
+            free[dims++] = c;
+        if (std::any_of(data.vacc.begin(), data.vacc.end(), [](float v) { return v != 0.0f; }))
+            free[dims++] = kConstD;
+    }
+    if (dims == 0)
+    {
+        std::fprintf(stderr, "nothing to fit\n");
+        return 1;
+    }
+
+    std::fprintf(stderr, "synth303-fit: %zu measurements, fitting", data.size());
+    for (int d = 0; d < dims; ++d)
+        std::fprintf(stderr, " %s", kConstNames[free[d]]);
+    std::fprintf(stderr, ", %u restarts on %u threads\n", restarts, threads);
+
+    std::atomic<uint64_t> evaluations { 0 };
+    std::vector<FitResult> results(restarts + 1);
+    std::atomic<unsigned> next { 0 };
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    auto worker = [&] {
+        Evaluator evaluator(data, evaluations);
+
+        for (unsigned r; (r = next.fetch_add(1)) <= restarts;)
+        {
+            Constants from;
+            std::memcpy(from, start, sizeof(Constants));
+
+            // restart 0 starts from the given constants, the others from log-normal perturbations of them
+            if (r != 0)
+            {
+                std::mt19937 rng(seed * 7919u + r);
+                std::normal_distribution<double> spread(0.0, 0.5);
+                for (int d = 0; d < dims; ++d)
+                {
+                    double& x = from[free[d]];
+                    x = x != 0.0 ? x * std::exp(spread(rng)) : spread(rng);
+                }
+            }
+
+            // restart the simplex from its own optimum once, Nelder-Mead likes to stall on a collapsed simplex
+            FitResult result = nelderMead(evaluator, from, free, dims, iterations);
+            const FitResult polished = nelderMead(evaluator, result.constants, free, dims, iterations);
+            if (polished.cost <= result.cost)
+                result = polished;
+            results[r] = result;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t)
+        pool.emplace_back(worker);
+    for (std::thread& t : pool)
+        t.join();
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    // lowest cost, the lowest restart index on ties
+    const FitResult* best = &results[0];
+    for (const FitResult& result : results)
+        if (result.cost < best->cost)
+            best = &result;
+
+    std::atomic<uint64_t> unused { 0 };
+    Evaluator evaluator(data, unused);
+    const double startCost = evaluator.cost(start);
+
+    std::fprintf(stderr, "%llu evaluations in %.2fs (%.0f/s, %.1fM points/s), best from restart %d\n",
+                 (unsigned long long)evaluations.load(), elapsed, evaluations / elapsed,
+                 evaluations * (double)data.size() / elapsed / 1e6, (int)(best - results.data()));
+    std::fprintf(stderr, "rms relative error %.3f%% -> %.3f%%\n\n", std::sqrt(startCost) * 100.0,
+                 std::sqrt(best->cost) * 100.0);
+
+    printConstants(stdout, best->constants);
+
+    // residuals of the function that was minimized, vcf_env_freq_batch. The engine runs the scalar
+    // vcf_env_freq, which only parts from it where the fit leans on the clamp of the batch exp.
+    const double* const k = best->constants;
+    evaluator.predict(best->constants);
+    std::FILE* residuals = nullptr;
+    if (residualsPath != nullptr && (residuals = std::fopen(residualsPath, "w")) == nullptr)
+        std::fprintf(stderr, "could not create %s\n", residualsPath);
+
+    if (residuals != nullptr)
+        std::fprintf(residuals, "vco,vmod,env,vacc,hz,weight,predicted,relative_error\n");
+    else if (data.size() <= 64)
+        std::fprintf(stdout, "\n%8s %8s %8s %8s | %10s %10s %8s\n", "vco", "vmod", "env", "vacc", "measured", "fitted", "error");
+
+    double worst = 0.0, engineWorst = 0.0;
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        const float predicted = evaluator.predicted[i];
+        const double error = predicted / data.hz[i] - 1.0;
+        worst = std::max(worst, std::fabs(error));
+
+        const float engine = vcf_env_freq(data.env[i], data.vco[i], data.vmod[i], data.vacc[i],
+                                          (float)k[kConstA], (float)k[kConstB], (float)k[kConstC], (float)k[kConstD],
+                                          (float)k[kConstE], (float)k[kConstBase], (float)k[kConstVaccMul]);
+        const double deviation = std::fabs((double)engine / predicted - 1.0);
+        engineWorst = std::isnan(deviation) ? HUGE_VAL : std::max(engineWorst, deviation);
+
+        if (residuals != nullptr)
+            std::fprintf(residuals, "%g,%g,%g,%g,%g,%g,%g,%g\n", data.vco[i], data.vmod[i], data.env[i], data.vacc[i],
+                         data.hz[i], data.weight[i], predicted, error);
+        else if (data.size() <= 64)
+            std::fprintf(stdout, "%8.3f %8.3f %8.3f %8.3f | %10.2f %10.2f %+7.2f%%\n", data.vco[i], data.vmod[i],
+                         data.env[i], data.vacc[i], data.hz[i], predicted, error * 100.0);
+    }
+    if (residuals != nullptr)
+        std::fclose(residuals);
+
+    std::fprintf(stderr, "max relative error %.3f%%\n", worst * 100.0);
+    if (engineWorst > 1e-4)
+        std::fprintf(stderr, "warning: the engine's vcf_env_freq differs from the fitted values by up to %.3g%%, "
+                             "the constants rely on the clamped exp of the fit\n", engineWorst * 100.0);
+    return 0;
+}
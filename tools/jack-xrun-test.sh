@@ -0,0 +1,116 @@
+#!/bin/sh
+# Xrun test of the JACK standalone in real-time mode: for each period size, starts a JACK server on the dummy
+# backend, launches the standalone instances with SYNTH303_REALTIME=1, drives them all with synth303-jackload
+# and fails if the server reported any xrun while they played.
+#
+# usage: tools/jack-xrun-test.sh <build dir> [instances] [seconds per period]    (default: 4 instances, 600 s)
+#
+#   PERIODS="16 32 64"   period sizes to test
+#   RATE=48000           dummy backend sample rate
+#   MAX_XRUNS=0          xruns tolerated per period size
+#   SYNTH303_RT_CPU=n    pin the instances' audio threads, passed through
+#
+# Needs a build with -DSYNTH303_BUILD_TOOLS=ON and JACK development files, jackd (JACK2) and, for the
+# standalone's editor, an X display: without DISPLAY the instances run under xvfb-run when it is installed.
+# Real-time scheduling and memory locking need the usual limits (the audio group, rtprio and memlock).
+
+set -e
+
+build=${1:?usage: $0 <build dir> [instances] [seconds per period]}
+instances=${2:-4}
+seconds=${3:-600}
+periods=${PERIODS:-16 32 64}
+rate=${RATE:-48000}
+max_xruns=${MAX_XRUNS:-0}
+
+standalone=$build/bin/synth303maker
+jackload=$build/tools/synth303-jackload
+for binary in "$standalone" "$jackload"; do
+    if [ ! -x "$binary" ]; then
+        echo "missing $binary" >&2
+        exit 1
+    fi
+done
+
+wrap=""
+if [ -z "$DISPLAY" ] && command -v xvfb-run >/dev/null 2>&1; then
+    wrap="xvfb-run -a"
+fi
+# each instance in a process group of its own, so cleanup also ends what the wrapper started
+group=""
+if command -v setsid >/dev/null 2>&1; then
+    group="setsid"
+fi
+
+logs=$(mktemp -d)
+jackd_pid=""
+pids=""
+
+# never fails: under set -e the status of a killed child would end the script
+cleanup() {
+    for pid in $pids; do
+        kill -TERM "-$pid" 2>/dev/null || kill -TERM "$pid" 2>/dev/null || true
+    done
+    for pid in $pids; do
+        wait "$pid" 2>/dev/null || true
+    done
+    if [ -n "$jackd_pid" ]; then
+        kill "$jackd_pid" 2>/dev/null || true
+        wait "$jackd_pid" 2>/dev/null || true
+    fi
+    pids=""
+    jackd_pid=""
+}
+trap 'cleanup; rm -rf "$logs"' EXIT
+trap 'exit 130' INT TERM
+
+failed=0
+for period in $periods; do
+    echo "== $period frames at $rate Hz, $instances instances, $seconds s"
+
+    jackd -R -d dummy -r "$rate" -p "$period" >"$logs/jackd-$period.log" 2>&1 &
+    jackd_pid=$!
+    tries=0
+    until jack_lsp >/dev/null 2>&1; do
+        tries=$((tries + 1))
+        if [ $tries -gt 50 ]; then
+            echo "jackd did not start, see below" >&2
+            cat "$logs/jackd-$period.log" >&2
+            exit 1
+        fi
+        sleep 0.1
+    done
+
+    i=0
+    while [ $i -lt "$instances" ]; do
+        SYNTH303_REALTIME=1 $group $wrap "$standalone" >"$logs/instance-$period-$i.log" 2>&1 &
+        pids="$pids $!"
+        i=$((i + 1))
+    done
+    # the instances register their ports once their plugin and editor are up
+    tries=0
+    while [ "$(jack_lsp 2>/dev/null | grep -c 'synth303maker.*events-in')" -lt "$instances" ]; do
+        tries=$((tries + 1))
+        if [ $tries -gt 100 ]; then
+            echo "only $(jack_lsp 2>/dev/null | grep -c 'synth303maker.*events-in') of $instances instances came up" >&2
+            exit 1
+        fi
+        sleep 0.1
+    done
+
+    status=0
+    "$jackload" --seconds "$seconds" --max-xruns "$max_xruns" || status=$?
+
+    cleanup
+    # each instance prints its callback stats when it deactivates
+    grep -h "^realtime:" "$logs"/instance-"$period"-*.log || true
+
+    if [ $status -ne 0 ]; then
+        echo "FAIL at $period frames"
+        failed=1
+    else
+        echo "ok at $period frames"
+    fi
+done
+
+exit $failed
@@ -0,0 +1,188 @@
+// JACK client for xrun tests of the standalone: plays a canonical pattern as MIDI into every synth303maker
+// instance on the server and counts the server's xruns while they render.
+//
+// Connects its MIDI output to each input port matching --match, waits --settle seconds (connecting clients
+// reorders the graph, which may xrun on its own), then counts xruns for --seconds. Exits with status 2 when
+// more than --max-xruns happened, so tools/jack-xrun-test.sh can assert on it.
+//
+// usage: synth303-jackload [--seconds s] [--settle s] [--pattern name] [--match regex] [--max-xruns n]
+
+#include "Workload.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <jack/jack.h>
+#include <jack/midiport.h>
+
+// --------------------------------------------------------------------------------------------------------------------
+
+// what PatternPlayer plays into, writing note on/off into the JACK MIDI buffer of the current period
+struct MidiWriter {
+    void* buffer = nullptr;
+    uint32_t time = 0;
+    uint32_t lost = 0;
+
+    void midiEvent(uint8_t status, uint8_t note, uint8_t velocity) {
+        const jack_midi_data_t data[3] = { status, note, velocity };
+        if (jack_midi_event_write(buffer, time, data, 3) != 0)
+            ++lost;
+    }
+
+    void process(float* const*, uint32_t frames) {
+        time += frames;
+    }
+};
+
+struct LoadClient {
+    jack_client_t* client = nullptr;
+    jack_port_t* midiOut = nullptr;
+
+    PatternPlayer player;
+    MidiWriter writer;
+    std::vector<float> scratch; // PatternPlayer hands out output pointers, nothing is written through them
+
+    std::atomic<bool> counting { false };
+    std::atomic<uint32_t> xruns { 0 };
+    std::atomic<uint32_t> settleXruns { 0 };
+    std::atomic<float> maxLoad { 0.0f };
+
+    static int process(jack_nframes_t frames, void* arg) {
+        LoadClient* const self = static_cast<LoadClient*>(arg);
+        self->writer.buffer = jack_port_get_buffer(self->midiOut, frames);
+        self->writer.time = 0;
+        jack_midi_clear_buffer(self->writer.buffer);
+
+        float* const outputs[4] = { self->scratch.data(), self->scratch.data(), self->scratch.data(), self->scratch.data() };
+        self->player.render(self->writer, outputs, frames);
+        return 0;
+    }
+
+    static int xrun(void* arg) {
+        LoadClient* const self = static_cast<LoadClient*>(arg);
+        (self->counting.load() ? self->xruns : self->settleXruns).fetch_add(1);
+        return 0;
+    }
+};
+
+static std::atomic<bool> interrupted { false };
+
+static void onSignal(int) {
+    interrupted = true;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    double seconds = 60.0;
+    double settle = 2.0;
+    const char* patternName = "default";
+    const char* match = "synth303maker";
+    uint32_t maxXruns = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--seconds") == 0 && hasValue)
+            seconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--settle") == 0 && hasValue)
+            settle = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--pattern") == 0 && hasValue)
+            patternName = argv[++i];
+        else if (std::strcmp(argv[i], "--match") == 0 && hasValue)
+            match = argv[++i];
+        else if (std::strcmp(argv[i], "--max-xruns") == 0 && hasValue)
+            maxXruns = (uint32_t)std::atoi(argv[++i]);
+        else
+        {
+            std::fprintf(stderr, "usage: synth303-jackload [--seconds s] [--settle s] [--pattern name] "
+                                 "[--match regex] [--max-xruns n]\n");
+            return 1;
+        }
+    }
+
+    const Pattern* const pattern = findPattern(patternName);
+    if (pattern == nullptr)
+    {
+        std::fprintf(stderr, "unknown pattern %s\n", patternName);
+        return 1;
+    }
+
+    LoadClient load;
+    jack_status_t status;
+    load.client = jack_client_open("synth303-jackload", JackNoStartServer, &status);
+    if (load.client == nullptr)
+    {
+        std::fprintf(stderr, "cannot connect to the JACK server (status 0x%x)\n", (unsigned)status);
+        return 1;
+    }
+
+    const jack_nframes_t period = jack_get_buffer_size(load.client);
+    const jack_nframes_t sampleRate = jack_get_sample_rate(load.client);
+    load.scratch.resize(period);
+    load.player.reset(pattern, sampleRate);
+    load.midiOut = jack_port_register(load.client, "midi_out", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
+    jack_set_process_callback(load.client, LoadClient::process, &load);
+    jack_set_xrun_callback(load.client, LoadClient::xrun, &load);
+
+    if (load.midiOut == nullptr || jack_activate(load.client) != 0)
+    {
+        std::fprintf(stderr, "cannot activate the JACK client\n");
+        jack_client_close(load.client);
+        return 1;
+    }
+
+    int instances = 0;
+    if (const char** const ports = jack_get_ports(load.client, match, JACK_DEFAULT_MIDI_TYPE, JackPortIsInput))
+    {
+        for (const char** port = ports; *port != nullptr; ++port)
+            if (jack_connect(load.client, jack_port_name(load.midiOut), *port) == 0)
+                ++instances;
+        jack_free(ports);
+    }
+    std::printf("%d MIDI inputs matching '%s', %u frames at %u Hz, pattern %s\n",
+                instances, match, period, sampleRate, pattern->name);
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    const auto sleepFor = [](double s) {
+        const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(s);
+        while (!interrupted && std::chrono::steady_clock::now() < end)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    };
+    const auto watchLoad = [&](double s) {
+        const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(s);
+        while (!interrupted && std::chrono::steady_clock::now() < end)
+        {
+            load.maxLoad = std::max(load.maxLoad.load(), jack_cpu_load(load.client));
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    };
+
+    sleepFor(settle);
+    load.counting = true;
+    watchLoad(seconds);
+    load.counting = false;
+
+    jack_deactivate(load.client);
+    jack_client_close(load.client);
+
+    const uint32_t xruns = load.xruns.load();
+    std::printf("%u xruns in %.0f s (%u while settling), max DSP load %.1f%%, %u MIDI events lost\n",
+                xruns, seconds, load.settleXruns.load(), load.maxLoad.load(), load.writer.lost);
+
+    if (instances == 0)
+    {
+        std::fprintf(stderr, "no instance to drive\n");
+        return 1;
+    }
+    return xruns > maxXruns ? 2 : 0;
+}
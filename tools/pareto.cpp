@@ -0,0 +1,312 @@
+// Accuracy against CPU for every engine configuration this build can run, and the Pareto front of them.
+//
+// usage: synth303-pareto [--pattern name|all] [--seconds s] [--rate hz] [--repeat n] [--csv file]
+//
+// Every configuration renders the canonical patterns (Workload.hpp) and is compared with the reference
+// configuration, the first row: plain SSE2 kernels, the built-in vcf_env_freq and 256 sample blocks, the
+// way the plugin shipped. Per configuration:
+//
+//   ns/sample     best of --repeat runs over all patterns
+//   time err      rms of the audio difference relative to the reference rms, dB
+//   peak err      largest absolute sample difference
+//   spectral      log-spectral distance, rms over frames and bins within 100 dB of each frame's peak, dB
+//   cutoff cents  rms and max deviation of the cutoff trajectory (the cutoff CV output)
+//
+// A configuration is on the front when no other one is at least as fast and at least as accurate on all
+// four error columns. New speed/accuracy trade-offs belong in buildConfigs() as more rows.
+
+#include "Workload.hpp"
+#include "Spectrum.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------------------------------------------------
+// configurations
+
+struct EngineConfig {
+    std::string name;
+    CpuIsa isa;
+    const char* formula; // runtime cutoff formula, nullptr for vcf_env_freq
+    uint32_t blockSize;
+};
+
+static std::vector<EngineConfig> buildConfigs()
+{
+    static const struct { const char* name; const char* text; } kCutoffPaths[] = {
+        { "builtin", nullptr },
+        { "formula", CutoffFormula::kBuiltinText }, // block program with the polynomial exp
+    };
+    static const uint32_t kBlockSizes[] = { 256, 32 };
+
+    std::vector<EngineConfig> configs;
+    for (int isa = 0; isa < (int)CpuIsa::Count; ++isa)
+    {
+        if (!isCpuIsaSupported((CpuIsa)isa))
+            continue;
+        for (const auto& cutoff : kCutoffPaths)
+            for (uint32_t block : kBlockSizes)
+                configs.push_back({ std::string(cpuIsaName((CpuIsa)isa)) + "/" + cutoff.name + "/" + std::to_string(block),
+                                    (CpuIsa)isa, cutoff.text, block });
+    }
+    return configs;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// rendering
+
+struct Rendering {
+    std::vector<float> audio;  // all patterns, one after another
+    std::vector<float> cutoff; // cutoff CV, freq / nyquist
+    double nsPerSample = 0.0;
+};
+
+static Rendering render(const EngineConfig& config, const std::vector<const Pattern*>& patterns,
+                        double sampleRate, uint32_t framesPerPattern, int repeat)
+{
+    Rendering result;
+    result.nsPerSample = INFINITY;
+
+    std::vector<float> out[4];
+    for (std::vector<float>& o : out)
+        o.resize(config.blockSize);
+    float* outputs[4] = { out[0].data(), out[1].data(), out[2].data(), out[3].data() };
+
+    for (int r = 0; r < repeat; ++r)
+    {
+        const bool keep = r == 0;
+        double ns = 0.0;
+
+        for (const Pattern* const pattern : patterns)
+        {
+            Synth303Engine engine;
+            pattern->settings.apply(engine);
+            engine.isaOverride = config.isa;
+            engine.cvOutputs = true;
+            if (config.formula != nullptr)
+                engine.setFormula(config.formula);
+            engine.sampleRateChanged(sampleRate);
+            engine.activate(sampleRate, config.blockSize);
+
+            PatternPlayer player;
+            player.reset(pattern, sampleRate);
+
+            const auto start = std::chrono::steady_clock::now();
+            for (uint32_t done = 0; done < framesPerPattern; done += config.blockSize)
+            {
+                const uint32_t frames = std::min(config.blockSize, framesPerPattern - done);
+                player.render(engine, outputs, frames);
+                if (keep)
+                {
+                    result.audio.insert(result.audio.end(), out[0].begin(), out[0].begin() + frames);
+                    result.cutoff.insert(result.cutoff.end(), out[3].begin(), out[3].begin() + frames);
+                }
+            }
+            ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        result.nsPerSample = std::min(result.nsPerSample, ns / ((double)framesPerPattern * patterns.size()));
+    }
+
+    return result;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// error measures
+
+struct Deviation {
+    double timeErrorDb = -INFINITY;
+    double peakError = 0.0;
+    double spectralDb = 0.0;
+    double centsRms = 0.0;
+    double centsMax = 0.0;
+};
+
+static Deviation compare(const Rendering& ref, const Rendering& test)
+{
+    Deviation d;
+    const std::size_t n = std::min(ref.audio.size(), test.audio.size());
+
+    double refSquares = 0.0, errorSquares = 0.0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const double e = (double)test.audio[i] - ref.audio[i];
+        refSquares += (double)ref.audio[i] * ref.audio[i];
+        errorSquares += e * e;
+        d.peakError = std::max(d.peakError, std::fabs(e));
+    }
+    if (errorSquares > 0.0)
+        d.timeErrorDb = 10.0 * std::log10(errorSquares / std::max(refSquares, 1e-30));
+
+    constexpr std::size_t kFft = 4096;
+    Spectrum spectrum(kFft);
+    std::vector<double> refPower(spectrum.bins()), testPower(spectrum.bins());
+    double spectralSum = 0.0;
+    std::size_t spectralCount = 0;
+    for (std::size_t start = 0; start + kFft <= n; start += kFft / 2)
+    {
+        spectrum.power(&ref.audio[start], refPower.data());
+        spectrum.power(&test.audio[start], testPower.data());
+
+        const double floor = *std::max_element(refPower.begin(), refPower.end()) * 1e-10;
+        if (floor <= 0.0)
+            continue;
+        for (std::size_t k = 0; k < refPower.size(); ++k)
+        {
+            if (refPower[k] < floor)
+                continue;
+            const double db = 10.0 * std::log10(std::max(testPower[k], floor * 1e-2) / refPower[k]);
+            spectralSum += db * db;
+            ++spectralCount;
+        }
+    }
+    if (spectralCount != 0)
+        d.spectralDb = std::sqrt(spectralSum / spectralCount);
+
+    double centsSquares = 0.0;
+    std::size_t centsCount = 0;
+    for (std::size_t i = 0; i < std::min(ref.cutoff.size(), test.cutoff.size()); ++i)
+    {
+        if (!(ref.cutoff[i] > 0.0f && test.cutoff[i] > 0.0f))
+            continue;
+        const double cents = 1200.0 * std::log2((double)test.cutoff[i] / ref.cutoff[i]);
+        centsSquares += cents * cents;
+        d.centsMax = std::max(d.centsMax, std::fabs(cents));
+        ++centsCount;
+    }
+    if (centsCount != 0)
+        d.centsRms = std::sqrt(centsSquares / centsCount);
+
+    return d;
+}
+
+// a is at least as good as b everywhere and better somewhere
+static bool dominates(double aNs, const Deviation& a, double bNs, const Deviation& b)
+{
+    const double av[5] = { aNs, a.timeErrorDb, a.peakError, a.spectralDb, a.centsMax };
+    const double bv[5] = { bNs, b.timeErrorDb, b.peakError, b.spectralDb, b.centsMax };
+    bool better = false;
+    for (int i = 0; i < 5; ++i)
+    {
+        if (av[i] > bv[i])
+            return false;
+        better |= av[i] < bv[i];
+    }
+    return better;
+}
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: synth303-pareto [--pattern name|all] [--seconds s] [--rate hz] [--repeat n] [--csv file]\n");
+}
+
+int main(int argc, char* argv[])
+{
+    const char* patternName = "all";
+    const char* csvPath = nullptr;
+    double seconds = 4.0;
+    double sampleRate = 48000.0;
+    int repeat = 3;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--pattern") == 0 && hasValue)
+            patternName = argv[++i];
+        else if (std::strcmp(argv[i], "--seconds") == 0 && hasValue)
+            seconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--rate") == 0 && hasValue)
+            sampleRate = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--repeat") == 0 && hasValue)
+            repeat = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--csv") == 0 && hasValue)
+            csvPath = argv[++i];
+        else
+            return usage(), 1;
+    }
+
+    std::vector<const Pattern*> patterns;
+    if (std::strcmp(patternName, "all") == 0)
+    {
+        for (const Pattern& pattern : kPatterns)
+            patterns.push_back(&pattern);
+    }
+    else if (const Pattern* const pattern = findPattern(patternName))
+    {
+        patterns.push_back(pattern);
+    }
+    if (patterns.empty() || seconds <= 0.0 || sampleRate <= 0.0)
+        return usage(), 1;
+
+    const uint32_t framesPerPattern = (uint32_t)(seconds * sampleRate);
+    const std::vector<EngineConfig> configs = buildConfigs();
+
+    std::vector<Rendering> renderings;
+    std::vector<Deviation> deviations;
+    for (const EngineConfig& config : configs)
+    {
+        std::fprintf(stderr, "\rrendering %-32s", config.name.c_str());
+        renderings.push_back(render(config, patterns, sampleRate, framesPerPattern, repeat));
+        deviations.push_back(compare(renderings.front(), renderings.back()));
+        // only the reference audio is compared again, shrink_to_fit() on a full vector would keep it all
+        if (renderings.size() > 1)
+            std::vector<float>().swap(renderings.back().audio);
+    }
+    std::fprintf(stderr, "\r%-42s\r", "");
+
+    std::vector<bool> front(configs.size(), true);
+    for (std::size_t a = 0; a < configs.size(); ++a)
+        for (std::size_t b = 0; b < configs.size(); ++b)
+            if (a != b && dominates(renderings[b].nsPerSample, deviations[b], renderings[a].nsPerSample, deviations[a]))
+                front[a] = false;
+
+    std::printf("synth303maker accuracy vs CPU, %zu pattern(s) x %.1fs @ %.0fHz, reference %s\n\n",
+                patterns.size(), seconds, sampleRate, configs.front().name.c_str());
+    std::printf("%-24s | %9s | %9s %9s %9s | %9s %9s | %s\n", "config", "ns/sample", "time err", "peak err",
+                "spectral", "cents rms", "cents max", "front");
+
+    std::FILE* csv = csvPath != nullptr ? std::fopen(csvPath, "w") : nullptr;
+    if (csvPath != nullptr && csv == nullptr)
+        std::fprintf(stderr, "could not create %s\n", csvPath);
+    if (csv != nullptr)
+        std::fprintf(csv, "config,ns_per_sample,time_err_db,peak_err,spectral_db,cents_rms,cents_max,front\n");
+
+    for (std::size_t c = 0; c < configs.size(); ++c)
+    {
+        const Deviation& d = deviations[c];
+        char timeError[16];
+        if (std::isinf(d.timeErrorDb))
+            std::snprintf(timeError, sizeof(timeError), "exact");
+        else
+            std::snprintf(timeError, sizeof(timeError), "%.1fdB", d.timeErrorDb);
+
+        std::printf("%-24s | %9.2f | %9s %9.2e %7.3fdB | %9.4f %9.4f | %s\n", configs[c].name.c_str(),
+                    renderings[c].nsPerSample, timeError, d.peakError, d.spectralDb, d.centsRms, d.centsMax,
+                    front[c] ? "*" : "");
+        if (csv != nullptr)
+            std::fprintf(csv, "%s,%.3f,%.2f,%.3e,%.4f,%.5f,%.5f,%d\n", configs[c].name.c_str(),
+                         renderings[c].nsPerSample, d.timeErrorDb, d.peakError, d.spectralDb, d.centsRms,
+                         d.centsMax, front[c] ? 1 : 0);
+    }
+    if (csv != nullptr)
+        std::fclose(csv);
+
+    std::printf("\nPareto front, fastest first:\n");
+    std::vector<std::size_t> order;
+    for (std::size_t c = 0; c < configs.size(); ++c)
+        if (front[c])
+            order.push_back(c);
+    std::sort(order.begin(), order.end(),
+              [&](std::size_t a, std::size_t b) { return renderings[a].nsPerSample < renderings[b].nsPerSample; });
+    for (std::size_t c : order)
+        std::printf("  %-24s %9.2f ns/sample, %.4f cents max\n", configs[c].name.c_str(), renderings[c].nsPerSample,
+                    deviations[c].centsMax);
+
+    return 0;
+}
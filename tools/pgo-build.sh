@@ -0,0 +1,51 @@
+#!/bin/sh
+# Builds the plugin with LTO twice, once plain and once profile-guided, trains the PGO build on
+# the canonical patterns and prints the render benchmark of both.
+#
+# usage: tools/pgo-build.sh [build dir prefix]    (default: build-pgo)
+#
+# The GENERATE and USE stages share one build directory: GCC keys profiles on object paths.
+
+set -e
+
+src=$(cd "$(dirname "$0")/.." && pwd)
+prefix=${1:-build-pgo}
+baseline=$prefix-baseline
+pgo=$prefix
+profile=$(pwd)/$pgo/pgo-profile
+jobs=$(nproc 2>/dev/null || echo 4)
+
+configure() {
+    dir=$1; shift
+    cmake -S "$src" -B "$dir" -DCMAKE_BUILD_TYPE=Release -DSYNTH303_LTO=ON -DSYNTH303_BUILD_TOOLS=ON \
+          -DSYNTH303_PGO_DIR="$profile" "$@"
+}
+
+echo "== baseline: LTO only"
+configure "$baseline" -DSYNTH303_PGO=OFF
+cmake --build "$baseline" -j"$jobs"
+
+echo "== stage 1: instrumented build"
+rm -rf "$profile"
+configure "$pgo" -DSYNTH303_PGO=GENERATE
+cmake --build "$pgo" -j"$jobs"
+
+echo "== training on the canonical patterns"
+for rate in 44100 48000 96000; do
+    for block in 32 256 1024; do
+        "$pgo/tools/synth303-render" --pattern all --seconds 4 --rate $rate --block $block
+    done
+done
+
+if grep -q "Clang" "$pgo/CMakeCache.txt"; then
+    llvm-profdata merge -output="$profile/default.profdata" "$profile"/*.profraw
+fi
+
+echo "== stage 2: optimized build"
+configure "$pgo" -DSYNTH303_PGO=USE
+cmake --build "$pgo" -j"$jobs"
+
+echo "== before (LTO)"
+"$baseline/tools/synth303-render" --pattern all --seconds 20 --bench
+echo "== after (LTO + PGO)"
+"$pgo/tools/synth303-render" --pattern all --seconds 20 --bench
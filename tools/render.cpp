@@ -0,0 +1,232 @@
+// Headless render of the canonical patterns, the workload PGO trains on and the benchmark it is judged by.
+//
+// usage: synth303-render [--pattern name|all] [--seconds s] [--rate hz] [--block n] [--out file.wav] [--bench]
+//                        [--trace file.json] [--perf] [--formula text]
+//
+// --out writes the audio output as 32-bit float mono WAV (with all patterns, one after another).
+// --bench prints ns per sample for every pattern instead of staying quiet.
+// --trace writes a Chrome/Perfetto trace: stage spans per block, MIDI instants, cutoff and envelope stage
+// counters, one process per pattern. Open it in ui.perfetto.dev or chrome://tracing.
+// --perf prints hardware counters per stage and sample (Linux perf_event_open), skipped when unavailable.
+// --formula renders with a runtime cutoff formula (see CutoffFormula.hpp) instead of the built-in one, e.g.
+// rendering with and without --formula "(A * Vco + B) * exp(C * Vmod + D * (Vacc * VaccMul) + E) + base"
+// and --bench compares the two paths.
+
+#include "Workload.hpp"
+#include "TraceWriter.hpp"
+#include "PerfCounters.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: synth303-render [--pattern name|all] [--seconds s] [--rate hz] [--block n] "
+                         "[--out file.wav] [--bench] [--trace file.json] [--perf] [--formula text]\npatterns:");
+    for (const Pattern& pattern : kPatterns)
+        std::fprintf(stderr, " %s", pattern.name);
+    std::fprintf(stderr, "\n");
+}
+
+static void writeU32(std::FILE* f, uint32_t v)
+{
+    const unsigned char b[4] = { (unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16), (unsigned char)(v >> 24) };
+    std::fwrite(b, 1, 4, f);
+}
+
+static void writeU16(std::FILE* f, uint16_t v)
+{
+    const unsigned char b[2] = { (unsigned char)v, (unsigned char)(v >> 8) };
+    std::fwrite(b, 1, 2, f);
+}
+
+static bool writeWav(const char* path, const std::vector<float>& samples, uint32_t sampleRate)
+{
+    std::FILE* const f = std::fopen(path, "wb");
+    if (f == nullptr)
+        return false;
+
+    const uint32_t dataBytes = (uint32_t)(samples.size() * sizeof(float));
+    std::fwrite("RIFF", 1, 4, f);
+    writeU32(f, 36 + dataBytes);
+    std::fwrite("WAVEfmt ", 1, 8, f);
+    writeU32(f, 16);
+    writeU16(f, 3); // IEEE float
+    writeU16(f, 1);
+    writeU32(f, sampleRate);
+    writeU32(f, sampleRate * sizeof(float));
+    writeU16(f, sizeof(float));
+    writeU16(f, 32);
+    std::fwrite("data", 1, 4, f);
+    writeU32(f, dataBytes);
+    std::fwrite(samples.data(), sizeof(float), samples.size(), f); // little-endian hosts only
+
+    return std::fclose(f) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* patternName = "all";
+    const char* outPath = nullptr;
+    const char* tracePath = nullptr;
+    const char* formulaText = nullptr;
+    double seconds = 8.0;
+    double sampleRate = 48000.0;
+    uint32_t blockSize = 256;
+    bool bench = false;
+    bool perf = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--pattern") == 0 && hasValue)
+            patternName = argv[++i];
+        else if (std::strcmp(argv[i], "--seconds") == 0 && hasValue)
+            seconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--rate") == 0 && hasValue)
+            sampleRate = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--block") == 0 && hasValue)
+            blockSize = (uint32_t)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--out") == 0 && hasValue)
+            outPath = argv[++i];
+        else if (std::strcmp(argv[i], "--trace") == 0 && hasValue)
+            tracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--bench") == 0)
+            bench = true;
+        else if (std::strcmp(argv[i], "--perf") == 0)
+            perf = true;
+        else if (std::strcmp(argv[i], "--formula") == 0 && hasValue)
+            formulaText = argv[++i];
+        else
+            return usage(), 1;
+    }
+
+    std::vector<const Pattern*> patterns;
+    if (std::strcmp(patternName, "all") == 0)
+    {
+        for (const Pattern& pattern : kPatterns)
+            patterns.push_back(&pattern);
+    }
+    else if (const Pattern* const pattern = findPattern(patternName))
+    {
+        patterns.push_back(pattern);
+    }
+    else
+    {
+        return usage(), 1;
+    }
+
+    if (blockSize == 0 || seconds <= 0.0 || sampleRate <= 0.0)
+        return usage(), 1;
+
+    char formulaError[128];
+    if (formulaText != nullptr && !CutoffFormula().compile(formulaText, formulaError, sizeof(formulaError)))
+    {
+        std::fprintf(stderr, "--formula: %s\n", formulaError);
+        return 1;
+    }
+
+    const uint32_t totalFrames = (uint32_t)(seconds * sampleRate);
+
+    std::vector<float> out[4];
+    for (std::vector<float>& o : out)
+        o.resize(blockSize);
+    float* outputs[4] = { out[0].data(), out[1].data(), out[2].data(), out[3].data() };
+
+    std::vector<float> recording;
+    if (outPath != nullptr)
+        recording.reserve((std::size_t)totalFrames * patterns.size());
+
+    if (bench)
+        std::printf("synth303maker render, %.1fs @ %.0fHz, %u sample blocks\n\n%-12s | %10s\n",
+                    seconds, sampleRate, blockSize, "pattern", "ns/sample");
+
+    TraceWriter trace;
+    if (tracePath != nullptr && !trace.open(tracePath))
+    {
+        std::fprintf(stderr, "could not write %s\n", tracePath);
+        return 1;
+    }
+
+    PerfCounters counters;
+    PerfStageProbe perfProbe(counters);
+    if (perf && tracePath != nullptr)
+    {
+        std::fprintf(stderr, "--perf and --trace both observe the stages, only tracing\n");
+        perf = false;
+    }
+    if (perf && !counters.open())
+    {
+        std::fprintf(stderr, "hardware counters unavailable, %s\n", counters.error);
+        perf = false;
+    }
+
+    double totalNs = 0.0;
+
+    for (const Pattern* const pattern : patterns)
+    {
+        Synth303Engine engine;
+        engine.logEvents = false;
+        pattern->settings.apply(engine);
+        if (formulaText != nullptr)
+            engine.setFormula(formulaText);
+        engine.sampleRateChanged(sampleRate);
+        engine.activate(sampleRate, blockSize);
+
+        PatternPlayer player;
+        player.reset(pattern, sampleRate);
+
+        TracedEngine traced { engine, trace };
+        if (perf)
+            engine.probe = &perfProbe;
+
+        if (tracePath != nullptr)
+        {
+            engine.probe = &trace;
+            trace.beginProcess((int)(pattern - kPatterns) + 1, pattern->name);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t done = 0; done < totalFrames; done += blockSize)
+        {
+            const uint32_t frames = std::min(blockSize, totalFrames - done);
+            if (tracePath != nullptr)
+                player.render(traced, outputs, frames);
+            else
+                player.render(engine, outputs, frames);
+            if (outPath != nullptr)
+                recording.insert(recording.end(), out[0].begin(), out[0].begin() + frames);
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        totalNs += ns;
+
+        if (bench)
+            std::printf("%-12s | %10.2f\n", pattern->name, ns / totalFrames);
+    }
+
+    if (bench)
+        std::printf("%-12s | %10.2f\n", "mean", totalNs / ((double)totalFrames * patterns.size()));
+
+    if (perf)
+    {
+        std::printf("\n");
+        perfProbe.print(stdout);
+    }
+
+    if (tracePath != nullptr && !trace.close())
+    {
+        std::fprintf(stderr, "could not write %s\n", tracePath);
+        return 1;
+    }
+
+    if (outPath != nullptr && !writeWav(outPath, recording, (uint32_t)sampleRate))
+    {
+        std::fprintf(stderr, "could not write %s\n", outPath);
+        return 1;
+    }
+
+    return 0;
+}
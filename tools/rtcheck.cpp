@@ -0,0 +1,539 @@
+// Realtime-safety check of the engine code paths the plugin calls from the audio thread.
+//
+// This executable interposes the allocator (malloc family, operator new/delete), pthread mutexes and
+// stdio/write. While a checked section runs, any call into them is a violation: it prints the section, the
+// call and a stack trace, then aborts (or counts, with --keep-going).
+//
+//   run()                PluginDSP::run: RealtimeMode begin/end around the step     nothing allowed
+//                        sequencer and Synth303Engine::run
+//   setParameterValue()  Synth303Engine::setParameter for every automatable index   nothing allowed
+//   activate()           Synth303Engine::activate and RealtimeMode::activate        may allocate and take the
+//                                                                                   shared table locks, no stdio
+//
+// Driven by the canonical patterns with parameter automation, at several block sizes and sample rates. The
+// automation switches the built-in sequencer on and off, which then plays its default pattern on a running
+// transport. RealtimeMode follows SYNTH303_REALTIME and SYNTH303_RT_CPU like the JACK standalone.
+// Linux/glibc only.
+//
+// usage: synth303-rtcheck [--seconds s] [--keep-going]
+
+#include "Workload.hpp"
+#include "RealtimeMode.hpp"
+#include "StepSequencer.hpp"
+
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <unistd.h>
+
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+void __libc_free(void*);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// checked sections
+
+enum RtPolicy {
+    kAllowAllocation = 1 << 0,
+    kAllowLocks = 1 << 1,
+};
+
+struct RtSection {
+    const char* name = nullptr;
+    unsigned policy = 0;
+    bool reporting = false; // set while a violation is printed, the report itself uses stdio
+};
+
+static thread_local RtSection rtSection;
+static bool rtKeepGoing = false;
+static unsigned long rtViolations = 0;
+
+struct ScopedRtSection {
+    const char* const previous;
+    const unsigned previousPolicy;
+
+    ScopedRtSection(const char* name, unsigned policy = 0)
+        : previous(rtSection.name), previousPolicy(rtSection.policy)
+    {
+        rtSection.name = name;
+        rtSection.policy = policy;
+    }
+
+    ~ScopedRtSection() {
+        rtSection.name = previous;
+        rtSection.policy = previousPolicy;
+    }
+};
+
+static void rtViolation(const char* call, unsigned allowedBy = 0)
+{
+    if (rtSection.name == nullptr || rtSection.reporting || (rtSection.policy & allowedBy) != 0)
+        return;
+
+    rtSection.reporting = true;
+    ++rtViolations;
+
+    char line[256];
+    const int len = std::snprintf(line, sizeof(line), "\nRT violation: %s in %s\n", call, rtSection.name);
+    ::write(STDERR_FILENO, line, std::min<int>(len, sizeof(line) - 1));
+
+    void* frames[64];
+    const int count = backtrace(frames, 64);
+    backtrace_symbols_fd(frames, count, STDERR_FILENO);
+
+    if (!rtKeepGoing)
+        std::abort();
+
+    rtSection.reporting = false;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// interposed functions, resolved once before any section is entered
+
+template <typename Fn>
+static Fn real(const char* symbol)
+{
+    return reinterpret_cast<Fn>(dlsym(RTLD_NEXT, symbol));
+}
+
+static int (*real_pthread_mutex_lock)(pthread_mutex_t*);
+static int (*real_pthread_mutex_trylock)(pthread_mutex_t*);
+static int (*real_pthread_mutex_unlock)(pthread_mutex_t*);
+static ssize_t (*real_write)(int, const void*, size_t);
+static int (*real_vfprintf)(FILE*, const char*, va_list);
+static int (*real_fputs)(const char*, FILE*);
+static int (*real_puts)(const char*);
+static int (*real_fputc)(int, FILE*);
+static int (*real_putc)(int, FILE*);
+static int (*real_putchar)(int);
+static size_t (*real_fwrite)(const void*, size_t, size_t, FILE*);
+
+static void resolveRealFunctions()
+{
+    real_pthread_mutex_lock = real<decltype(real_pthread_mutex_lock)>("pthread_mutex_lock");
+    real_pthread_mutex_trylock = real<decltype(real_pthread_mutex_trylock)>("pthread_mutex_trylock");
+    real_pthread_mutex_unlock = real<decltype(real_pthread_mutex_unlock)>("pthread_mutex_unlock");
+    real_write = real<decltype(real_write)>("write");
+    real_vfprintf = real<decltype(real_vfprintf)>("vfprintf");
+    real_fputs = real<decltype(real_fputs)>("fputs");
+    real_puts = real<decltype(real_puts)>("puts");
+    real_fputc = real<decltype(real_fputc)>("fputc");
+    real_putc = real<decltype(real_putc)>("putc");
+    real_putchar = real<decltype(real_putchar)>("putchar");
+    real_fwrite = real<decltype(real_fwrite)>("fwrite");
+
+    // backtrace() loads libgcc on first use, which allocates
+    void* warmup[1];
+    backtrace(warmup, 1);
+}
+
+extern "C" {
+
+void* malloc(size_t size)
+{
+    rtViolation("malloc", kAllowAllocation);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    rtViolation("calloc", kAllowAllocation);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    rtViolation("realloc", kAllowAllocation);
+    return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    rtViolation("aligned_alloc", kAllowAllocation);
+    return __libc_memalign(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    rtViolation("memalign", kAllowAllocation);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    rtViolation("posix_memalign", kAllowAllocation);
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr != nullptr ? 0 : ENOMEM;
+}
+
+void free(void* ptr)
+{
+    if (ptr != nullptr)
+        rtViolation("free", kAllowAllocation);
+    __libc_free(ptr);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    rtViolation("pthread_mutex_lock", kAllowLocks);
+    return real_pthread_mutex_lock(mutex);
+}
+
+int pthread_mutex_trylock(pthread_mutex_t* mutex)
+{
+    rtViolation("pthread_mutex_trylock", kAllowLocks);
+    return real_pthread_mutex_trylock(mutex);
+}
+
+int pthread_mutex_unlock(pthread_mutex_t* mutex)
+{
+    rtViolation("pthread_mutex_unlock", kAllowLocks);
+    return real_pthread_mutex_unlock(mutex);
+}
+
+ssize_t write(int fd, const void* buf, size_t count)
+{
+    rtViolation("write");
+    return real_write(fd, buf, count);
+}
+
+int vfprintf(FILE* stream, const char* format, va_list args)
+{
+    rtViolation("vfprintf");
+    return real_vfprintf(stream, format, args);
+}
+
+int fprintf(FILE* stream, const char* format, ...)
+{
+    rtViolation("fprintf");
+    va_list args;
+    va_start(args, format);
+    const int ret = real_vfprintf(stream, format, args);
+    va_end(args);
+    return ret;
+}
+
+int vprintf(const char* format, va_list args)
+{
+    rtViolation("vprintf");
+    return real_vfprintf(stdout, format, args);
+}
+
+int printf(const char* format, ...)
+{
+    rtViolation("printf");
+    va_list args;
+    va_start(args, format);
+    const int ret = real_vfprintf(stdout, format, args);
+    va_end(args);
+    return ret;
+}
+
+// _FORTIFY_SOURCE builds call these instead
+int __vfprintf_chk(FILE* stream, int, const char* format, va_list args)
+{
+    rtViolation("vfprintf");
+    return real_vfprintf(stream, format, args);
+}
+
+int __fprintf_chk(FILE* stream, int, const char* format, ...)
+{
+    rtViolation("fprintf");
+    va_list args;
+    va_start(args, format);
+    const int ret = real_vfprintf(stream, format, args);
+    va_end(args);
+    return ret;
+}
+
+int __vprintf_chk(int, const char* format, va_list args)
+{
+    rtViolation("vprintf");
+    return real_vfprintf(stdout, format, args);
+}
+
+int __printf_chk(int, const char* format, ...)
+{
+    rtViolation("printf");
+    va_list args;
+    va_start(args, format);
+    const int ret = real_vfprintf(stdout, format, args);
+    va_end(args);
+    return ret;
+}
+
+int fputs(const char* s, FILE* stream)
+{
+    rtViolation("fputs");
+    return real_fputs(s, stream);
+}
+
+int puts(const char* s)
+{
+    rtViolation("puts");
+    return real_puts(s);
+}
+
+int fputc(int c, FILE* stream)
+{
+    rtViolation("fputc");
+    return real_fputc(c, stream);
+}
+
+int putc(int c, FILE* stream)
+{
+    rtViolation("putc");
+    return real_putc(c, stream);
+}
+
+int putchar(int c)
+{
+    rtViolation("putchar");
+    return real_putchar(c);
+}
+
+size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream)
+{
+    rtViolation("fwrite");
+    return real_fwrite(ptr, size, count, stream);
+}
+
+} // extern "C"
+
+// the allocator checks above would catch these too, named separately for clearer reports
+
+void* operator new(std::size_t size)
+{
+    rtViolation("operator new", kAllowAllocation);
+    if (void* const ptr = __libc_malloc(size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    rtViolation("operator new (aligned)", kAllowAllocation);
+    if (void* const ptr = __libc_memalign((size_t)alignment, size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        rtViolation("operator delete", kAllowAllocation);
+    __libc_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    operator delete(ptr);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// driver
+
+// collects the events PatternPlayer sends during one host block, with their frame offsets
+struct HostBlock {
+    struct Event {
+        uint32_t frame;
+        uint8_t data[3];
+    };
+
+    Event events[64];
+    uint32_t count = 0;
+    uint32_t position = 0;
+
+    void midiEvent(uint8_t b0, uint8_t b1, uint8_t b2) {
+        if (count < 64)
+            events[count++] = { position, { b0, b1, b2 } };
+    }
+
+    void process(float**, uint32_t frames) {
+        position += frames;
+    }
+};
+
+// the automatable parameters with the ranges PluginDSP declares
+static const struct { uint32_t index; float min, max; } kAutomation[] = {
+    { kParamGain, -90.0f, 30.0f },
+    { kParamCutoff, 1.321f, 12.0f },
+    { kParamResonance, 0.0f, 1.0f },
+    { kParamVmod, 0.0f, 1.0f },
+    { kParamAccent, 0.0f, 1.0f },
+    { kParamDecay, -2.223f, 1.32f },
+    { kParamVcfAttack, -9.482f, -4.0f },
+    { kParamFormulaA, 0.0f, 10.0f },
+    { kParamFormulaB, 0.0f, 10.0f },
+    { kParamFormulaC, 0.0f, 10.0f },
+    { kParamFormulaD, 0.0f, 10.0f },
+    { kParamFormulaE, 0.0f, 10.0f },
+    { kParamFormulaBase, -200.0f, 200.0f },
+    { kParamFormulaVaccMul, 0.0f, 20.0f },
+    { kParamCvOutputs, 0.0f, 1.0f },
+    { kParamMorph, 0.0f, 1.0f },
+    { kParamSequencer, 0.0f, 1.0f },
+};
+
+int main(int argc, char* argv[])
+{
+    double seconds = 4.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            seconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--keep-going") == 0)
+            rtKeepGoing = true;
+        else
+        {
+            std::fprintf(stderr, "usage: synth303-rtcheck [--seconds s] [--keep-going]\n");
+            return 1;
+        }
+    }
+
+    resolveRealFunctions();
+
+    static const double kSampleRates[] = { 44100.0, 48000.0, 96000.0 };
+    static const uint32_t kBlockSizes[] = { 1, 16, 64, 256, 1024, 4096 };
+
+    uint64_t blocks = 0;
+
+    for (const double sampleRate : kSampleRates)
+    {
+        for (const uint32_t blockSize : kBlockSizes)
+        {
+            std::vector<float> out(blockSize * 4);
+            float* outputs[4] = { &out[0], &out[blockSize], &out[blockSize * 2], &out[blockSize * 3] };
+
+            for (const Pattern& pattern : kPatterns)
+            {
+                Synth303Engine engine;
+                pattern.settings.apply(engine);
+                engine.sampleRateChanged(sampleRate);
+                engine.setMorph(kFactoryPresets[1].preset, kFactoryPresets[2].preset);
+
+                // the rest of PluginDSP's audio thread state
+                StepSequencer sequencer;
+                bool sequencerOn = false;
+                RealtimeMode realtime;
+                realtime.configure();
+
+                {
+                    const ScopedRtSection section("activate()", kAllowAllocation | kAllowLocks);
+                    engine.activate(sampleRate, blockSize);
+                    realtime.activate();
+                }
+
+                PatternPlayer player;
+                player.reset(&pattern, sampleRate);
+
+                const uint64_t totalFrames = (uint64_t)(seconds * sampleRate);
+                for (uint64_t done = 0; done < totalFrames; done += blockSize, ++blocks)
+                {
+                    HostBlock host;
+                    player.render(host, outputs, blockSize);
+
+                    // some automation every few blocks, swept across each parameter's range
+                    if (blocks % 3 == 0)
+                    {
+                        const ScopedRtSection section("setParameterValue()");
+                        for (const auto& param : kAutomation)
+                        {
+                            const float phase = (float)((done / blockSize + param.index * 7) % 64) / 63.0f;
+                            const float value = param.min + phase * (param.max - param.min);
+                            if (param.index == kParamSequencer)
+                                sequencerOn = value > 0.5f;
+                            else
+                                engine.setParameter(param.index, value);
+                            engine.getParameter(param.index);
+                        }
+                    }
+
+                    SequencerTransport transport;
+                    transport.playing = true;
+                    transport.bpm = pattern.bpm;
+                    transport.frame = done;
+                    transport.beat = done * pattern.bpm / (60.0 * sampleRate);
+
+                    {
+                        const ScopedRtSection section("run()");
+                        const double start = realtime.begin();
+                        sequencer.schedule(transport, sampleRate, blockSize, sequencerOn);
+                        if (sequencerOn)
+                        {
+                            engine.run(outputs, blockSize, sequencer.events, sequencer.eventCount);
+                        }
+                        else
+                        {
+                            for (uint32_t i = 0; i < sequencer.eventCount; ++i)
+                                engine.midiEvent(sequencer.events[i].data[0], sequencer.events[i].data[1],
+                                                 sequencer.events[i].data[2]);
+                            engine.run(outputs, blockSize, host.events, host.count);
+                        }
+                        realtime.end(start, blockSize, sampleRate);
+                    }
+                }
+
+                // deactivate(), prints only with SYNTH303_REALTIME set
+                realtime.report(blockSize, sampleRate);
+            }
+        }
+    }
+
+    std::printf("synth303-rtcheck: %llu blocks over %zu patterns, %lu violation(s)\n", (unsigned long long)blocks,
+                sizeof(kPatterns) / sizeof(kPatterns[0]), rtViolations);
+    return rtViolations == 0 ? 0 : 1;
+}
@@ -0,0 +1,319 @@
+// Self checks of engine parts whose mistakes do not show up as a crash: runs every check and prints the
+// ones that fail. Exits with status 1 when any did, so it can gate a build script.
+//
+// usage: synth303-selfcheck [-v]
+
+#include "CutoffFormula.hpp"
+#include "StepSequencer.hpp"
+#include "Synth303Engine.hpp"
+#include "synth303common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static bool verbose = false;
+static int failures = 0;
+
+static void check(bool passed, const char* what)
+{
+    if (!passed)
+        ++failures;
+    if (!passed || verbose)
+        std::printf("%s  %s\n", passed ? "ok  " : "FAIL", what);
+}
+
+static bool near(float a, float b)
+{
+    return std::fabs(a - b) <= 1e-4f * std::max(1.0f, std::fabs(b));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static float evaluate(const char* text, const float uniforms[CutoffFormula::kUniformCount], float env, float vacc)
+{
+    CutoffFormula formula;
+    char error[128];
+    if (!formula.compile(text, error, sizeof(error)))
+    {
+        std::printf("      %s: %s\n", text, error);
+        return NAN;
+    }
+    return formula.evaluate(uniforms, env, vacc);
+}
+
+static void checkFormulas()
+{
+    // Vco, Vmod, A, B, C, D, E, base, VaccMul
+    const float knobs[CutoffFormula::kUniformCount] = { 12.0f, 1.0f, 1.633001f, 0.626f, 0.324f, 0.191f, 4.462f,
+                                                        -119.205f, 2.0f };
+    const float env = 0.6f, vacc = 0.3f;
+    check(near(evaluate(CutoffFormula::kBuiltinText, knobs, env, vacc),
+               vcf_env_freq(env, knobs[0], knobs[1], vacc, knobs[2], knobs[3], knobs[4], knobs[5], knobs[6],
+                            knobs[7], knobs[8])),
+          "formula: built-in text matches vcf_env_freq");
+
+    // a literal after a per-block result must not reuse that result's slot, which also starts out as 0
+    float uniforms[CutoffFormula::kUniformCount] = {};
+    uniforms[CutoffFormula::kVco] = 1.0f;
+    uniforms[CutoffFormula::kA] = 2.0f;
+    check(near(evaluate("A * Vco * env + max(env, 0)", uniforms, -1.0f, 0.0f), -2.0f),
+          "formula: literal 0 after a per-block product");
+    check(near(evaluate("max(env, 0) + A * Vco * env", uniforms, -1.0f, 0.0f), -2.0f),
+          "formula: literal 0 before a per-block product");
+    check(near(evaluate("A * Vco + 2 * 2 + 2", uniforms, 0.0f, 0.0f), 8.0f),
+          "formula: repeated literals share a slot");
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+struct SequencedEvent {
+    uint64_t frame; // since the transport started
+    uint8_t status;
+    uint8_t note;
+
+    bool operator==(const SequencedEvent& other) const {
+        return frame == other.frame && status == other.status && note == other.note;
+    }
+};
+
+struct SequencerRun {
+    const char* pattern = SequencerPattern::kDefaultText;
+    double sampleRate = 44100.0;
+    double bpm = 130.0;
+    uint32_t block = 256;
+    uint64_t frames = 4 * 44100;
+    double ticksPerBeat = 0.0; // quantize the host position to ticks like JACK BBT, 0 for exact
+    uint64_t loopFrames = 0;   // the host jumps back to the start every loopFrames, 0 for never
+
+    std::vector<SequencedEvent> play() const {
+        StepSequencer sequencer;
+        SequencerPattern parsed;
+        parsed.parse(pattern);
+        sequencer.setPattern(parsed);
+
+        std::vector<SequencedEvent> events;
+        SequencerTransport transport;
+        transport.playing = true;
+        transport.bpm = bpm;
+        for (uint64_t done = 0; done < frames; done += block)
+        {
+            transport.frame = loopFrames != 0 ? done % loopFrames : done;
+            transport.beat = transport.frame * bpm / (60.0 * sampleRate);
+            if (ticksPerBeat != 0.0)
+                transport.beat = std::floor(transport.beat * ticksPerBeat) / ticksPerBeat;
+
+            sequencer.schedule(transport, sampleRate, block, true);
+            for (uint32_t i = 0; i < sequencer.eventCount; ++i)
+            {
+                const StepSequencer::Event& event = sequencer.events[i];
+                if (done + event.frame < frames)
+                    events.push_back({ done + event.frame, event.data[0], event.data[1] });
+            }
+        }
+        return events;
+    }
+};
+
+static void checkSequencer()
+{
+    // every step boundary on the first frame at or after it, from one clock whatever the blocks
+    SequencerRun run;
+    run.block = 1;
+    const std::vector<SequencedEvent> reference = run.play();
+    check(!reference.empty() && reference[0] == SequencedEvent { 0, 0x90, 36 }, "sequencer: step 0 on frame 0");
+
+    const double framesPerStep = 44100.0 * 60.0 / 130.0 / 4.0;
+    bool onBoundaries = true;
+    for (const SequencedEvent& event : reference)
+    {
+        const double halfSteps = event.frame / (framesPerStep / 2.0);
+        onBoundaries &= std::ceil(halfSteps - 1e-9) * framesPerStep / 2.0 > event.frame - 1.0;
+    }
+    check(onBoundaries, "sequencer: events within a frame of their boundary");
+
+    bool sameEvents = true;
+    for (uint32_t block : { 7u, 64u, 256u, 1000u, 4096u })
+    {
+        run.block = block;
+        sameEvents &= run.play() == reference;
+    }
+    check(sameEvents, "sequencer: identical events for block sizes 1 to 4096");
+
+    // whole ticks at 1920 per beat are about 11 frames apart here; the clock must not resync on them
+    run.block = 256;
+    run.ticksPerBeat = 1920.0;
+    check(run.play() == reference, "sequencer: host position quantized to ticks");
+    run.ticksPerBeat = 0.0;
+
+    // looping back from the first half of the last step of bar two, with its note still held, plays the
+    // same events again
+    run.loopFrames = (uint64_t)(31.25 * framesPerStep / 256) * 256;
+    run.frames = 2 * run.loopFrames;
+    const std::vector<SequencedEvent> looped = run.play();
+    std::vector<SequencedEvent> firstPass, secondPass;
+    for (const SequencedEvent& event : looped)
+    {
+        if (event.frame < run.loopFrames)
+            firstPass.push_back(event);
+        else if (event.status == 0x90 || !secondPass.empty())
+            secondPass.push_back({ event.frame - run.loopFrames, event.status, event.note });
+    }
+    bool releasedAtLoop = false;
+    for (const SequencedEvent& event : looped)
+        releasedAtLoop |= event.frame == run.loopFrames && event.status == 0x80;
+    firstPass.resize(std::min(firstPass.size(), secondPass.size()));
+    secondPass.resize(firstPass.size());
+    check(!firstPass.empty() && firstPass == secondPass, "sequencer: a loop replays the pattern from its start");
+    check(releasedAtLoop, "sequencer: the held note ends at the loop point");
+
+    // slide: the next note is on before the slid one is off, at the same frame, and no gate end in between
+    const uint64_t step = (uint64_t)std::ceil(framesPerStep);
+    SequencerRun slide;
+    slide.pattern = "36s 40 - -";
+    slide.frames = (uint64_t)(4 * framesPerStep); // up to the next bar
+    const std::vector<SequencedEvent> slid = slide.play();
+    const std::vector<SequencedEvent> slideExpected = {
+        { 0, 0x90, 36 }, { step, 0x90, 40 }, { step, 0x80, 36 }, { (uint64_t)std::ceil(1.5 * framesPerStep), 0x80, 40 },
+    };
+    check(slid == slideExpected, "sequencer: slide order, on 40 then off 36 on the same frame");
+
+    // tie: the note holds through the tied step and ends at its gate
+    SequencerRun tie;
+    tie.pattern = "36 t - -";
+    tie.frames = slide.frames;
+    const std::vector<SequencedEvent> tied = tie.play();
+    const std::vector<SequencedEvent> tieExpected = {
+        { 0, 0x90, 36 }, { (uint64_t)std::ceil(1.5 * framesPerStep), 0x80, 36 },
+    };
+    check(tied == tieExpected, "sequencer: tie holds the note to the gate end of the tied step");
+
+    // stopping releases the held note on the first frame
+    StepSequencer sequencer;
+    SequencerTransport transport;
+    transport.playing = true;
+    sequencer.schedule(transport, 44100.0, 64, true);
+    transport.playing = false;
+    sequencer.schedule(transport, 44100.0, 64, true);
+    check(sequencer.eventCount == 1 && sequencer.events[0].frame == 0 && sequencer.events[0].data[0] == 0x80,
+          "sequencer: stop releases the held note");
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// engine
+
+// loudest output sample over `blocks` blocks of 256, the events go into the first one
+static float renderPeak(Synth303Engine& engine, int blocks, const StepSequencer::Event* events, uint32_t count)
+{
+    float audio[256], gate[256], pitch[256], cutoff[256];
+    float* outputs[4] = { audio, gate, pitch, cutoff };
+    float peak = 0.0f;
+    for (int b = 0; b < blocks; ++b)
+    {
+        engine.run(outputs, 256, events, b == 0 ? count : 0);
+        for (float x : audio)
+            peak = std::max(peak, std::fabs(x));
+    }
+    return peak;
+}
+
+static void checkEngine()
+{
+    Synth303Engine engine;
+    engine.logEvents = false;
+    engine.activate(48000.0, 256);
+
+    const StepSequencer::Event on[] = { { 0, { 0x90, 36, 127 } } };
+    const bool sounding = renderPeak(engine, 20, on, 1) > 0.0f;
+    engine.activate(48000.0, 256);
+    check(sounding && renderPeak(engine, 20, nullptr, 0) == 0.0f, "engine: activate() ends a held note");
+    check(engine.nextGateOff == -1 && !engine.gate, "engine: activate() clears the gate state");
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+// --------------------------------------------------------------------------------------------------------------------
+
+// the largest difference between AcidFilterStereo's lanes and an AcidFilter per channel, on two saws
+static float stereoLadderError(float resonance)
+{
+    const double sampleRate = 48000.0;
+    const int block = 256;
+    AcidFilter monoL, monoR;
+    monoL.prepare(sampleRate);
+    monoR.prepare(sampleRate);
+    AcidFilterStereo stereo;
+    stereo.prepare(sampleRate);
+
+    std::vector<float> freq(block), inL(block * 4), inR(block * 4), outL(block * 4), outR(block * 4);
+    std::vector<float> monoOutL(block * 4), monoOutR(block * 4);
+    float error = 0.0f;
+    for (int done = 0; done < 2 * 48000; done += block)
+    {
+        for (int i = 0; i < block * 4; ++i)
+        {
+            const double t = (done * 4.0 + i) / (4.0 * sampleRate);
+            inL[i] = 2.0f * (float)std::fmod(t * 110.0, 1.0) - 1.0f;
+            inR[i] = 2.0f * (float)std::fmod(t * 82.4, 1.0) - 1.0f;
+        }
+        for (int i = 0; i < block; ++i)
+        {
+            freq[i] = 100.0f + 4000.0f * (1.0f - (float)std::cos((done + i) * 2.0 * M_PI / sampleRate));
+            monoL.calcCoeffs(freq[i], resonance);
+            monoL.processOversampled(&inL[i * 4], &monoOutL[i * 4]);
+            monoR.calcCoeffs(freq[i], resonance);
+            monoR.processOversampled(&inR[i * 4], &monoOutR[i * 4]);
+        }
+        stereo.process(freq.data(), resonance, inL.data(), inR.data(), outL.data(), outR.data(), block);
+        for (int i = 0; i < block * 4; ++i)
+            error = std::max(error, std::max(std::fabs(outL[i] - monoOutL[i]), std::fabs(outR[i] - monoOutR[i])));
+    }
+    return error;
+}
+
+static void checkStereoLadder()
+{
+#if SYNTH303_STEREO_SSE
+    int worstUlp = 0;
+    for (int i = -200000; i <= 200000; ++i)
+    {
+        const float x = i * 5e-5f;
+        const float lanes = _mm_cvtss_f32(AcidFilterStereo::tanhLanes(_mm_set_ss(x)));
+        const float reference = std::tanh(x);
+        int32_t a, b;
+        std::memcpy(&a, &lanes, sizeof(a));
+        std::memcpy(&b, &reference, sizeof(b));
+        worstUlp = std::max(worstUlp, std::abs(a - b));
+    }
+    check(worstUlp <= 4, "stereo ladder: tanhLanes() within 4 ulp of std::tanh on [-10, 10]");
+#endif
+
+    // only the saturator may differ from the mono ladder, by what rounding differences between the
+    // instruction sets already cause there
+    check(stereoLadderError(0.5f) <= 1e-5f, "stereo ladder: lanes within 1e-5 of the mono ladder at resonance 0.5");
+    check(stereoLadderError(1.0f) <= 1e-5f, "stereo ladder: lanes within 1e-5 of the mono ladder at resonance 1");
+}
+
+int main(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-v") == 0)
+            verbose = true;
+        else
+        {
+            std::fprintf(stderr, "usage: synth303-selfcheck [-v]\n");
+            return 1;
+        }
+    }
+
+    checkFormulas();
+    checkSequencer();
+    checkEngine();
+    checkStereoLadder();
+
+    std::printf("synth303-selfcheck: %d failure(s)\n", failures);
+    return failures == 0 ? 0 : 1;
+}
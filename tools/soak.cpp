@@ -0,0 +1,521 @@
+// Worst-case execution time soak test.
+//
+// Plays randomized MIDI (patterns, slide chains, accent runs, gate-off storms, silence) and automates every
+// knob and formula coefficient across its full range, timing each host block the way a host would call run().
+// The automation goes through setParameter() like a host's, so the glides and the control-rate block
+// splitting they cause are timed too. Reports p50/p99/p99.9/max per buffer size, separately for the blocks
+// that glided, and writes the inputs of the slowest block to a dump file.
+//
+// usage: synth303-soak [--seconds s] [--rate hz] [--blocks 32,64,...] [--seed n] [--dump file] [--ftz]
+//        synth303-soak --replay index --block n [--seed n] [--rate hz] [--repeat r]
+//
+// --seconds is rendered audio per buffer size, not wall time. The run is deterministic for a given seed,
+// --replay renders up to the dumped block index and then times that block again `repeat` times.
+
+#include "Workload.hpp"
+#include "LatencyHistogram.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#if defined(__SSE__)
+# include <xmmintrin.h>
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+// automation
+
+struct AutomatedParam {
+    const char* name;
+    uint32_t index;
+    float min, max;
+};
+
+// the parameter ranges PluginDSP declares
+static const AutomatedParam kAutomated[] = {
+    { "fVco", kParamCutoff, 1.321f, 12.0f },
+    { "fRes", kParamResonance, 0.0f, 1.0f },
+    { "fVmod", kParamVmod, 0.0f, 1.0f },
+    { "fVacc_amt", kParamAccent, 0.0f, 1.0f },
+    { "decTime", kParamDecay, -2.223f, 1.32f },
+    { "atkTime", kParamVcfAttack, -9.482f, -4.0f },
+    { "A", kParamFormulaA, 0.0f, 10.0f },
+    { "B", kParamFormulaB, 0.0f, 10.0f },
+    { "C", kParamFormulaC, 0.0f, 10.0f },
+    { "D", kParamFormulaD, 0.0f, 10.0f },
+    { "E", kParamFormulaE, 0.0f, 10.0f },
+    { "base", kParamFormulaBase, -200.0f, 200.0f },
+    { "VaccMul", kParamFormulaVaccMul, 0.0f, 20.0f },
+};
+
+static constexpr int kAutomatedCount = sizeof(kAutomated) / sizeof(kAutomated[0]);
+
+// each parameter ramps to a random target over a random time, sometimes jumping there at once
+struct Ramp {
+    float value;
+    float step;
+    uint32_t blocksLeft;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// MIDI
+
+enum Scene { kScenePattern, kSceneSlides, kSceneAccents, kSceneGateOffStorm, kSceneSilence, kSceneCount };
+
+static const char* const kSceneNames[kSceneCount] = { "pattern", "slides", "accents", "gate-off storm", "silence" };
+
+struct SoakEvent {
+    uint32_t frame;
+    uint8_t data[3];
+};
+
+struct SoakGenerator {
+    std::mt19937_64 rng;
+    double sampleRate;
+    uint32_t blockSize;
+
+    Ramp ramps[kAutomatedCount];
+    float gain = 0.0f;
+    uint64_t pauseBlocksLeft = 0; // no automation at all, so the glides settle
+
+    Scene scene = kScenePattern;
+    uint64_t sceneFramesLeft = 0;
+    double nextNoteFrame = 0.0; // relative to the current block
+    double framesPerStep = 0.0;
+    int heldNote = -1;
+
+    std::vector<SoakEvent> events;
+
+    SoakGenerator(uint64_t seed, double sr, uint32_t bs)
+        : rng(seed), sampleRate(sr), blockSize(bs)
+    {
+        events.reserve(bs * 4 + 64);
+        for (int p = 0; p < kAutomatedCount; ++p)
+            ramps[p] = { uniform(kAutomated[p].min, kAutomated[p].max), 0.0f, 0 };
+    }
+
+    // the starting values, the first block glides to them
+    void prime(Synth303Engine& engine) const {
+        for (int p = 0; p < kAutomatedCount; ++p)
+            engine.setParameter(kAutomated[p].index, ramps[p].value);
+    }
+
+    float uniform(float a, float b) {
+        return std::uniform_real_distribution<float>(a, b)(rng);
+    }
+
+    uint32_t below(uint32_t n) {
+        return (uint32_t)(rng() % n);
+    }
+
+    bool chance(double p) {
+        return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < p;
+    }
+
+    void noteOn(uint32_t frame, int note, bool accent) {
+        events.push_back({ frame, { 0x90, (uint8_t)note, (uint8_t)(accent ? 127 : 1 + below(100)) } });
+    }
+
+    void noteOff(uint32_t frame, int note) {
+        events.push_back({ frame, { 0x80, (uint8_t)note, 0 } });
+    }
+
+    // like a host, only the values that changed are sent; about every 4s it pauses for 0.5s to 4s
+    void automate(Synth303Engine& engine) {
+        if (pauseBlocksLeft == 0 && chance(0.25 * blockSize / sampleRate))
+            pauseBlocksLeft = (uint64_t)(sampleRate * uniform(0.5f, 4.0f) / blockSize);
+        if (pauseBlocksLeft != 0)
+        {
+            --pauseBlocksLeft;
+            return;
+        }
+
+        for (int p = 0; p < kAutomatedCount; ++p)
+        {
+            Ramp& r = ramps[p];
+            const AutomatedParam& param = kAutomated[p];
+            const float previous = r.value;
+
+            if (r.blocksLeft == 0)
+            {
+                const float target = uniform(param.min, param.max);
+                if (chance(0.1))
+                {
+                    r.value = target;
+                    r.step = 0.0f;
+                    r.blocksLeft = 1 + below(64);
+                }
+                else
+                {
+                    // 1ms to 4s
+                    const uint32_t frames = (uint32_t)(sampleRate * uniform(0.001f, 4.0f));
+                    r.blocksLeft = std::max(1u, frames / blockSize);
+                    r.step = (target - r.value) / r.blocksLeft;
+                }
+            }
+
+            r.value = std::clamp(r.value + r.step, param.min, param.max);
+            --r.blocksLeft;
+            if (r.value != previous)
+                engine.setParameter(param.index, r.value);
+        }
+
+        if (chance(0.001))
+            engine.setParameter(kParamGain, gain = uniform(-90.0f, 30.0f));
+    }
+
+    void newScene() {
+        scene = (Scene)below(kSceneCount);
+        sceneFramesLeft = (uint64_t)(sampleRate * uniform(0.5f, 4.0f));
+        framesPerStep = sampleRate * 60.0 / uniform(80.0f, 200.0f) / 4.0;
+        nextNoteFrame = 0.0;
+    }
+
+    // fills `events` for the next block, sorted by frame
+    void midi() {
+        events.clear();
+
+        if (sceneFramesLeft < blockSize)
+            newScene();
+        sceneFramesLeft -= std::min<uint64_t>(sceneFramesLeft, blockSize);
+
+        switch (scene)
+        {
+        case kScenePattern:
+        case kSceneAccents:
+            while (nextNoteFrame < blockSize)
+            {
+                const uint32_t frame = (uint32_t)nextNoteFrame;
+                const int note = 24 + below(48);
+                const bool accent = scene == kSceneAccents || chance(0.3);
+                if (heldNote >= 0 && !chance(0.3))
+                {
+                    noteOff(frame, heldNote);
+                    heldNote = -1;
+                }
+                // note-on while a note is held slides into it
+                noteOn(frame, note, accent);
+                if (heldNote >= 0 && heldNote != note)
+                    noteOff(frame, heldNote);
+                heldNote = note;
+                nextNoteFrame += framesPerStep;
+            }
+            break;
+
+        case kSceneSlides:
+            while (nextNoteFrame < blockSize)
+            {
+                const uint32_t frame = (uint32_t)nextNoteFrame;
+                const int note = below(128);
+                noteOn(frame, note, chance(0.5));
+                if (heldNote >= 0 && heldNote != note)
+                    noteOff(frame, heldNote);
+                heldNote = note;
+                nextNoteFrame += sampleRate * uniform(0.0005f, 0.05f);
+            }
+            break;
+
+        case kSceneGateOffStorm:
+            for (uint32_t n = below(33); n > 0; --n)
+            {
+                const uint32_t frame = below(blockSize);
+                if (chance(0.2))
+                    noteOn(frame, below(128), chance(0.5));
+                noteOff(frame, chance(0.5) && heldNote >= 0 ? heldNote : (int)below(128));
+            }
+            std::stable_sort(events.begin(), events.end(),
+                             [](const SoakEvent& a, const SoakEvent& b) { return a.frame < b.frame; });
+            heldNote = -1;
+            break;
+
+        case kSceneSilence:
+            if (heldNote >= 0)
+            {
+                noteOff(0, heldNote);
+                heldNote = -1;
+            }
+            break;
+
+        case kSceneCount:
+            break;
+        }
+
+        nextNoteFrame = std::max(0.0, nextNoteFrame - blockSize);
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+// what run() does: render up to each event, then apply it
+static void runBlock(Synth303Engine& engine, float** outputs, const std::vector<SoakEvent>& events, uint32_t frames)
+{
+    engine.run(outputs, frames, events.data(), (uint32_t)events.size());
+}
+
+struct WorstBlock {
+    uint64_t index = 0;
+    uint64_t ns = 0;
+    uint32_t clamps = 0;
+    bool denormal = false;
+    bool glide = false;
+    Scene scene = kScenePattern;
+    float params[kAutomatedCount] = {};
+    float gain = 0.0f;
+    std::vector<SoakEvent> events;
+};
+
+static bool writeDump(const char* path, uint64_t seed, double sampleRate, uint32_t blockSize, const WorstBlock& worst)
+{
+    std::FILE* const f = std::fopen(path, "w");
+    if (f == nullptr)
+        return false;
+
+    std::fprintf(f, "# synth303-soak worst block, replay with:\n");
+    std::fprintf(f, "#   synth303-soak --replay %llu --block %u --seed %llu --rate %.0f\n",
+                 (unsigned long long)worst.index, blockSize, (unsigned long long)seed, sampleRate);
+    std::fprintf(f, "seed %llu\nrate %.0f\nblock %u\nindex %llu\n",
+                 (unsigned long long)seed, sampleRate, blockSize, (unsigned long long)worst.index);
+    std::fprintf(f, "time_ns %llu\nbudget_ns %.0f\n", (unsigned long long)worst.ns, 1e9 * blockSize / sampleRate);
+    std::fprintf(f, "scene %s\nnyquist_clamps %u\ndenormal_ladder %d\nglide %d\n",
+                 kSceneNames[worst.scene], worst.clamps, worst.denormal ? 1 : 0, worst.glide ? 1 : 0);
+    std::fprintf(f, "param gain %.6f\n", worst.gain);
+    for (int p = 0; p < kAutomatedCount; ++p)
+        std::fprintf(f, "param %s %.6f\n", kAutomated[p].name, worst.params[p]);
+    std::fprintf(f, "# frame status note velocity\n");
+    for (const SoakEvent& ev : worst.events)
+        std::fprintf(f, "event %u %02x %u %u\n", ev.frame, ev.data[0], ev.data[1], ev.data[2]);
+
+    return std::fclose(f) == 0;
+}
+
+static void enableFlushToZero()
+{
+#if defined(__SSE__)
+    _mm_setcsr(_mm_getcsr() | 0x8040); // FTZ | DAZ
+#else
+    std::fprintf(stderr, "--ftz is only implemented for SSE targets\n");
+#endif
+}
+
+static bool flushToZeroEnabled()
+{
+#if defined(__SSE__)
+    return (_mm_getcsr() & 0x8040) == 0x8040;
+#else
+    return false;
+#endif
+}
+
+static uint64_t elapsedNs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    double seconds = 600.0;
+    double sampleRate = 48000.0;
+    uint64_t seed = 303;
+    const char* dumpPath = "synth303-soak-worst.txt";
+    std::vector<uint32_t> blockSizes = { 32, 64, 128, 256, 512, 1024 };
+    long long replayIndex = -1;
+    uint32_t repeat = 1000;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--seconds") == 0 && hasValue)
+            seconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--rate") == 0 && hasValue)
+            sampleRate = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--dump") == 0 && hasValue)
+            dumpPath = argv[++i];
+        else if ((std::strcmp(argv[i], "--blocks") == 0 || std::strcmp(argv[i], "--block") == 0) && hasValue)
+        {
+            blockSizes.clear();
+            for (char* s = argv[++i]; *s != '\0';)
+            {
+                blockSizes.push_back((uint32_t)std::strtoul(s, &s, 10));
+                if (*s == ',')
+                    ++s;
+                else if (*s != '\0')
+                    break;
+            }
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0 && hasValue)
+            replayIndex = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--repeat") == 0 && hasValue)
+            repeat = (uint32_t)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--ftz") == 0)
+            enableFlushToZero();
+        else
+        {
+            std::fprintf(stderr, "usage: synth303-soak [--seconds s] [--rate hz] [--blocks 32,64,...] [--seed n] "
+                                 "[--dump file] [--ftz]\n"
+                                 "       synth303-soak --replay index --block n [--seed n] [--rate hz] [--repeat r]\n");
+            return 1;
+        }
+    }
+
+    if (blockSizes.empty() || std::find(blockSizes.begin(), blockSizes.end(), 0u) != blockSizes.end())
+    {
+        std::fprintf(stderr, "invalid block size list\n");
+        return 1;
+    }
+
+    if (replayIndex >= 0)
+    {
+        const uint32_t blockSize = blockSizes.front();
+        std::vector<float> out(blockSize * 4);
+        float* outputs[4] = { &out[0], &out[blockSize], &out[blockSize * 2], &out[blockSize * 3] };
+
+        Synth303Engine engine;
+        engine.logEvents = false;
+        engine.sampleRateChanged(sampleRate);
+        SoakGenerator gen(seed, sampleRate, blockSize);
+        gen.prime(engine);
+        engine.activate(sampleRate, blockSize);
+
+        for (long long b = 0; b < replayIndex; ++b)
+        {
+            gen.automate(engine);
+            gen.midi();
+            runBlock(engine, outputs, gen.events, blockSize);
+        }
+        gen.automate(engine);
+        gen.midi();
+
+        // time the block from the same starting state every repetition is not possible without copying the
+        // engine, so the first run is the exact replay and the rest show how the state evolves from there
+        LatencyHistogram histogram;
+        for (uint32_t r = 0; r < std::max(repeat, 1u); ++r)
+        {
+            const uint64_t controlBefore = engine.stats.controlBlocks;
+            const auto start = std::chrono::steady_clock::now();
+            runBlock(engine, outputs, gen.events, blockSize);
+            const uint64_t ns = elapsedNs(start, std::chrono::steady_clock::now());
+            if (r == 0)
+                std::printf("block %lld: %llu ns, %u clamps, denormal ladder %d, glide %d, scene %s, %zu events\n",
+                            replayIndex, (unsigned long long)ns, engine.stats.lastBlockClamps,
+                            engine.filter.hasDenormalState() ? 1 : 0,
+                            engine.stats.controlBlocks != controlBefore ? 1 : 0, kSceneNames[gen.scene],
+                            gen.events.size());
+            histogram.record(ns);
+        }
+        std::printf("repeated %u times: p50 %llu ns, max %llu ns\n", std::max(repeat, 1u),
+                    (unsigned long long)histogram.percentile(50.0), (unsigned long long)histogram.max);
+        return 0;
+    }
+
+    std::printf("synth303maker soak, %.0fs of audio per buffer size @ %.0fHz, seed %llu%s\n\n", seconds, sampleRate,
+                (unsigned long long)seed, flushToZeroEnabled() ? ", FTZ/DAZ" : "");
+    std::printf("%6s | %10s | %9s %9s %9s %9s | %6s | %10s %9s | %10s %9s | %10s %9s %9s\n", "block", "blocks",
+                "p50 us", "p99 us", "p99.9 us", "max us", "max %", "clamped", "max us", "denormal", "max us", "glide",
+                "p99 us", "max us");
+
+    WorstBlock worstOverall;
+    uint32_t worstBlockSize = 0;
+    double worstRatio = 0.0;
+
+    for (const uint32_t blockSize : blockSizes)
+    {
+        std::vector<float> out(blockSize * 4);
+        float* outputs[4] = { &out[0], &out[blockSize], &out[blockSize * 2], &out[blockSize * 3] };
+
+        Synth303Engine engine;
+        engine.logEvents = false;
+        engine.sampleRateChanged(sampleRate);
+        SoakGenerator gen(seed, sampleRate, blockSize);
+        gen.prime(engine);
+        engine.activate(sampleRate, blockSize);
+
+        LatencyHistogram histogram;
+        LatencyHistogram glideHistogram; // the blocks cut to control rate by a glide
+        uint64_t clampedBlocks = 0, denormalBlocks = 0, clampedMax = 0, denormalMax = 0;
+
+        WorstBlock worst;
+        worst.events.reserve(gen.events.capacity());
+
+        const uint64_t totalBlocks = (uint64_t)(seconds * sampleRate / blockSize);
+        for (uint64_t b = 0; b < totalBlocks; ++b)
+        {
+            gen.automate(engine);
+            gen.midi();
+
+            const uint64_t clampsBefore = engine.stats.nyquistClamps;
+            const uint64_t denormalsBefore = engine.stats.denormalBlocks;
+            const uint64_t controlBefore = engine.stats.controlBlocks;
+
+            const auto start = std::chrono::steady_clock::now();
+            runBlock(engine, outputs, gen.events, blockSize);
+            const uint64_t ns = elapsedNs(start, std::chrono::steady_clock::now());
+
+            histogram.record(ns);
+
+            const uint32_t clamps = (uint32_t)(engine.stats.nyquistClamps - clampsBefore);
+            const bool denormal = engine.stats.denormalBlocks != denormalsBefore;
+            const bool glide = engine.stats.controlBlocks != controlBefore;
+            if (clamps != 0)
+            {
+                ++clampedBlocks;
+                clampedMax = std::max(clampedMax, ns);
+            }
+            if (denormal)
+            {
+                ++denormalBlocks;
+                denormalMax = std::max(denormalMax, ns);
+            }
+            if (glide)
+                glideHistogram.record(ns);
+
+            if (ns > worst.ns)
+            {
+                worst.index = b;
+                worst.ns = ns;
+                worst.clamps = clamps;
+                worst.denormal = denormal;
+                worst.glide = glide;
+                worst.scene = gen.scene;
+                worst.gain = engine.fGainDB;
+                for (int p = 0; p < kAutomatedCount; ++p)
+                    worst.params[p] = gen.ramps[p].value;
+                worst.events = gen.events;
+            }
+        }
+
+        const double budgetNs = 1e9 * blockSize / sampleRate;
+        std::printf("%6u | %10llu | %9.2f %9.2f %9.2f %9.2f | %5.1f%% | %10llu %9.2f | %10llu %9.2f | %10llu %9.2f %9.2f\n",
+                    blockSize, (unsigned long long)histogram.count, histogram.percentile(50.0) / 1e3,
+                    histogram.percentile(99.0) / 1e3, histogram.percentile(99.9) / 1e3, histogram.max / 1e3,
+                    100.0 * histogram.max / budgetNs, (unsigned long long)clampedBlocks, clampedMax / 1e3,
+                    (unsigned long long)denormalBlocks, denormalMax / 1e3, (unsigned long long)glideHistogram.count,
+                    glideHistogram.percentile(99.0) / 1e3, glideHistogram.max / 1e3);
+
+        // the dump keeps the block that used most of its own budget, so sizes compare fairly
+        if (worst.ns / budgetNs > worstRatio)
+        {
+            worstRatio = worst.ns / budgetNs;
+            worstBlockSize = blockSize;
+            worstOverall = worst;
+        }
+    }
+
+    if (worstBlockSize != 0)
+    {
+        if (!writeDump(dumpPath, seed, sampleRate, worstBlockSize, worstOverall))
+        {
+            std::fprintf(stderr, "could not write %s\n", dumpPath);
+            return 1;
+        }
+        std::printf("\nworst block: #%llu at %u frames, %.1f%% of its budget, written to %s\n",
+                    (unsigned long long)worstOverall.index, worstBlockSize, 100.0 * worstRatio, dumpPath);
+    }
+
+    return 0;
+}
@@ -0,0 +1,313 @@
+// Streaming render server: timestamped events in on stdin, interleaved PCM out on stdout in fixed chunks.
+//
+// usage: synth303-stream [--rate hz] [--chunk frames] [--format f32|s16] [--channels 1|4] [--binary] [--tail s]
+//
+// The engine is created and activated once; after that nothing is allocated, so sessions can run for as long as
+// the input does. Audio is rendered up to each event's timestamp as the event arrives and written out in whole
+// chunks, the last one padded when the stream ends.
+//
+// Text input, one event per line, frames are absolute sample positions and must not go backwards:
+//
+//   <frame> on <note> <velocity>       note on, a note on while another is held slides
+//   <frame> off <note>
+//   <frame> midi <b0> <b1> <b2>        raw MIDI bytes, 0x prefix for hex
+//   <frame> param <index> <value>      parameter index as in Synth303Parameters.hpp
+//   <frame> sync                       render and flush all whole chunks up to frame
+//   <frame> end                        render up to frame and stop
+//   # comment
+//
+// Binary input (--binary), little endian records of 16 bytes:
+//
+//   uint64 frame, uint8 type (0 midi, 1 param, 2 sync, 3 end), uint8 data[3], float32 value
+//
+// for param records data[0] is the index. At end of input the output runs on for --tail seconds (default 1).
+
+#include "Synth303Engine.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+enum StreamEventType : uint8_t { kStreamMidi, kStreamParam, kStreamSync, kStreamEnd, kStreamInvalid };
+
+struct StreamEvent {
+    uint64_t frame;
+    StreamEventType type;
+    uint8_t data[3];
+    float value;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+struct StreamRenderer {
+    Synth303Engine engine;
+
+    uint32_t chunkFrames;
+    int channels;
+    bool int16;
+
+    std::vector<float> planar;     // 4 x chunkFrames
+    std::vector<unsigned char> pcm; // one interleaved chunk
+    float* outputs[4];
+
+    uint64_t position = 0; // frames rendered so far
+    uint32_t fill = 0;     // frames of the current chunk already rendered
+    bool failed = false;
+
+    StreamRenderer(double sampleRate, uint32_t chunk, int channelCount, bool s16)
+        : chunkFrames(chunk), channels(channelCount), int16(s16)
+    {
+        planar.resize(chunkFrames * 4);
+        pcm.resize(chunkFrames * channels * (int16 ? 2 : 4));
+        for (int k = 0; k < 4; ++k)
+            outputs[k] = planar.data() + k * chunkFrames;
+
+        engine.cvOutputs = channels > 1;
+        engine.sampleRateChanged(sampleRate);
+        engine.activate(sampleRate, chunkFrames);
+    }
+
+    void writeChunk() {
+        if (int16)
+        {
+            int16_t* const out = reinterpret_cast<int16_t*>(pcm.data());
+            for (uint32_t i = 0; i < chunkFrames; ++i)
+                for (int c = 0; c < channels; ++c)
+                    out[i * channels + c] = (int16_t)std::lrint(std::fmax(-1.0f, std::fmin(1.0f, outputs[c][i])) * 32767.0f);
+        }
+        else
+        {
+            float* const out = reinterpret_cast<float*>(pcm.data());
+            for (uint32_t i = 0; i < chunkFrames; ++i)
+                for (int c = 0; c < channels; ++c)
+                    out[i * channels + c] = outputs[c][i];
+        }
+
+        if (std::fwrite(pcm.data(), 1, pcm.size(), stdout) != pcm.size())
+            failed = true;
+        fill = 0;
+    }
+
+    // renders up to `frame`, writing every chunk that fills up
+    void renderTo(uint64_t frame) {
+        while (position < frame && !failed)
+        {
+            const uint32_t n = (uint32_t)std::min<uint64_t>(chunkFrames - fill, frame - position);
+            float* blockOutputs[4] = { outputs[0] + fill, outputs[1] + fill, outputs[2] + fill, outputs[3] + fill };
+            engine.process(blockOutputs, n);
+            fill += n;
+            position += n;
+            if (fill == chunkFrames)
+                writeChunk();
+        }
+    }
+
+    // renders the rest of the current chunk, if one is started
+    void finishChunk() {
+        if (fill != 0)
+            renderTo(position + (chunkFrames - fill));
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static bool parseText(char* line, StreamEvent& ev)
+{
+    char* s = line;
+    while (*s == ' ' || *s == '\t')
+        ++s;
+    if (*s == '#' || *s == '\n' || *s == '\r' || *s == '\0')
+        return false;
+
+    char* end;
+    ev.frame = std::strtoull(s, &end, 10);
+    if (end == s)
+        return ev.type = kStreamInvalid, true;
+
+    char command[16] = {};
+    int consumed = 0;
+    if (std::sscanf(end, " %15s%n", command, &consumed) != 1)
+        return ev.type = kStreamInvalid, true;
+    s = end + consumed;
+
+    long a = 0, b = 0, c = 0;
+    ev.type = kStreamInvalid;
+    std::memset(ev.data, 0, sizeof(ev.data));
+    ev.value = 0.0f;
+
+    if (std::strcmp(command, "on") == 0)
+    {
+        a = std::strtol(s, &s, 0);
+        b = std::strtol(s, &s, 0);
+        ev.type = kStreamMidi;
+        ev.data[0] = 0x90; ev.data[1] = (uint8_t)a; ev.data[2] = (uint8_t)b;
+    }
+    else if (std::strcmp(command, "off") == 0)
+    {
+        a = std::strtol(s, &s, 0);
+        ev.type = kStreamMidi;
+        ev.data[0] = 0x80; ev.data[1] = (uint8_t)a; ev.data[2] = 0;
+    }
+    else if (std::strcmp(command, "midi") == 0)
+    {
+        a = std::strtol(s, &s, 0);
+        b = std::strtol(s, &s, 0);
+        c = std::strtol(s, &s, 0);
+        ev.type = kStreamMidi;
+        ev.data[0] = (uint8_t)a; ev.data[1] = (uint8_t)b; ev.data[2] = (uint8_t)c;
+    }
+    else if (std::strcmp(command, "param") == 0)
+    {
+        a = std::strtol(s, &s, 0);
+        ev.type = kStreamParam;
+        ev.data[0] = (uint8_t)a;
+        ev.value = std::strtof(s, &s);
+    }
+    else if (std::strcmp(command, "sync") == 0)
+    {
+        ev.type = kStreamSync;
+    }
+    else if (std::strcmp(command, "end") == 0)
+    {
+        ev.type = kStreamEnd;
+    }
+
+    return true;
+}
+
+static bool readBinary(StreamEvent& ev)
+{
+    unsigned char record[16];
+    if (std::fread(record, 1, sizeof(record), stdin) != sizeof(record))
+        return false;
+
+    ev.frame = 0;
+    for (int i = 7; i >= 0; --i)
+        ev.frame = ev.frame << 8 | record[i];
+    ev.type = record[8] < kStreamInvalid ? (StreamEventType)record[8] : kStreamInvalid;
+    std::memcpy(ev.data, record + 9, 3);
+
+    const uint32_t bits = (uint32_t)record[12] | (uint32_t)record[13] << 8 | (uint32_t)record[14] << 16 | (uint32_t)record[15] << 24;
+    std::memcpy(&ev.value, &bits, sizeof(float));
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    double sampleRate = 48000.0;
+    uint32_t chunkFrames = 512;
+    int channels = 1;
+    bool int16 = false;
+    bool binary = false;
+    double tail = 1.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--rate") == 0 && hasValue)
+            sampleRate = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--chunk") == 0 && hasValue)
+            chunkFrames = (uint32_t)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--format") == 0 && hasValue)
+            int16 = std::strcmp(argv[++i], "s16") == 0;
+        else if (std::strcmp(argv[i], "--channels") == 0 && hasValue)
+            channels = std::atoi(argv[++i]) == 4 ? 4 : 1;
+        else if (std::strcmp(argv[i], "--binary") == 0)
+            binary = true;
+        else if (std::strcmp(argv[i], "--tail") == 0 && hasValue)
+            tail = std::atof(argv[++i]);
+        else
+        {
+            std::fprintf(stderr, "usage: synth303-stream [--rate hz] [--chunk frames] [--format f32|s16] "
+                                 "[--channels 1|4] [--binary] [--tail s]\n");
+            return 1;
+        }
+    }
+
+    if (chunkFrames == 0 || sampleRate <= 0.0)
+    {
+        std::fprintf(stderr, "invalid chunk size or sample rate\n");
+        return 1;
+    }
+
+#if defined(_WIN32)
+    // text mode would turn every 0x0a byte of the PCM and of binary records into CR LF or back
+    _setmode(_fileno(stdout), _O_BINARY);
+    if (binary)
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+
+    StreamRenderer renderer(sampleRate, chunkFrames, channels, int16);
+
+    char line[512];
+    uint64_t lineNumber = 0, late = 0, invalid = 0;
+    bool ended = false;
+    StreamEvent ev = {};
+
+    while (!ended && !renderer.failed)
+    {
+        if (binary)
+        {
+            if (!readBinary(ev))
+                break;
+            ++lineNumber;
+        }
+        else
+        {
+            if (std::fgets(line, sizeof(line), stdin) == nullptr)
+                break;
+            ++lineNumber;
+            if (!parseText(line, ev))
+                continue;
+        }
+
+        if (ev.type == kStreamInvalid)
+        {
+            if (invalid++ == 0)
+                std::fprintf(stderr, "synth303-stream: ignoring invalid event (event %llu)\n", (unsigned long long)lineNumber);
+            continue;
+        }
+
+        // events in the past are applied now
+        if (ev.frame < renderer.position)
+            ++late;
+        else
+            renderer.renderTo(ev.frame);
+
+        switch (ev.type)
+        {
+        case kStreamMidi:
+            renderer.engine.midiEvent(ev.data[0], ev.data[1], ev.data[2]);
+            break;
+        case kStreamParam:
+            renderer.engine.setParameter(ev.data[0], ev.value);
+            break;
+        case kStreamSync:
+            std::fflush(stdout);
+            break;
+        case kStreamEnd:
+            ended = true;
+            break;
+        case kStreamInvalid:
+            break;
+        }
+    }
+
+    if (!ended)
+        renderer.renderTo(renderer.position + (uint64_t)(tail * sampleRate));
+    renderer.finishChunk();
+    std::fflush(stdout);
+
+    if (late != 0 || invalid != 0)
+        std::fprintf(stderr, "synth303-stream: %llu late and %llu invalid events\n",
+                     (unsigned long long)late, (unsigned long long)invalid);
+
+    return renderer.failed ? 1 : 0;
+}
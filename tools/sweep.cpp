@@ -0,0 +1,315 @@
+// Parameter-grid sweep for calibration: renders one note per grid point on all cores and writes the audio
+// and the cutoff trajectory of each into a single memory-mappable dataset (see SweepDataset.hpp).
+//
+// usage: synth303-sweep --out file.bin [--<axis> spec ...] [--seconds s] [--gate s] [--rate hz] [--threads n]
+//                       [--A v] [--B v] [--C v] [--D v] [--E v] [--base v] [--VaccMul v]
+//
+// axes: fVco fRes fVmod fVacc_amt decTime note accent, each spec is a list "1,2,5" or a range "min:max:count".
+// Axes not given stay at the engine defaults (note 36, no accent). Every combination is rendered.
+//
+// example, the cutoff/envmod calibration grid from the notes file at both decay extremes:
+//   synth303-sweep --out cal.bin --fVco 2.36,4.9,12 --fVmod 0.099,0.283,1 --decTime -2.223,1.223
+
+// 64-bit fseeko() on 32-bit glibc, datasets grow past 2 GB
+#if !defined(_WIN32) && !defined(_FILE_OFFSET_BITS)
+# define _FILE_OFFSET_BITS 64
+#endif
+
+#include "Synth303Engine.hpp"
+#include "SweepDataset.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fseek() takes a long, 32 bits on Windows, and would wrap past 2 GB
+static bool seekTo(std::FILE* file, uint64_t offset)
+{
+#if defined(_WIN32)
+    return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool parseAxis(const char* spec, std::vector<float>& values)
+{
+    values.clear();
+
+    float lo, hi;
+    int count;
+    char trailing;
+    if (std::sscanf(spec, "%f:%f:%d%c", &lo, &hi, &count, &trailing) == 3)
+    {
+        if (count < 1)
+            return false;
+        for (int i = 0; i < count; ++i)
+            values.push_back(count == 1 ? lo : lo + (hi - lo) * i / (count - 1));
+        return true;
+    }
+
+    for (const char* s = spec; *s != '\0';)
+    {
+        char* end;
+        values.push_back(std::strtof(s, &end));
+        if (end == s)
+            return false;
+        s = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0')
+            return false;
+    }
+    return !values.empty();
+}
+
+struct SweepJob {
+    const std::vector<float>* axes;
+    double sampleRate;
+    uint32_t frames;
+    uint32_t gateFrames;
+    const float* formula;
+};
+
+// renders grid point `record`, fills its index entry and the waveform and cutoff buffers
+static void renderRecord(const SweepJob& job, uint64_t record, float* const* outputs, uint32_t blockSize,
+                         float* waveform, float* cutoff, SweepIndexEntry& entry)
+{
+    std::memset(&entry, 0, sizeof(entry));
+
+    uint64_t rest = record;
+    for (int a = kAxisCount - 1; a >= 0; --a)
+    {
+        const std::vector<float>& axis = job.axes[a];
+        entry.params[a] = axis[rest % axis.size()];
+        rest /= axis.size();
+    }
+
+    // a fresh engine per record, no state carries over from the previous setting
+    Synth303Engine engine;
+    engine.fVco = entry.params[kAxisVco];
+    engine.fRes = entry.params[kAxisRes];
+    engine.fVmod = entry.params[kAxisVmod];
+    engine.fVacc_amt = entry.params[kAxisVaccAmt];
+    engine.decTime = entry.params[kAxisDecTime];
+    engine.A = job.formula[0];
+    engine.B = job.formula[1];
+    engine.C = job.formula[2];
+    engine.D = job.formula[3];
+    engine.E = job.formula[4];
+    engine.base = job.formula[5];
+    engine.VaccMul = job.formula[6];
+    engine.cvOutputs = false;
+    engine.sampleRateChanged(job.sampleRate);
+    engine.activate(job.sampleRate, blockSize);
+
+    const uint8_t note = (uint8_t)std::clamp((int)std::lrint(entry.params[kAxisNote]), 0, 127);
+    engine.midiEvent(0x90, note, entry.params[kAxisAccent] >= 0.5f ? 127 : 80);
+
+    float cutoffMin = INFINITY, cutoffMax = 0.0f, peak = 0.0f;
+
+    for (uint32_t done = 0; done < job.frames;)
+    {
+        if (done == job.gateFrames)
+            engine.midiEvent(0x80, note, 0);
+
+        uint32_t n = std::min(blockSize, job.frames - done);
+        if (done < job.gateFrames)
+            n = std::min(n, job.gateFrames - done);
+
+        engine.process(const_cast<float**>(outputs), n);
+
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            waveform[done + i] = outputs[0][i];
+            cutoff[done + i] = engine.freqBuffer[i];
+            peak = std::max(peak, std::fabs(outputs[0][i]));
+            cutoffMin = std::min(cutoffMin, engine.freqBuffer[i]);
+            cutoffMax = std::max(cutoffMax, engine.freqBuffer[i]);
+        }
+        done += n;
+    }
+
+    entry.peak = peak;
+    entry.cutoffMin = cutoffMin;
+    entry.cutoffMax = cutoffMax;
+    entry.nyquistClamps = (uint32_t)engine.stats.nyquistClamps;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* outPath = nullptr;
+    double seconds = 1.0;
+    double gateSeconds = -1.0;
+    double sampleRate = 48000.0;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    Synth303Engine defaults;
+    std::vector<float> axes[kAxisCount] = {
+        { defaults.fVco }, { defaults.fRes }, { defaults.fVmod }, { defaults.fVacc_amt }, { defaults.decTime },
+        { 36.0f }, { 0.0f },
+    };
+
+    static const char* const kFormulaNames[7] = { "A", "B", "C", "D", "E", "base", "VaccMul" };
+    float formula[7] = { defaults.A, defaults.B, defaults.C, defaults.D, defaults.E, defaults.base, defaults.VaccMul };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        bool known = false;
+
+        if (argv[i][0] == '-' && argv[i][1] == '-' && hasValue)
+        {
+            const char* const name = argv[i] + 2;
+            for (int a = 0; a < kAxisCount && !known; ++a)
+            {
+                if (std::strcmp(name, kSweepAxisNames[a]) == 0)
+                {
+                    if (!parseAxis(argv[i + 1], axes[a]))
+                    {
+                        std::fprintf(stderr, "bad values for --%s: %s\n", name, argv[i + 1]);
+                        return 1;
+                    }
+                    known = true;
+                }
+            }
+            for (int f = 0; f < 7 && !known; ++f)
+            {
+                if (std::strcmp(name, kFormulaNames[f]) == 0)
+                {
+                    formula[f] = std::strtof(argv[i + 1], nullptr);
+                    known = true;
+                }
+            }
+
+            if (std::strcmp(name, "out") == 0)
+                outPath = argv[i + 1], known = true;
+            else if (std::strcmp(name, "seconds") == 0)
+                seconds = std::atof(argv[i + 1]), known = true;
+            else if (std::strcmp(name, "gate") == 0)
+                gateSeconds = std::atof(argv[i + 1]), known = true;
+            else if (std::strcmp(name, "rate") == 0)
+                sampleRate = std::atof(argv[i + 1]), known = true;
+            else if (std::strcmp(name, "threads") == 0)
+                threads = (unsigned)std::max(1, std::atoi(argv[i + 1])), known = true;
+
+            if (known)
+            {
+                ++i;
+                continue;
+            }
+        }
+
+        std::fprintf(stderr, "usage: synth303-sweep --out file.bin [--<axis> a,b,c | min:max:count ...] [--seconds s] "
+                             "[--gate s] [--rate hz] [--threads n] [--A v ... --VaccMul v]\naxes:");
+        for (const char* name : kSweepAxisNames)
+            std::fprintf(stderr, " %s", name);
+        std::fprintf(stderr, "\n");
+        return 1;
+    }
+
+    if (outPath == nullptr || seconds <= 0.0 || sampleRate <= 0.0)
+    {
+        std::fprintf(stderr, "--out is required, --seconds and --rate must be positive\n");
+        return 1;
+    }
+
+    uint64_t recordCount = 1;
+    for (const std::vector<float>& axis : axes)
+        recordCount *= axis.size();
+
+    const uint32_t frames = (uint32_t)(seconds * sampleRate);
+    const uint32_t gateFrames = gateSeconds < 0.0 ? frames / 2 : (uint32_t)std::min(gateSeconds * sampleRate, (double)frames);
+    const uint64_t recordBytes = (uint64_t)frames * sizeof(float);
+
+    SweepHeader header = {};
+    std::memcpy(header.magic, "S303SWP1", 8);
+    header.version = 1;
+    header.headerSize = sizeof(SweepHeader);
+    header.recordCount = recordCount;
+    header.sampleRate = (uint32_t)sampleRate;
+    header.frames = frames;
+    header.gateFrames = gateFrames;
+    header.axisCount = kAxisCount;
+    header.indexOffset = sizeof(SweepHeader);
+    header.dataOffset = (header.indexOffset + recordCount * sizeof(SweepIndexEntry) + 63) & ~(uint64_t)63;
+    header.recordStride = (2 * recordBytes + 63) & ~(uint64_t)63;
+    std::memcpy(header.formula, formula, sizeof(formula));
+
+    std::FILE* const file = std::fopen(outPath, "wb");
+    if (file == nullptr)
+    {
+        std::fprintf(stderr, "could not create %s\n", outPath);
+        return 1;
+    }
+    std::fwrite(&header, sizeof(header), 1, file);
+
+    std::fprintf(stderr, "synth303-sweep: %llu settings x %.2fs @ %.0fHz on %u threads, %.1f MB\n",
+                 (unsigned long long)recordCount, seconds, sampleRate, threads,
+                 (header.dataOffset + recordCount * header.recordStride) / 1e6);
+
+    const SweepJob job = { axes, sampleRate, frames, gateFrames, formula };
+    std::vector<SweepIndexEntry> index(recordCount);
+    std::atomic<uint64_t> next { 0 };
+    std::atomic<uint64_t> finished { 0 };
+    std::atomic<bool> failed { false };
+    std::mutex fileMutex;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&] {
+        constexpr uint32_t blockSize = 256;
+        std::vector<float> out(blockSize * 4);
+        float* outputs[4] = { &out[0], &out[blockSize], &out[blockSize * 2], &out[blockSize * 3] };
+        std::vector<float> record(header.recordStride / sizeof(float), 0.0f);
+
+        for (uint64_t r; (r = next.fetch_add(1)) < recordCount && !failed;)
+        {
+            SweepIndexEntry& entry = index[r];
+            renderRecord(job, r, outputs, blockSize, record.data(), record.data() + frames, entry);
+
+            const uint64_t offset = header.dataOffset + r * header.recordStride;
+            entry.waveformOffset = offset;
+            entry.cutoffOffset = offset + recordBytes;
+
+            {
+                const std::lock_guard<std::mutex> lock(fileMutex);
+                if (!seekTo(file, offset)
+                    || std::fwrite(record.data(), 1, header.recordStride, file) != header.recordStride)
+                    failed = true;
+            }
+
+            const uint64_t done = ++finished;
+            if (done % 256 == 0 || done == recordCount)
+                std::fprintf(stderr, "\r%llu/%llu", (unsigned long long)done, (unsigned long long)recordCount);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t)
+        pool.emplace_back(worker);
+    for (std::thread& t : pool)
+        t.join();
+
+    if (!failed)
+    {
+        if (!seekTo(file, header.indexOffset)
+            || std::fwrite(index.data(), sizeof(SweepIndexEntry), index.size(), file) != index.size())
+            failed = true;
+    }
+    if (std::fclose(file) != 0 || failed)
+    {
+        std::fprintf(stderr, "\nwrite to %s failed\n", outPath);
+        return 1;
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "\ndone in %.2fs, %.1f settings/s, %.0fx realtime\n", elapsed, recordCount / elapsed,
+                 recordCount * seconds / elapsed);
+    return 0;
+}